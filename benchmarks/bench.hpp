@@ -0,0 +1,49 @@
+#ifndef BENCH
+#define BENCH
+/* Minimal benchmark harness. Every result is printed as "<metric> <nanoseconds>", the format
+ * cmake/CompareBaseline.cmake compares against benchmarks/baselines/. */
+#include <chrono>
+#include <cstdio>
+#include <string>
+
+namespace bench {
+
+/**
+ * @brief Prevent the optimizer from removing a computed value.
+ * 
+ * @param v (T const&) The value to keep alive.
+ */
+template <typename T>
+inline void doNotOptimize(T const& v) {
+	asm volatile("" : : "r,m"(v) : "memory");
+}
+
+/**
+ * @brief Time a function and return the average nanoseconds per iteration.
+ * 
+ * @param iterations (long) How many times f is called.
+ * @param f (F) The measured function, called with the iteration index.
+ * @return double
+ */
+template <typename F>
+inline double measure(long iterations, F f) {
+	auto start = std::chrono::steady_clock::now();
+	for (long i = 0; i < iterations; i++) {
+		f(i);
+	}
+	auto end = std::chrono::steady_clock::now();
+	return std::chrono::duration<double, std::nano>(end - start).count() / iterations;
+}
+
+/**
+ * @brief Print one benchmark result.
+ * 
+ * @param metric (const std::string&) Name of the metric, it must match the baseline file.
+ * @param ns (double) Nanoseconds per operation.
+ */
+inline void report(const std::string& metric, double ns) {
+	std::printf("%s %.1f\n", metric.c_str(), ns);
+}
+
+}
+#endif
@@ -0,0 +1,55 @@
+#include "bench.hpp"
+#include "area.hpp"
+
+/* An area of 200 rooms in a line with four items each. */
+static nodes makeArea() {
+	nodes rooms;
+	for (std::size_t i = 0; i < 200; i++) {
+		rooms.push_back(node(new Room("Tunnel " + std::to_string(i))));
+		rooms[i]->setDescription("A dripping tunnel, the walls glow faintly.");
+		if (i) {
+			rooms[i]->addNeighbour(rooms[i - 1]);
+			rooms[i - 1]->addNeighbour(rooms[i]);
+		}
+		for (int j = 0; j < 4; j++) {
+			item it(new Object("Crystal"));
+			rooms[i]->addItem(it);
+		}
+	}
+	return rooms;
+}
+
+/* What a mission did before: a deep copy of the rooms, their links and their items. */
+static nodes deepCopy(const nodes& rooms) {
+	nodes copy;
+	std::unordered_map<const Room*, std::size_t> index;
+	for (std::size_t i = 0; i < rooms.size(); i++) {
+		index[rooms[i].get()] = i;
+		copy.push_back(node(new Room(rooms[i]->getName())));
+		copy[i]->setDescription(rooms[i]->getDescription());
+		for (item const& it : rooms[i]->getItems()) {
+			item c(new Object(it->getName()));
+			copy[i]->addItem(c);
+		}
+	}
+	for (std::size_t i = 0; i < rooms.size(); i++) {
+		for (node const& n : rooms[i]->getNeighbours()) copy[i]->addNeighbour(copy[index[n.get()]]);
+	}
+	return copy;
+}
+
+int main() {
+	nodes rooms = makeArea();
+	bench::report("area_deep_copy_200_rooms", bench::measure(50, [&](long) {
+		bench::doNotOptimize(deepCopy(rooms).size());
+	}));
+	area::InstancePool pool(area::build(rooms));
+	bench::report("area_instance_200_rooms", bench::measure(5000, [&](long) {
+		area::Instance* i = pool.acquire();
+		i->enter(0);
+		i->move(0, 1);
+		bench::doNotOptimize(i->getItems(1).size());
+		pool.release(i);
+	}));
+	return 0;
+}
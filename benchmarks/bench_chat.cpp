@@ -0,0 +1,31 @@
+#include "bench.hpp"
+#include "chat.hpp"
+
+int main() {
+	/* A hundred rooms in a ring with a hundred players each, every tick every room gets three
+	 * messages and a shout. */
+	const std::size_t roomCount = 100;
+	const std::size_t perRoom = 100;
+	nodes rooms;
+	for (std::size_t i = 0; i < roomCount; i++) rooms.push_back(node(new Room("Deck" + std::to_string(i))));
+	for (std::size_t i = 0; i < roomCount; i++) {
+		rooms[i]->addNeighbour(rooms[(i + 1) % roomCount]);
+		rooms[i]->addNeighbour(rooms[(i + roomCount - 1) % roomCount]);
+	}
+	Entity player("Ripley");
+	session::Manager sessions;
+	for (std::size_t i = 0; i < roomCount * perRoom; i++) sessions.open(&player, rooms[i % roomCount]);
+	chat::Broadcaster chat;
+	bench::report("chat_tick_10k_players", bench::measure(20, [&](long) {
+		for (node const& r : rooms) {
+			chat.say(*r, "Ripley", "Anyone on this deck?");
+			chat.say(*r, "Dallas", "Here.");
+			chat.say(*r, "Lambert", "Me too.");
+			chat.shout(*r, "Parker", "Fire in the hold!");
+		}
+		bench::doNotOptimize(chat.flush(sessions));
+		chat.endTick();
+		sessions.endTick();
+	}));
+	return 0;
+}
@@ -0,0 +1,31 @@
+#include <cstdio>
+#include "bench.hpp"
+#include "columnar.hpp"
+
+int main() {
+	/* A million rooms in a line, every tenth with an item. */
+	const std::size_t n = 1000000;
+	std::shared_ptr<std::vector<RoomView>> rooms(new std::vector<RoomView>(n));
+	for (std::size_t i = 0; i < n; i++) {
+		RoomView& r = (*rooms)[i];
+		r.name = "Room" + std::to_string(i);
+		if (i) r.neighbours.push_back(i - 1);
+		if (i + 1 < n) r.neighbours.push_back(i + 1);
+		if (i % 10 == 0) r.items.push_back("Crate");
+		r.keys = 0;
+	}
+	snapshot s(rooms);
+	const std::string path = "bench_columnar.swc";
+	jobs::Pool pool;
+	bench::report("columnar_export_per_room", bench::measure(1, [&](long) {
+		columnar::Writer writer(path, &pool);
+		writer.write(s);
+	}) / n);
+	/* Loading the file, checksums verified in parallel. */
+	bench::report("columnar_import_per_room", bench::measure(1, [&](long) {
+		columnar::Reader reader(path, &pool);
+		bench::doNotOptimize(reader.rows("rooms"));
+	}) / n);
+	std::remove(path.c_str());
+	return 0;
+}
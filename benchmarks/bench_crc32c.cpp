@@ -0,0 +1,16 @@
+#include <string>
+#include "bench.hpp"
+#include "crc32c.hpp"
+
+int main() {
+	std::string data(1 << 20, '\0');
+	for (std::size_t i = 0; i < data.size(); i++) data[i] = static_cast<char>(i * 131 + 17);
+	/* Checksum of a megabyte, reported per KiB. */
+	bench::report("crc32c_software_per_kib", bench::measure(20, [&](long) {
+		bench::doNotOptimize(crc32c::software(0, data.data(), data.size()));
+	}) / 1024);
+	bench::report("crc32c_per_kib", bench::measure(20, [&](long) {
+		bench::doNotOptimize(crc32c::compute(data.data(), data.size()));
+	}) / 1024);
+	return 0;
+}
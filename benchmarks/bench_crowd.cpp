@@ -0,0 +1,33 @@
+#include <algorithm>
+#include <string>
+#include <thread>
+#include <vector>
+#include "bench.hpp"
+#include "engine.hpp"
+
+/* Many threads enter and leave the same hot room, the result is the time of one enter and
+ * leave pair as seen by one thread. */
+static double contend(Room& room, unsigned threads, long iterations) {
+	std::vector<double> results(threads);
+	std::vector<std::thread> pool;
+	for (unsigned t = 0; t < threads; t++) {
+		pool.push_back(std::thread([&, t] {
+			results[t] = bench::measure(iterations, [&](long) {
+				if (room.tryEnter()) room.leave();
+			});
+		}));
+	}
+	for (auto& t : pool) t.join();
+	return *std::max_element(results.begin(), results.end());
+}
+
+int main() {
+	node hot(new Room("Airlock"));
+	hot->setCapacity(4);
+	unsigned hw = std::max(2u, std::thread::hardware_concurrency());
+	for (unsigned threads = 1; threads <= 8; threads *= 2) {
+		if (threads > hw) break;
+		bench::report("crowd_enter_leave_" + std::to_string(threads) + "_threads", contend(*hot, threads, 200000));
+	}
+	return 0;
+}
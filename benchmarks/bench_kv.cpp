@@ -0,0 +1,45 @@
+#include <cstdlib>
+#include "bench.hpp"
+#include "kv.hpp"
+
+int main() {
+	char name[] = "bench_kv_XXXXXX";
+	std::string dir = mkdtemp(name);
+	{
+		const int players = 100000;
+		kv::Store store(dir);
+		std::vector<std::unique_ptr<Entity>> entities;
+		for (int i = 0; i < players; i++) {
+			entities.push_back(std::unique_ptr<Entity>(new Entity("player" + std::to_string(i), 100, 100)));
+			item flare(new Object("Flare"));
+			item card(new Key("Keycard", "K" + std::to_string(i)));
+			entities.back()->addItem(flare).addItem(card);
+		}
+		{
+			kv::Profiles profiles(store);
+			for (int i = 0; i < players; i++) {
+				profiles.save(*entities[i]);
+				if (i % 1000 == 999) profiles.endTick();
+			}
+		}
+		/* A tick saving 1000 online players as one batch, reported per profile. */
+		kv::Profiles profiles(store);
+		long next = 0;
+		bench::report("kv_save_per_profile", bench::measure(20, [&](long) {
+			for (int i = 0; i < 1000; i++) profiles.save(*entities[next++ % players]);
+			profiles.endTick();
+		}) / 1000);
+		/* Logins of players, that are not cached, spread over the 100k profiles. */
+		kv::Profiles cold(store);
+		bench::report("kv_cold_load", bench::measure(2000, [&](long i) {
+			bench::doNotOptimize(cold.load("player" + std::to_string(i * 49999 % players)));
+		}));
+		bench::report("kv_cached_load", bench::measure(2000, [&](long i) {
+			bench::doNotOptimize(cold.load("player" + std::to_string(i * 49999 % players)));
+		}));
+	}
+	for (auto const& f : wal::list(dir, "sst-", ".sst")) unlink(f.second.c_str());
+	unlink((dir + "/kv.log").c_str());
+	rmdir(dir.c_str());
+	return 0;
+}
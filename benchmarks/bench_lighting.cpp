@@ -0,0 +1,31 @@
+#include "bench.hpp"
+#include "lighting.hpp"
+
+int main() {
+	/* A 100 x 100 grid of decks with a lamp every 10 decks, one lamp fails and is repaired per iteration. */
+	const std::size_t side = 100;
+	World world;
+	nodes rooms;
+	for (std::size_t i = 0; i < side * side; i++) {
+		rooms.push_back(node(new Room("Deck" + std::to_string(i))));
+		if (i % side) rooms[i]->addNeighbour(rooms[i - 1]);
+		if (i >= side) rooms[i]->addNeighbour(rooms[i - side]);
+		world.addRoom(rooms[i]);
+	}
+	lighting::Lighting light(world, 32);
+	for (std::uint32_t r = 0; r < side * side; r += 10) light.setSource(r, 255);
+	light.update();
+	bench::report("lighting_outage_10k_rooms", bench::measure(200, [&](long i) {
+		std::uint32_t lamp = (i * 10 * 37) % (side * side);
+		light.setSource(lamp, 0);
+		bench::doNotOptimize(light.update());
+		light.setSource(lamp, 255);
+		bench::doNotOptimize(light.update());
+	}));
+	bench::report("lighting_full_10k_rooms", bench::measure(5, [&](long) {
+		lighting::Lighting fresh(world, 32);
+		for (std::uint32_t r = 0; r < side * side; r += 10) fresh.setSource(r, 255);
+		bench::doNotOptimize(fresh.update());
+	}));
+	return 0;
+}
@@ -0,0 +1,42 @@
+#include "bench.hpp"
+#include "merkle.hpp"
+
+int main() {
+	/* 100k rooms with a few items each, a tick changes 100 of them. */
+	const std::size_t n = 100000;
+	World primary, replica;
+	for (World* w : {&primary, &replica}) {
+		for (std::size_t i = 0; i < n; i++) {
+			node r(new Room("Room" + std::to_string(i)));
+			for (int k = 0; k < 3; k++) {
+				item crate(new Object("Crate"));
+				r->addItem(crate);
+			}
+			w->addRoom(r);
+		}
+	}
+	merkle::Tree a(primary), b(replica);
+	bench::report("merkle_build_per_room", bench::measure(1, [&](long) {
+		a.update();
+	}) / n);
+	b.update();
+	nodetable const& rooms = primary.getRooms();
+	long next = 0;
+	bench::report("merkle_update_100_dirty", bench::measure(20, [&](long) {
+		for (int i = 0; i < 100; i++) {
+			item flare(new Object("Flare"));
+			node const& r = rooms[(next++ * 7919) % n];
+			r->addItem(flare);
+			a.touch(*r);
+		}
+		a.update();
+	}));
+	/* Finding changes by a scan of the versions instead, nothing changed. */
+	bench::report("merkle_scan_clean", bench::measure(20, [&](long) {
+		a.scan();
+	}));
+	bench::report("merkle_diff_2000_divergent", bench::measure(20, [&](long) {
+		bench::doNotOptimize(a.diff(b).rooms.size());
+	}));
+	return 0;
+}
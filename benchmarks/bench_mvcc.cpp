@@ -0,0 +1,64 @@
+#include <algorithm>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "bench.hpp"
+#include "mvcc.hpp"
+
+/* Nine of ten operations read the inventory of one hot room, one takes an item and puts it back.
+ * The result is the time of one operation as seen by one of the threads. */
+template <typename F>
+static double parallel(unsigned threads, long iterations, F f) {
+	std::vector<double> results(threads);
+	std::vector<std::thread> pool;
+	for (unsigned t = 0; t < threads; t++) {
+		pool.push_back(std::thread([&, t] {
+			results[t] = bench::measure(iterations, f);
+		}));
+	}
+	for (auto& t : pool) t.join();
+	return *std::max_element(results.begin(), results.end());
+}
+
+int main() {
+	unsigned hw = std::max(2u, std::thread::hardware_concurrency());
+	for (unsigned threads = 1; threads <= 8; threads *= 2) {
+		if (threads > hw) break;
+		const std::string suffix = "_" + std::to_string(threads) + "_threads";
+
+		node room(new Room("Loot"));
+		for (int i = 0; i < 16; i++) {
+			item loot(new Object("Loot" + std::to_string(i)));
+			room->addItem(loot);
+		}
+		std::mutex roomMutex;
+		bench::report("mutex_room" + suffix, parallel(threads, 100000, [&](long i) {
+			std::lock_guard<std::mutex> lock(roomMutex);
+			if (i % 10) {
+				bench::doNotOptimize(room->getItems().size());
+			} else {
+				items all = room->takeItems();
+				item taken = std::move(all.back());
+				all.pop_back();
+				all.push_back(std::move(taken));
+				room->addItems(all);
+			}
+		}));
+
+		mvcc::Epochs epochs;
+		mvcc::Inventory inventory(room->takeItems(), epochs);
+		bench::report("mvcc_room" + suffix, parallel(threads, 100000, [&](long i) {
+			if (i % 10) {
+				mvcc::Inventory::Reader r(inventory);
+				bench::doNotOptimize(r.getItems().size());
+			} else {
+				item taken = inventory.take("Loot" + std::to_string(i % 16));
+				if (taken) inventory.add(taken);
+				if (i % 1000 == 0) inventory.collect();
+			}
+		}));
+		while (inventory.collect()) {}
+	}
+	return 0;
+}
@@ -0,0 +1,37 @@
+#include "bench.hpp"
+#include "engine.hpp"
+
+int main() {
+	/* A station of 100000 cabins, built from scratch or from one prefab. */
+	const std::uint32_t n = 100000;
+	const std::string description = "A narrow bunk, a locker and a porthole looking out on the gas giant.";
+	std::shared_ptr<Prefab> cabin(new Prefab());
+	cabin->name = "Cabin";
+	cabin->description = description;
+	cabin->layout.push_back({"Blanket", ""});
+	cabin->layout.push_back({"Pillow", ""});
+	cabin->layout.push_back({"Locker key", "Locker"});
+	prefab shared(cabin);
+	bench::report("prefab_build_plain_100k_rooms", bench::measure(3, [&](long) {
+		World world;
+		for (std::uint32_t i = 0; i < n; i++) {
+			node r(new Room("Cabin " + std::to_string(i)));
+			r->setDescription(description);
+			item blanket(new Object("Blanket"));
+			item pillow(new Object("Pillow"));
+			item key(new Key("Locker key", "Locker"));
+			r->addItem(blanket).addItem(pillow).addItem(key);
+			world.addRoom(r);
+		}
+		bench::doNotOptimize(world.getRooms().size());
+	}));
+	bench::report("prefab_build_instances_100k_rooms", bench::measure(3, [&](long) {
+		World world;
+		for (std::uint32_t i = 0; i < n; i++) {
+			node r(new Room(shared, i));
+			world.addRoom(r);
+		}
+		bench::doNotOptimize(world.getRooms().size());
+	}));
+	return 0;
+}
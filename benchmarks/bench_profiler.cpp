@@ -0,0 +1,23 @@
+#include "bench.hpp"
+#include "engine.hpp"
+
+int main() {
+	profiler::FrameProfiler p;
+	p.beginTick(0);
+	bench::report("profiler_zone", bench::measure(1000000, [&](long) {
+		PROFILE_ZONE(p, "zone");
+	}));
+	p.endTick();
+
+	p.setEnabled(false);
+	bench::report("profiler_zone_disabled", bench::measure(1000000, [&](long) {
+		PROFILE_ZONE(p, "zone");
+	}));
+
+	World world;
+	world.addSystem(Phase::Movement, [](World&) {}).addSystem(Phase::Combat, [](World&) {});
+	bench::report("world_tick_profiled", bench::measure(100000, [&](long) {
+		world.tick();
+	}));
+	return 0;
+}
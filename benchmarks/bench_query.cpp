@@ -0,0 +1,21 @@
+#include "bench.hpp"
+#include "query.hpp"
+
+int main() {
+	/* A million rooms in a ring with a chord every 16 rooms, keys spread unevenly. */
+	const std::uint32_t n = 1000000;
+	query::Store store;
+	std::vector<std::uint32_t> neighbours;
+	for (std::uint32_t i = 0; i < n; i++) {
+		neighbours.assign({(i + n - 1) % n, (i + 1) % n});
+		if (i % 16 == 0) neighbours.push_back((i + n / 2) % n);
+		store.addRoom(i ? "Room" + std::to_string(i) : "Bridge", i % 7, (i * 2654435761u) % 6, neighbours);
+	}
+	bench::report("query_scan_1m_rooms", bench::measure(5, [&](long) {
+		bench::doNotOptimize(query::run("count rooms where keys > 3 and items < 5", store).count);
+	}));
+	bench::report("query_hops_1m_rooms", bench::measure(20, [&](long) {
+		bench::doNotOptimize(query::run("rooms where keys > 3 and within 5 of \"Bridge\"", store).count);
+	}));
+	return 0;
+}
@@ -0,0 +1,43 @@
+#include <atomic>
+#include <thread>
+#include "bench.hpp"
+#include "replica.hpp"
+
+int main() {
+	const std::string path = "bench_replica.sock";
+	World primaryWorld, standbyWorld;
+	for (World* w : {&primaryWorld, &standbyWorld}) {
+		for (int i = 0; i < 1000; i++) {
+			node r(new Room("Room" + std::to_string(i)));
+			w->addRoom(r);
+		}
+	}
+	replica::Primary primary(primaryWorld, path);
+	std::atomic<bool> stop(false);
+	std::thread standbyThread([&] {
+		replica::Standby standby(standbyWorld, path);
+		while (!stop.load() && standby.isConnected()) {
+			if (!standby.poll()) std::this_thread::yield();
+		}
+	});
+	while (!primary.flush()) std::this_thread::yield();
+	auto tick = [&](int mutations) {
+		for (int i = 0; i < mutations; i++) {
+			std::string room = wal::roomKey("Room" + std::to_string(i % 1000));
+			primary.publish({wal::Op::Add, room, "Crate"});
+			primary.publish({wal::Op::Remove, room, "Crate"});
+		}
+		primary.flush();
+		while (primary.getAcked() < primary.getSequence()) {
+			std::this_thread::yield();
+			primary.flush();
+		}
+	};
+	/* A tick of 10000 mutations until the standby applied it, reported per mutation. */
+	bench::report("replica_throughput_per_mutation", bench::measure(10, [&](long) {tick(5000);}) / 10000);
+	/* Lag of a small tick, from sending until the acknowledgement. */
+	bench::report("replica_lag", bench::measure(50, [&](long) {tick(50);}));
+	stop = true;
+	standbyThread.join();
+	return 0;
+}
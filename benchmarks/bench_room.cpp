@@ -0,0 +1,22 @@
+#include "bench.hpp"
+#include "engine.hpp"
+
+int main() {
+	bench::report("room_construct", bench::measure(100000, [](long) {
+		node r(new Room("Room"));
+		bench::doNotOptimize(r);
+	}));
+
+	node hub(new Room("Hub"));
+	bench::report("room_add_neighbour", bench::measure(100000, [&](long) {
+		node r(new Room("Room"));
+		hub->addNeighbour(r);
+	}));
+
+	node storage(new Room("Storage"));
+	bench::report("room_add_item", bench::measure(100000, [&](long) {
+		item i(new Object("Item"));
+		storage->addItem(i);
+	}));
+	return 0;
+}
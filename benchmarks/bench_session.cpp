@@ -0,0 +1,32 @@
+#include "bench.hpp"
+#include "session.hpp"
+
+int main() {
+	/* Ten thousand players, every tick each one sends a command and gets a reply, and a hundred
+	 * of them reconnect. */
+	const std::size_t players = 10000;
+	session::Manager sessions;
+	sessions.reserve(players);
+	Entity player("Ripley");
+	node bridge(new Room("Bridge"));
+	std::vector<session::id> ids;
+	for (std::size_t i = 0; i < players; i++) ids.push_back(sessions.open(&player, bridge));
+	bench::report("session_tick_10k_players", bench::measure(50, [&](long tick) {
+		sessions.forEach([](session::Session& s) {
+			s.pushCommand("look", 4);
+			s.send("You see a hatch.", 16);
+		});
+		sessions.endTick();
+		for (std::size_t i = 0; i < 100; i++) {
+			std::size_t p = (tick * 100 + i) % players;
+			sessions.close(ids[p]);
+			ids[p] = sessions.open(&player, bridge);
+		}
+	}));
+	bench::report("session_reconnect", bench::measure(100000, [&](long i) {
+		std::size_t p = i % players;
+		sessions.close(ids[p]);
+		ids[p] = sessions.open(&player, bridge);
+	}));
+	return 0;
+}
@@ -0,0 +1,49 @@
+#include "bench.hpp"
+#include "sim.hpp"
+
+int main() {
+	/* A station of 10000 decks in a line with 1000 crew, a fork simulates a breach for 10 ticks
+	 * with the combat system of the World. */
+	const std::size_t n = 10000;
+	World world;
+	nodes rooms;
+	for (std::size_t i = 0; i < n; i++) {
+		rooms.push_back(node(new Room("Deck" + std::to_string(i))));
+		if (i) {
+			rooms[i]->addNeighbour(rooms[i - 1]);
+			rooms[i - 1]->addNeighbour(rooms[i]);
+		}
+		world.addRoom(rooms[i]);
+	}
+	std::vector<std::size_t> location;
+	for (std::size_t e = 0; e < 1000; e++) {
+		world.addEntity(std::make_shared<Entity>("Crew"));
+		location.push_back(e * 10);
+	}
+	world.addSystem(Phase::Combat, [location](World& w) {
+		for (std::size_t e = 0; e < location.size(); e++) {
+			int hp = w.getEntities()[e]->getHp();
+			if (hp <= 0) continue;
+			for (item const& i : w.getRooms()[location[e]]->getItems()) {
+				if (i->getName() == "Breach") w.mutateEntity(e).setHp(hp - 40);
+			}
+		}
+	});
+	bench::report("sim_fork", bench::measure(10000, [&](long) {
+		std::unique_ptr<World> f = world.fork();
+		bench::doNotOptimize(f->getRooms().size());
+	}));
+	bench::report("sim_fork_10_ticks_10k_rooms", bench::measure(20, [&](long i) {
+		std::unique_ptr<World> f = sim::simulate(world, 10, [i](World& w) {
+			item hole(new Object("Breach"));
+			w.mutateRoom((i * 970) % n).addItem(hole);
+		});
+		bench::doNotOptimize(f->getRooms().owned());
+	}));
+	bench::report("sim_full_copy_10k_rooms", bench::measure(20, [&](long) {
+		std::unique_ptr<World> f = world.fork();
+		for (std::size_t r = 0; r < n; r++) f->mutateRoom(r);
+		bench::doNotOptimize(f->getRooms().owned());
+	}));
+	return 0;
+}
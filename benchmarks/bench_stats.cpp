@@ -0,0 +1,37 @@
+#include <algorithm>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+#include "bench.hpp"
+#include "engine.hpp"
+
+/* Time of one add as seen by one of the threads, that add concurrently. */
+template <typename F>
+static double parallel(unsigned threads, long iterations, F f) {
+	std::vector<double> results(threads);
+	std::vector<std::thread> pool;
+	for (unsigned t = 0; t < threads; t++) {
+		pool.push_back(std::thread([&, t] {
+			results[t] = bench::measure(iterations, f);
+		}));
+	}
+	for (auto& t : pool) t.join();
+	return *std::max_element(results.begin(), results.end());
+}
+
+int main() {
+	unsigned hw = std::max(2u, std::thread::hardware_concurrency());
+	for (unsigned threads = 1; threads <= 8; threads *= 2) {
+		if (threads > hw) break;
+		std::atomic<std::int64_t> shared(0);
+		bench::report("stats_shared_atomic_" + std::to_string(threads) + "_threads", parallel(threads, 1000000, [&](long) {
+			shared.fetch_add(1, std::memory_order_relaxed);
+		}));
+		stats::Accumulator sharded;
+		bench::report("stats_sharded_" + std::to_string(threads) + "_threads", parallel(threads, 1000000, [&](long) {
+			sharded.add();
+		}));
+	}
+	return 0;
+}
@@ -0,0 +1,36 @@
+#include "bench.hpp"
+#include "txn.hpp"
+
+int main() {
+	Entity a("A");
+	Entity b("B");
+	item key(new Object("Key"));
+	item credits(new Object("Credits"));
+	a.addItem(key).addItem(credits);
+
+	/* The items go back and forth, so every iteration commits two moves. */
+	txn::Transaction t;
+	bench::report("txn_commit_two_moves", bench::measure(100000, [&](long i) {
+		if (i & 1) {
+			t.move(b, "Key", a).move(b, "Credits", a);
+		} else {
+			t.move(a, "Key", b).move(a, "Credits", b);
+		}
+		bench::doNotOptimize(t.commit());
+	}));
+
+	/* The same two moves without a transaction, the floor of the commit path. */
+	items from;
+	items to;
+	from.push_back(item(new Object("Key")));
+	from.push_back(item(new Object("Credits")));
+	bench::report("direct_two_moves", bench::measure(100000, [&](long) {
+		for (int m = 0; m < 2; m++) {
+			to.push_back(std::move(from.front()));
+			from.erase(from.begin());
+		}
+		from.swap(to);
+		bench::doNotOptimize(from);
+	}));
+	return 0;
+}
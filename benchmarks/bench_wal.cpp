@@ -0,0 +1,38 @@
+#include <atomic>
+#include <cstdlib>
+#include "bench.hpp"
+#include "wal.hpp"
+
+int main() {
+	char name[] = "bench_wal_XXXXXX";
+	std::string dir = mkdtemp(name);
+	{
+		wal::Log log(dir, 2000000);
+		wal::Mutation trade = {wal::Op::Add, wal::entityKey("Ripley"), "Keycard"};
+		/* One fdatasync per action, what the log replaces. */
+		bench::report("wal_sync_per_action", bench::measure(100, [&](long) {
+			log.append(trade);
+			log.sync();
+		}));
+		/* A tick of 1000 actions committed as one group, reported per action. */
+		bench::report("wal_group_commit_per_action", bench::measure(20, [&](long) {
+			for (int i = 0; i < 1000; i++) log.append(trade);
+			log.sync();
+		}) / 1000);
+		/* Latency from the append until the acknowledgement, with the group window as the only trigger. */
+		std::atomic<std::uint64_t> latency(0);
+		for (int i = 0; i < 20; i++) {
+			std::uint64_t start = profiler::now();
+			std::atomic<bool> acked(false);
+			log.append(trade, [&] {
+				latency += profiler::now() - start;
+				acked = true;
+			});
+			while (!acked) std::this_thread::yield();
+		}
+		bench::report("wal_ack_latency", latency / 20.0);
+	}
+	for (auto const& f : wal::list(dir, "wal-", ".log")) unlink(f.second.c_str());
+	rmdir(dir.c_str());
+	return 0;
+}
@@ -0,0 +1,72 @@
+# Runs a benchmark and compares its results against a stored baseline.
+#
+# The benchmark prints one "<metric> <nanoseconds>" pair per line, the baseline file holds
+# the same format. The test fails if any metric is slower than TOLERANCE times its baseline
+# or if a baseline metric is missing from the output.
+# Run with -DUPDATE=ON to overwrite the baseline with the current results.
+
+if(NOT BENCHMARK OR NOT BASELINE)
+	message(FATAL_ERROR "usage: cmake -DBENCHMARK=<exe> -DBASELINE=<file> [-DTOLERANCE=<x>] [-DUPDATE=ON] -P CompareBaseline.cmake")
+endif()
+if(NOT TOLERANCE)
+	set(TOLERANCE 3.0)
+endif()
+
+execute_process(COMMAND ${BENCHMARK}
+	OUTPUT_VARIABLE output
+	RESULT_VARIABLE result
+	)
+if(NOT result EQUAL 0)
+	message(FATAL_ERROR "${BENCHMARK} exited with ${result}")
+endif()
+message("${output}")
+
+if(UPDATE OR NOT EXISTS ${BASELINE})
+	file(WRITE ${BASELINE} "${output}")
+	message(STATUS "Baseline written to ${BASELINE}")
+	return()
+endif()
+
+string(REPLACE "\n" ";" lines "${output}")
+foreach(line ${lines})
+	if(line MATCHES "^([A-Za-z0-9_]+)[ \t]+([0-9.]+)")
+		set(current_${CMAKE_MATCH_1} ${CMAKE_MATCH_2})
+	endif()
+endforeach()
+
+# cmake math() is integer only, compare in thousandths of the baseline.
+if(NOT TOLERANCE MATCHES "^([0-9]+)(\\.([0-9]*))?$")
+	message(FATAL_ERROR "TOLERANCE must be a positive number, got ${TOLERANCE}")
+endif()
+set(tolerance_int ${CMAKE_MATCH_1})
+string(SUBSTRING "${CMAKE_MATCH_3}000" 0 3 tolerance_frac)
+math(EXPR tolerance_milli "${tolerance_int} * 1000 + 1${tolerance_frac} - 1000")
+
+file(STRINGS ${BASELINE} baselines)
+set(failed FALSE)
+foreach(line ${baselines})
+	if(NOT line MATCHES "^([A-Za-z0-9_]+)[ \t]+([0-9.]+)")
+		continue()
+	endif()
+	set(metric ${CMAKE_MATCH_1})
+	set(expected ${CMAKE_MATCH_2})
+	if(NOT DEFINED current_${metric})
+		message(SEND_ERROR "${metric}: missing from benchmark output")
+		set(failed TRUE)
+		continue()
+	endif()
+	string(REGEX REPLACE "\\..*$" "" expected_int ${expected})
+	string(REGEX REPLACE "\\..*$" "" current_int ${current_${metric}})
+	math(EXPR limit "(${expected_int} + 1) * ${tolerance_milli}")
+	math(EXPR current_scaled "${current_int} * 1000")
+	if(current_scaled GREATER limit)
+		message(SEND_ERROR "${metric}: ${current_${metric}} ns, baseline ${expected} ns, tolerance ${TOLERANCE}x")
+		set(failed TRUE)
+	else()
+		message(STATUS "${metric}: ${current_${metric}} ns (baseline ${expected} ns)")
+	endif()
+endforeach()
+
+if(failed)
+	message(FATAL_ERROR "Benchmark regressed against ${BASELINE}")
+endif()
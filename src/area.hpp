@@ -0,0 +1,226 @@
+#ifndef AREA
+#define AREA
+/* Private copies of an area, one per party. Names, descriptions, links and the starting items of
+ * the rooms are built once and shared, an instance only holds what a party can change: the
+ * inventories, the occupants and the doors. Finished instances go back to a pool and are reused. */
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "engine.hpp"
+
+namespace area {
+
+/**
+ * @brief Immutable part of an area, shared by every instance.
+ *
+ */
+struct Layout {
+	std::vector<std::string> names;
+	std::vector<std::string> descriptions;
+	std::vector<std::uint32_t> offsets; // Links of room i are targets[offsets[i]] to targets[offsets[i + 1]], one door each.
+	std::vector<std::uint32_t> targets;
+	std::vector<std::vector<Prefab::Slot>> items; // Starting items of every room.
+	std::vector<std::uint8_t> locked; // Starting state of every door.
+	std::size_t size() const {return names.size();}
+	/**
+	 * @brief Find the door of a link.
+	 *
+	 * @param from (std::uint32_t) Index of the room.
+	 * @param to (std::uint32_t) Index of the neighbour.
+	 * @return std::size_t Index of the door, SIZE_MAX if the rooms are not linked.
+	 */
+	std::size_t door(std::uint32_t from, std::uint32_t to) const {
+		for (std::uint32_t e = offsets[from]; e < offsets[from + 1]; e++) {
+			if (targets[e] == to) return e;
+		}
+		return SIZE_MAX;
+	}
+};
+
+/**
+ * @typedef Shared, immutable area.
+ *
+ */
+typedef std::shared_ptr<const Layout> layout;
+
+/**
+ * @brief Build the layout of an area from template rooms. Links to rooms outside of the area are
+ * dropped, every door starts open.
+ *
+ * @param rooms (const nodes&) Rooms of the area.
+ * @return layout
+ */
+inline layout build(const nodes& rooms) {
+	std::shared_ptr<Layout> l(new Layout());
+	std::unordered_map<const Room*, std::uint32_t> index;
+	for (std::size_t i = 0; i < rooms.size(); i++) index.emplace(rooms[i].get(), i);
+	l->offsets.push_back(0);
+	for (node const& r : rooms) {
+		l->names.push_back(r->getName());
+		l->descriptions.push_back(r->getDescription());
+		for (node const& n : r->getNeighbours()) {
+			auto it = index.find(n.get());
+			if (it != index.end()) l->targets.push_back(it->second);
+		}
+		l->offsets.push_back(l->targets.size());
+		std::vector<Prefab::Slot> slots;
+		if (!r->isStocked()) {
+			slots = r->getPrefab()->layout;
+		} else {
+			for (item const& i : r->getItems()) {
+				const Key* k = dynamic_cast<const Key*>(i.get());
+				slots.push_back({i->getName(), k ? k->getKeyID() : std::string()});
+			}
+		}
+		l->items.push_back(std::move(slots));
+	}
+	l->locked.assign(l->targets.size(), 0);
+	return l;
+}
+
+/**
+ * @brief State of one private copy of an area.
+ *
+ */
+class Instance {
+	friend class InstancePool;
+	layout shared;
+	std::vector<items> inventories;
+	std::vector<std::uint8_t> stocked; // Whether the starting items of a room were created.
+	std::vector<int> occupants;
+	std::vector<std::uint8_t> locked;
+	/**
+	 * @brief Bring the instance back to the starting state, keeping the memory of the vectors.
+	 *
+	 */
+	void reset() {
+		for (items& i : inventories) i.clear();
+		stocked.assign(shared->size(), 0);
+		occupants.assign(shared->size(), 0);
+		locked = shared->locked;
+	}
+public:
+	Instance(const layout& l) : shared(l), inventories(l->size()) {reset();}
+	Instance(const Instance&) = delete;
+	Instance& operator=(const Instance&) = delete;
+	Layout const& getLayout() const {return *shared;}
+	std::size_t size() const {return shared->size();}
+	std::string const& getName(std::uint32_t r) const {return shared->names[r];}
+	std::string const& getDescription(std::uint32_t r) const {return shared->descriptions[r];}
+	/**
+	 * @brief Get the inventory of a room, its starting items are created on the first access.
+	 *
+	 * @param r (std::uint32_t) Index of the room.
+	 * @return items&
+	 */
+	items& getItems(std::uint32_t r) {
+		if (!stocked[r]) {
+			stocked[r] = 1;
+			for (Prefab::Slot const& s : shared->items[r]) {
+				inventories[r].push_back(item(s.keyID.empty() ? new Object(s.name) : new Key(s.name, s.keyID)));
+			}
+		}
+		return inventories[r];
+	}
+	int getOccupants(std::uint32_t r) const {return occupants[r];}
+	void enter(std::uint32_t r) {occupants[r]++;}
+	/**
+	 * @brief Leave a room.
+	 *
+	 * @return false if nobody was in the room.
+	 */
+	bool leave(std::uint32_t r) {
+		if (occupants[r] <= 0) return false;
+		occupants[r]--;
+		return true;
+	}
+	/**
+	 * @brief Whether the door from one room to another is locked.
+	 *
+	 * @return true if the door is locked or the rooms are not linked.
+	 */
+	bool isLocked(std::uint32_t from, std::uint32_t to) const {
+		std::size_t d = shared->door(from, to);
+		return d == SIZE_MAX || locked[d];
+	}
+	/**
+	 * @brief Lock or unlock the door from one room to another.
+	 *
+	 * @return false if the rooms are not linked.
+	 */
+	bool setLocked(std::uint32_t from, std::uint32_t to, bool l) {
+		std::size_t d = shared->door(from, to);
+		if (d == SIZE_MAX) return false;
+		locked[d] = l;
+		return true;
+	}
+	/**
+	 * @brief Move an occupant through an open door.
+	 *
+	 * @return false if the door is locked, the rooms are not linked or nobody is in the first room.
+	 */
+	bool move(std::uint32_t from, std::uint32_t to) {
+		if (isLocked(from, to) || !leave(from)) return false;
+		enter(to);
+		return true;
+	}
+};
+
+/**
+ * @brief Instances of one area. Released instances are reset and handed out again, so a busy
+ * area stops allocating instances.
+ *
+ */
+class InstancePool {
+	layout shared;
+	std::vector<std::unique_ptr<Instance>> instances;
+	std::vector<Instance*> available;
+public:
+	/**
+	 * @brief Construct a new Instance Pool object
+	 *
+	 * @param l (const layout&) The area.
+	 * @param n (std::size_t) Instances created up front.
+	 */
+	InstancePool(const layout& l, std::size_t n = 0) : shared(l) {
+		for (std::size_t i = 0; i < n; i++) {
+			instances.push_back(std::unique_ptr<Instance>(new Instance(shared)));
+			available.push_back(instances.back().get());
+		}
+	}
+	/**
+	 * @brief Get a fresh instance for a party.
+	 *
+	 * @return Instance* Owned by the pool, valid until release().
+	 */
+	Instance* acquire() {
+		if (available.empty()) {
+			instances.push_back(std::unique_ptr<Instance>(new Instance(shared)));
+			return instances.back().get();
+		}
+		Instance* i = available.back();
+		available.pop_back();
+		return i;
+	}
+	/**
+	 * @brief Give back an instance, whose party left. Its items are destroyed.
+	 *
+	 * @param i (Instance*) The instance.
+	 */
+	void release(Instance* i) {
+		i->reset();
+		available.push_back(i);
+	}
+	/**
+	 * @brief Number of instances created by the pool.
+	 *
+	 * @return std::size_t
+	 */
+	std::size_t size() const {return instances.size();}
+	std::size_t getAvailable() const {return available.size();}
+};
+
+}
+#endif
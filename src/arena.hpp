@@ -0,0 +1,98 @@
+#ifndef ARENA
+#define ARENA
+/* Bump allocator for short lived state. Allocation moves a pointer, reset() frees everything
+ * at once and keeps the blocks, so a reused arena stops touching the heap. */
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+/**
+ * @brief Bump allocator, that frees all of its allocations at once.
+ *
+ */
+class Arena {
+	std::vector<std::unique_ptr<unsigned char[]>> blocks;
+	std::vector<std::size_t> sizes; // Size of every block.
+	std::size_t current; // Index of the block allocations come from.
+	std::size_t offset; // Used bytes of the current block.
+	std::size_t blockSize;
+public:
+	/**
+	 * @brief Construct a new Arena object, no memory is taken until the first allocation.
+	 *
+	 * @param b (std::size_t) Size of a block.
+	 */
+	Arena(std::size_t b = 4096) : current(0), offset(0), blockSize(b ? b : 1) {}
+	Arena(const Arena&) = delete;
+	Arena& operator=(const Arena&) = delete;
+	/**
+	 * @brief Allocate raw, uninitialized memory.
+	 *
+	 * @param size (std::size_t) Bytes to allocate.
+	 * @param align (std::size_t) Alignment, at most alignof(std::max_align_t).
+	 * @return void*
+	 */
+	void* allocate(std::size_t size, std::size_t align = alignof(std::max_align_t)) {
+		while (current < blocks.size()) {
+			std::size_t aligned = (offset + align - 1) & ~(align - 1);
+			if (aligned + size <= sizes[current]) {
+				offset = aligned + size;
+				return blocks[current].get() + aligned;
+			}
+			current++;
+			offset = 0;
+		}
+		std::size_t s = size > blockSize ? size : blockSize;
+		blocks.push_back(std::unique_ptr<unsigned char[]>(new unsigned char[s]));
+		sizes.push_back(s);
+		current = blocks.size() - 1;
+		offset = size;
+		return blocks[current].get();
+	}
+	/**
+	 * @brief Construct a trivially destructible object in the arena.
+	 *
+	 * @param args (Args&&...) Arguments of the constructor.
+	 * @return T*
+	 */
+	template <typename T, typename... Args>
+	T* make(Args&&... args) {
+		static_assert(std::is_trivially_destructible<T>::value, "Arena never runs destructors.");
+		return new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+	}
+	/**
+	 * @brief Copy a string into the arena.
+	 *
+	 * @param s (const char*) The string.
+	 * @param n (std::size_t) Length of the string.
+	 * @return const char* Zero terminated copy.
+	 */
+	const char* copy(const char* s, std::size_t n) {
+		char* c = static_cast<char*>(allocate(n + 1, 1));
+		std::memcpy(c, s, n);
+		c[n] = 0;
+		return c;
+	}
+	/**
+	 * @brief Free every allocation, the blocks are kept for reuse.
+	 *
+	 */
+	void reset() {
+		current = 0;
+		offset = 0;
+	}
+	/**
+	 * @brief Bytes reserved in blocks.
+	 *
+	 * @return std::size_t
+	 */
+	std::size_t capacity() const {
+		std::size_t c = 0;
+		for (std::size_t s : sizes) c += s;
+		return c;
+	}
+};
+#endif
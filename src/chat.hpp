@@ -0,0 +1,131 @@
+#ifndef CHAT
+#define CHAT
+/* Room chat and shouts. Messages of a tick are collected per room and serialized once into a
+ * buffer of the room, every listener's outbound queue gets a reference to that buffer, so the
+ * cost of a message does not grow with the number of listeners. */
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "engine.hpp"
+#include "session.hpp"
+
+namespace chat {
+
+/**
+ * @brief Collects the messages of a tick and delivers them to the sessions in earshot.
+ *
+ */
+class Broadcaster {
+	/**
+	 * @brief Messages of one room in the current tick.
+	 *
+	 */
+	struct Batch {
+		const Room* room;
+		std::string local; // Heard in the room.
+		std::string shouts; // Heard in the room and in its neighbours.
+	};
+	std::unordered_map<const Room*, Batch> batches; // Rooms, that had messages, emptied by endTick() and kept with their buffers.
+	std::vector<Batch*> active; // Batches with messages in the current tick.
+	std::unordered_map<const Room*, std::vector<session::Session*>> listeners; // Sessions by room, refilled in place by flush().
+	std::size_t deliveries;
+	bool flushed; // Whether the batches were handed out in this tick, they must not grow until endTick().
+	Batch& batchOf(const Room& r) {
+		if (flushed) throw std::runtime_error("chat: message after the flush of the tick");
+		Batch& b = batches[&r];
+		if (b.local.empty() && b.shouts.empty()) {
+			b.room = &r;
+			active.push_back(&b);
+		}
+		return b;
+	}
+	void deliver(const Room* r, const std::string& text) {
+		auto it = listeners.find(r);
+		if (it == listeners.end()) return;
+		for (session::Session* s : it->second) s->sendShared(text.data(), text.size());
+		deliveries += it->second.size();
+	}
+public:
+	Broadcaster() : deliveries(0), flushed(false) {}
+	/**
+	 * @brief Say something, heard by everyone in the room.
+	 *
+	 * @param r (const Room&) The room of the speaker.
+	 * @param speaker (const std::string&) Name of the speaker.
+	 * @param text (const std::string&) The message.
+	 * @throws std::runtime_error if the tick was flushed already.
+	 */
+	void say(const Room& r, const std::string& speaker, const std::string& text) {
+		std::string& out = batchOf(r).local;
+		out += speaker;
+		out += " says: ";
+		out += text;
+		out += '\n';
+	}
+	/**
+	 * @brief Shout something, heard in the room and in its neighbours.
+	 *
+	 * @param r (const Room&) The room of the speaker.
+	 * @param speaker (const std::string&) Name of the speaker.
+	 * @param text (const std::string&) The message.
+	 * @throws std::runtime_error if the tick was flushed already.
+	 */
+	void shout(const Room& r, const std::string& speaker, const std::string& text) {
+		std::string& out = batchOf(r).shouts;
+		out += speaker;
+		out += " shouts from ";
+		out += r.getName();
+		out += ": ";
+		out += text;
+		out += '\n';
+	}
+	/**
+	 * @brief Number of rooms with messages in the current tick.
+	 *
+	 * @return std::size_t
+	 */
+	std::size_t pending() const {return active.size();}
+	/**
+	 * @brief Hand a reference to every batch to the sessions in earshot. The buffers stay valid
+	 * until endTick(), so the outbound text must be sent before. No message may be added until
+	 * then, it could move the buffers.
+	 *
+	 * @param sessions (session::Manager&) The sessions.
+	 * @return std::size_t Number of references handed out.
+	 */
+	std::size_t flush(session::Manager& sessions) {
+		deliveries = 0;
+		flushed = true;
+		if (active.empty()) return 0;
+		for (auto& l : listeners) l.second.clear();
+		sessions.forEach([this](session::Session& s) {
+			if (s.getRoom()) listeners[s.getRoom().get()].push_back(&s);
+		});
+		for (Batch* b : active) {
+			if (!b->local.empty()) deliver(b->room, b->local);
+			if (b->shouts.empty()) continue;
+			deliver(b->room, b->shouts);
+			for (node const& n : b->room->getNeighbours()) {
+				if (n.get() != b->room) deliver(n.get(), b->shouts);
+			}
+		}
+		return deliveries;
+	}
+	/**
+	 * @brief Drop the messages of the tick, called after the outbound text was sent. The buffers
+	 * are emptied and kept for the next messages of their room.
+	 *
+	 */
+	void endTick() {
+		for (Batch* b : active) {
+			b->local.clear();
+			b->shouts.clear();
+		}
+		active.clear();
+		flushed = false;
+	}
+};
+
+}
+#endif
@@ -0,0 +1,415 @@
+#ifndef COLUMNAR
+#define COLUMNAR
+/* Columnar dump of a World snapshot for offline analysis, in the style of Arrow IPC.
+ *
+ * A file is the magic "SWCOL002", a sequence of row groups and a footer. A row group holds some
+ * rows of one table, column after column:
+ *     u32 table name length, table name, u64 rows, u32 columns,
+ *     per column: u32 name length, name, u8 type, u64 byte length, bytes
+ * UInt32 and UInt8 columns are plain little endian arrays, String columns are rows + 1 u32 offsets
+ * followed by the characters. The footer lists every row group with the CRC32C of its bytes:
+ *     per group: u32 table name length, table name, u64 rows, u64 offset, u32 checksum
+ *     u32 group count, u64 footer offset, u32 checksum of the footer before it, "SWCOLEND"
+ * The Reader verifies every checksum when it opens a file, the row groups in parallel.
+ * Tables: rooms(id, name, items, keys), edges(from, to), items(room, name, key), key is the id of a
+ * Key and empty for other objects. */
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "crc32c.hpp"
+#include "engine.hpp"
+
+namespace columnar {
+
+enum class Type : std::uint8_t {
+	UInt32 = 1,
+	UInt8 = 2,
+	String = 3
+};
+
+template <typename T>
+inline void append(std::string& out, T v) {
+	out.append(reinterpret_cast<const char*>(&v), sizeof(v));
+}
+
+inline void appendName(std::string& out, const std::string& name) {
+	append<std::uint32_t>(out, name.size());
+	out += name;
+}
+
+/**
+ * @brief Builds the bytes of one row group.
+ *
+ */
+class RowGroup {
+	std::string bytes;
+	std::size_t columnsAt; // Position of the column count.
+	std::uint32_t columns;
+public:
+	RowGroup(const std::string& table, std::uint64_t rows) : columns(0) {
+		appendName(bytes, table);
+		append(bytes, rows);
+		columnsAt = bytes.size();
+		append<std::uint32_t>(bytes, 0);
+	}
+	template <typename T>
+	RowGroup& numbers(const std::string& name, const std::vector<T>& values) {
+		appendName(bytes, name);
+		append(bytes, static_cast<std::uint8_t>(sizeof(T) == 1 ? Type::UInt8 : Type::UInt32));
+		append<std::uint64_t>(bytes, values.size() * sizeof(T));
+		bytes.append(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(T));
+		columns++;
+		return *this;
+	}
+	RowGroup& strings(const std::string& name, const std::vector<const std::string*>& values) {
+		appendName(bytes, name);
+		append(bytes, static_cast<std::uint8_t>(Type::String));
+		std::uint64_t length = (values.size() + 1) * sizeof(std::uint32_t);
+		for (const std::string* v : values) length += v->size();
+		append(bytes, length);
+		std::uint32_t offset = 0;
+		append(bytes, offset);
+		for (const std::string* v : values) append(bytes, offset += v->size());
+		for (const std::string* v : values) bytes += *v;
+		columns++;
+		return *this;
+	}
+	/**
+	 * @brief Finish the row group.
+	 *
+	 * @return std::string The encoded bytes.
+	 */
+	std::string finish() {
+		std::memcpy(&bytes[columnsAt], &columns, sizeof(columns));
+		return std::move(bytes);
+	}
+};
+
+/**
+ * @brief Streams a snapshot into a columnar file. Row groups are encoded by background jobs,
+ * at most maxInFlight of them are held in memory, and written in order.
+ *
+ */
+class Writer {
+	struct Pending {
+		std::string table;
+		std::uint64_t rows;
+		std::shared_ptr<std::string> bytes;
+		std::shared_ptr<std::uint32_t> checksum;
+		jobs::handle job;
+	};
+	struct Group {
+		std::string table;
+		std::uint64_t rows;
+		std::uint64_t offset;
+		std::uint32_t checksum;
+	};
+	std::ofstream out;
+	std::string path;
+	jobs::Pool* pool;
+	std::size_t rowsPerGroup;
+	std::size_t maxInFlight;
+	std::deque<Pending> inFlight;
+	std::vector<Group> groups;
+	std::uint64_t written;
+	/**
+	 * @brief Close the file and throw, if a write failed.
+	 *
+	 */
+	void check() {
+		if (out) return;
+		out.close();
+		inFlight.clear();
+		throw std::runtime_error("columnar: cannot write " + path);
+	}
+	void writeOldest() {
+		Pending& p = inFlight.front();
+		if (p.job) p.job->wait();
+		groups.push_back({p.table, p.rows, written, *p.checksum});
+		out.write(p.bytes->data(), p.bytes->size());
+		written += p.bytes->size();
+		inFlight.pop_front();
+		check();
+	}
+	void submit(const std::string& table, std::uint64_t rows, std::function<std::string()> encode) {
+		if (inFlight.size() >= maxInFlight) writeOldest();
+		std::shared_ptr<std::string> bytes(new std::string());
+		std::shared_ptr<std::uint32_t> checksum(new std::uint32_t(0));
+		auto work = [bytes, checksum, encode] {
+			*bytes = encode();
+			*checksum = crc32c::compute(bytes->data(), bytes->size());
+		};
+		jobs::handle job;
+		if (pool) {
+			job = pool->submit("columnar_encode", jobs::Priority::Low, work);
+		} else {
+			work();
+		}
+		inFlight.push_back({table, rows, bytes, checksum, job});
+	}
+public:
+	/**
+	 * @brief Construct a new Writer object
+	 *
+	 * @param path (const std::string&) The file.
+	 * @param p (jobs::Pool*) Pool of the encoders, null encodes on the calling thread.
+	 * @param rows (std::size_t) Rooms per row group.
+	 * @param inflight (std::size_t) Row groups held in memory at most.
+	 * @throws std::runtime_error if the file cannot be opened.
+	 */
+	Writer(const std::string& path, jobs::Pool* p = nullptr, std::size_t rows = 65536, std::size_t inflight = 8)
+		: out(path, std::ios::binary | std::ios::trunc), path(path), pool(p), rowsPerGroup(rows ? rows : 1), maxInFlight(inflight ? inflight : 1), written(0) {
+		if (!out) throw std::runtime_error("columnar: cannot open " + path);
+		out.write("SWCOL002", 8);
+		written = 8;
+		check();
+	}
+	/**
+	 * @brief Destroy the Writer object, closing the file. Errors, also of the encoders, are only
+	 * reported by an explicit close().
+	 *
+	 */
+	~Writer() {
+		if (!out.is_open()) return;
+		try {
+			close();
+		} catch (...) {}
+	}
+	/**
+	 * @brief Append the rooms, edges and items tables of a snapshot.
+	 *
+	 * @param s (const snapshot&) The snapshot, it has to stay alive until close().
+	 * @throws std::runtime_error if a row group cannot be written.
+	 */
+	void write(const snapshot& s) {
+		const std::vector<RoomView>& rooms = *s;
+		for (std::size_t begin = 0; begin < rooms.size(); begin += rowsPerGroup) {
+			std::size_t end = std::min(rooms.size(), begin + rowsPerGroup);
+			std::uint64_t edges = 0;
+			std::uint64_t items = 0;
+			for (std::size_t i = begin; i < end; i++) {
+				edges += rooms[i].neighbours.size();
+				items += rooms[i].items.size();
+			}
+			submit("rooms", end - begin, [s, begin, end] {
+				std::vector<std::uint32_t> ids, itemCounts, keyCounts;
+				std::vector<const std::string*> names;
+				for (std::size_t i = begin; i < end; i++) {
+					RoomView const& r = (*s)[i];
+					ids.push_back(i);
+					names.push_back(&r.name);
+					itemCounts.push_back(r.items.size());
+					keyCounts.push_back(r.keys);
+				}
+				return RowGroup("rooms", end - begin).numbers("id", ids).strings("name", names)
+					.numbers("items", itemCounts).numbers("keys", keyCounts).finish();
+			});
+			if (edges) submit("edges", edges, [s, begin, end, edges] {
+				std::vector<std::uint32_t> from, to;
+				for (std::size_t i = begin; i < end; i++) {
+					for (std::size_t n : (*s)[i].neighbours) {
+						from.push_back(i);
+						to.push_back(n);
+					}
+				}
+				return RowGroup("edges", edges).numbers("from", from).numbers("to", to).finish();
+			});
+			if (items) submit("items", items, [s, begin, end, items] {
+				std::vector<std::uint32_t> room;
+				std::vector<const std::string*> names, keys;
+				static const std::string none;
+				for (std::size_t i = begin; i < end; i++) {
+					RoomView const& r = (*s)[i];
+					for (std::size_t j = 0; j < r.items.size(); j++) {
+						room.push_back(i);
+						names.push_back(&r.items[j]);
+						keys.push_back(j < r.keyIDs.size() ? &r.keyIDs[j] : &none);
+					}
+				}
+				return RowGroup("items", items).numbers("room", room).strings("name", names).strings("key", keys).finish();
+			});
+		}
+	}
+	/**
+	 * @brief Write the pending row groups and the footer.
+	 *
+	 * @throws std::runtime_error if the file cannot be written.
+	 */
+	void close() {
+		while (!inFlight.empty()) writeOldest();
+		std::string footer;
+		for (Group const& g : groups) {
+			appendName(footer, g.table);
+			append(footer, g.rows);
+			append(footer, g.offset);
+			append(footer, g.checksum);
+		}
+		append<std::uint32_t>(footer, groups.size());
+		append(footer, written);
+		append(footer, crc32c::compute(footer.data(), footer.size()));
+		footer += "SWCOLEND";
+		out.write(footer.data(), footer.size());
+		check();
+		out.close();
+		if (out.fail()) throw std::runtime_error("columnar: cannot write " + path);
+	}
+};
+
+/**
+ * @brief Reads whole columns of a columnar file.
+ *
+ */
+class Reader {
+	std::string data;
+	struct Group {
+		std::string table;
+		std::uint64_t rows;
+		std::uint64_t offset;
+		std::uint32_t checksum;
+	};
+	std::vector<Group> groups;
+	std::uint64_t footerOffset;
+	template <typename T>
+	T read(std::size_t& pos) const {
+		if (pos + sizeof(T) > data.size()) throw std::runtime_error("columnar: truncated file");
+		T v;
+		std::memcpy(&v, &data[pos], sizeof(T));
+		pos += sizeof(T);
+		return v;
+	}
+	std::string readName(std::size_t& pos) const {
+		std::uint32_t n = read<std::uint32_t>(pos);
+		if (pos + n > data.size()) throw std::runtime_error("columnar: truncated file");
+		pos += n;
+		return data.substr(pos - n, n);
+	}
+	/**
+	 * @brief Find a column in every row group of a table.
+	 *
+	 * @return std::vector<std::pair<std::size_t, std::uint64_t>> Position and byte length per group.
+	 */
+	std::vector<std::pair<std::size_t, std::uint64_t>> locate(const std::string& table, const std::string& column, Type type) const {
+		std::vector<std::pair<std::size_t, std::uint64_t>> found;
+		for (Group const& g : groups) {
+			if (g.table != table) continue;
+			std::size_t pos = g.offset;
+			readName(pos);
+			read<std::uint64_t>(pos);
+			std::uint32_t columns = read<std::uint32_t>(pos);
+			for (std::uint32_t c = 0; c < columns; c++) {
+				std::string name = readName(pos);
+				Type t = static_cast<Type>(read<std::uint8_t>(pos));
+				std::uint64_t length = read<std::uint64_t>(pos);
+				if (name == column) {
+					if (t != type) throw std::runtime_error("columnar: " + table + "." + column + " has another type");
+					found.push_back(std::make_pair(pos, length));
+					break;
+				}
+				pos += length;
+			}
+		}
+		return found;
+	}
+	/**
+	 * @brief Whether the bytes of a row group match their checksum.
+	 *
+	 */
+	bool intact(std::size_t i) const {
+		std::uint64_t end = i + 1 < groups.size() ? groups[i + 1].offset : footerOffset;
+		return crc32c::compute(&data[groups[i].offset], end - groups[i].offset) == groups[i].checksum;
+	}
+public:
+	/**
+	 * @brief Construct a new Reader object and verify the checksums of the file.
+	 *
+	 * @param path (const std::string&) The file.
+	 * @param pool (jobs::Pool*) Pool, that verifies the row groups in parallel, null verifies on the calling thread.
+	 * @throws std::runtime_error if the file is not a columnar file or a checksum does not match.
+	 */
+	Reader(const std::string& path, jobs::Pool* pool = nullptr) {
+		std::ifstream in(path, std::ios::binary);
+		data.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+		if (data.size() < 32 || data.compare(0, 8, "SWCOL002") || data.compare(data.size() - 8, 8, "SWCOLEND")) {
+			throw std::runtime_error("columnar: " + path + " is not a columnar file");
+		}
+		std::size_t pos = data.size() - 24;
+		std::uint32_t count = read<std::uint32_t>(pos);
+		footerOffset = read<std::uint64_t>(pos);
+		std::uint32_t checksum = read<std::uint32_t>(pos);
+		if (footerOffset < 8 || footerOffset > data.size() - 24
+			|| crc32c::compute(&data[footerOffset], data.size() - 12 - footerOffset) != checksum) {
+			throw std::runtime_error("columnar: footer of " + path + " is corrupt");
+		}
+		pos = footerOffset;
+		for (std::uint32_t i = 0; i < count; i++) {
+			Group g;
+			g.table = readName(pos);
+			g.rows = read<std::uint64_t>(pos);
+			g.offset = read<std::uint64_t>(pos);
+			g.checksum = read<std::uint32_t>(pos);
+			groups.push_back(g);
+		}
+		for (std::size_t i = 0; i < groups.size(); i++) {
+			std::uint64_t end = i + 1 < groups.size() ? groups[i + 1].offset : footerOffset;
+			if (groups[i].offset < 8 || groups[i].offset > end) throw std::runtime_error("columnar: footer of " + path + " is corrupt");
+		}
+		std::vector<std::uint8_t> ok(groups.size(), 1);
+		if (pool && groups.size() > 1) {
+			std::vector<jobs::handle> checks;
+			for (std::size_t i = 0; i < groups.size(); i++) {
+				checks.push_back(pool->submit("columnar_verify", jobs::Priority::Normal, [this, &ok, i] {ok[i] = intact(i);}));
+			}
+			for (jobs::handle const& c : checks) c->wait();
+		} else {
+			for (std::size_t i = 0; i < groups.size(); i++) ok[i] = intact(i);
+		}
+		for (std::size_t i = 0; i < groups.size(); i++) {
+			if (!ok[i]) throw std::runtime_error("columnar: row group " + std::to_string(i) + " (" + groups[i].table + ") of " + path + " is corrupt");
+		}
+	}
+	/**
+	 * @brief Number of rows of a table.
+	 *
+	 * @param table (const std::string&) Name of the table.
+	 * @return std::uint64_t
+	 */
+	std::uint64_t rows(const std::string& table) const {
+		std::uint64_t n = 0;
+		for (Group const& g : groups) {
+			if (g.table == table) n += g.rows;
+		}
+		return n;
+	}
+	std::vector<std::uint32_t> readUInt32(const std::string& table, const std::string& column) const {
+		std::vector<std::uint32_t> values;
+		for (auto const& c : locate(table, column, Type::UInt32)) {
+			std::size_t n = values.size();
+			values.resize(n + c.second / sizeof(std::uint32_t));
+			std::memcpy(values.data() + n, &data[c.first], c.second);
+		}
+		return values;
+	}
+	std::vector<std::string> readStrings(const std::string& table, const std::string& column) const {
+		std::vector<std::string> values;
+		for (auto const& c : locate(table, column, Type::String)) {
+			std::size_t pos = c.first;
+			std::vector<std::uint32_t> offsets;
+			while (true) {
+				offsets.push_back(read<std::uint32_t>(pos));
+				if (pos - c.first + offsets.back() >= c.second) break;
+			}
+			for (std::size_t i = 0; i + 1 < offsets.size(); i++) {
+				values.push_back(data.substr(pos + offsets[i], offsets[i + 1] - offsets[i]));
+			}
+		}
+		return values;
+	}
+};
+
+}
+#endif
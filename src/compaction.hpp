@@ -0,0 +1,141 @@
+#ifndef COMPACTION
+#define COMPACTION
+/* Compaction of a write ahead log directory. The closed segments are folded into the newest base
+ * one segment at a time, which sorts the state by target and drops the mutations later ones undid,
+ * the result is written as a new base and the folded segments are deleted. The open segment is
+ * never touched, so appends go on while the compactor runs. */
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include "wal.hpp"
+
+namespace compaction {
+
+/**
+ * @brief Outcome of one compaction.
+ *
+ */
+struct Result {
+	std::size_t segments; // Segments folded and deleted.
+	std::size_t mutations; // Mutations folded.
+	std::uint64_t base; // Sequence of the base afterwards.
+	std::size_t targets; // Rooms and entities with items in the base.
+	bool corrupt; // A closed segment held a damaged record, it and the later ones were kept.
+};
+
+/**
+ * @brief Fold every closed segment of a log directory into a new base. Memory is bounded by the
+ * state and one segment. A closed segment, that does not decode to its end, is damaged and never
+ * deleted, only the segments before it are folded.
+ *
+ * @param dir (const std::string&) The log directory.
+ * @return Result
+ * @throws std::runtime_error if the new base cannot be written.
+ */
+inline Result compact(const std::string& dir) {
+	Result result = {0, 0, 0, 0, false};
+	wal::State state;
+	auto bases = wal::list(dir, "base-", ".snap");
+	for (auto it = bases.rbegin(); it != bases.rend(); it++) {
+		if (wal::readBase(it->second, state, result.base)) break;
+		state.clear();
+		result.base = 0;
+	}
+	auto segments = wal::list(dir, "wal-", ".log");
+	if (!segments.empty()) segments.pop_back(); // The newest segment may be open.
+	std::uint64_t last = result.base;
+	for (std::size_t i = 0; i < segments.size(); i++) {
+		std::string data = wal::readFile(segments[i].second);
+		if (wal::validLength(data) != data.size()) {
+			segments.resize(i);
+			result.corrupt = true;
+			break;
+		}
+		wal::Decoder d(data);
+		std::uint64_t sequence;
+		wal::Mutation m;
+		while (d.next(sequence, m)) {
+			if (sequence <= last) continue;
+			wal::applyMutation(state, m);
+			last = sequence;
+			result.mutations++;
+		}
+	}
+	result.targets = state.size();
+	if (segments.empty()) return result;
+	if (last > result.base) wal::writeBase(dir, state, last);
+	result.base = last;
+	for (auto const& seg : segments) unlink(seg.second.c_str());
+	for (auto const& b : bases) {
+		if (b.first < last) unlink(b.second.c_str());
+	}
+	wal::syncDirectory(dir);
+	result.segments = segments.size();
+	return result;
+}
+
+/**
+ * @brief Compacts a log directory on a background thread, whenever enough segments were closed.
+ *
+ */
+class Compactor {
+	std::string dir;
+	std::size_t minSegments;
+	std::chrono::milliseconds interval;
+	std::mutex stopMutex;
+	std::condition_variable stopped;
+	bool stopping;
+	std::atomic<std::uint64_t> runs;
+	std::atomic<std::uint64_t> folded;
+	std::thread worker;
+	void loop() {
+		std::unique_lock<std::mutex> lock(stopMutex);
+		while (!stopped.wait_for(lock, interval, [this] {return stopping;})) {
+			lock.unlock();
+			if (wal::list(dir, "wal-", ".log").size() > minSegments) {
+				try {
+					folded += compact(dir).segments;
+					runs++;
+				} catch (const std::runtime_error&) {
+					/* The segments are kept, the next round tries again. */
+				}
+			}
+			lock.lock();
+		}
+	}
+public:
+	/**
+	 * @brief Construct a new Compactor object and start its thread.
+	 *
+	 * @param d (const std::string&) The log directory.
+	 * @param segments (std::size_t) Closed segments, that trigger a compaction.
+	 * @param i (std::chrono::milliseconds) Time between two checks.
+	 */
+	Compactor(const std::string& d, std::size_t segments = 4, std::chrono::milliseconds i = std::chrono::milliseconds(1000))
+		: dir(d), minSegments(segments ? segments : 1), interval(i), stopping(false), runs(0), folded(0) {
+		worker = std::thread([this] {loop();});
+	}
+	Compactor(const Compactor&) = delete;
+	Compactor& operator=(const Compactor&) = delete;
+	~Compactor() {
+		{
+			std::lock_guard<std::mutex> lock(stopMutex);
+			stopping = true;
+		}
+		stopped.notify_one();
+		worker.join();
+	}
+	std::uint64_t getRuns() const {return runs.load();}
+	/**
+	 * @brief Number of segments folded so far.
+	 *
+	 * @return std::uint64_t
+	 */
+	std::uint64_t getFolded() const {return folded.load();}
+};
+
+}
+#endif
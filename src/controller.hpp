@@ -0,0 +1,188 @@
+#ifndef CONTROLLER
+#define CONTROLLER
+/* Load shedding controller. It watches the length of the ticks and defers non-critical
+ * subsystems, so the critical ones stay on schedule when a shard is overloaded. */
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "metrics.hpp"
+
+namespace load {
+
+/**
+ * @brief How important a subsystem is, lower priorities are shed first.
+ *
+ */
+enum class Priority {
+	Critical, // Never shed, e.g. movement and combat.
+	Normal, // Shed when shedding Low was not enough.
+	Low // Shed first, e.g. description decoding or far replication.
+};
+
+/**
+ * @brief Bookkeeping of one controlled subsystem.
+ *
+ */
+struct Subsystem {
+	std::string name;
+	Priority priority;
+	std::uint64_t budget; // Nanoseconds the subsystem may spend in a tick, 0 is unlimited.
+	double average; // Moving average of the nanoseconds spent per run.
+	unsigned deferred; // Ticks since the subsystem last ran.
+	std::uint64_t shedTotal; // Number of ticks, in which it was shed.
+	metrics::Counter* shedCounter; // Null until metrics are attached.
+};
+
+/**
+ * @brief Sheds subsystems by priority and budget when the ticks are longer than the tick budget.
+ *
+ * The shedding level goes up by one after overloadTicks ticks over the budget and down by one
+ * after the same number of ticks under 70% of the budget. At level 1 Low subsystems are shed,
+ * at level 2 Normal ones too. Independently of the level, a non-critical subsystem, that runs over
+ * its own budget, is deferred while the tick is over budget. A deferred subsystem is forced to run
+ * after maxDeferred ticks, so nothing starves.
+ *
+ */
+class Controller {
+	std::vector<Subsystem> subsystems;
+	std::uint64_t tickBudget; // Target length of a tick in nanoseconds, 0 disables shedding.
+	double tickAverage; // Moving average of the tick length.
+	int level;
+	unsigned overTicks; // Consecutive ticks over the budget.
+	unsigned underTicks; // Consecutive ticks well under the budget.
+	unsigned overloadTicks;
+	unsigned maxDeferred;
+	std::vector<std::size_t> shed; // Subsystems shed in the current tick.
+	metrics::Registry* registry; // Null until metrics are attached.
+	metrics::Gauge* levelGauge;
+	metrics::Counter* shedCounter(const std::string& name) {
+		return &registry->counter("spacewalk_shed_total{subsystem=\"" + name + "\"}", "Ticks, in which a subsystem was shed.");
+	}
+	static constexpr double smoothing = 0.2;
+public:
+	/**
+	 * @brief Construct a new Controller object
+	 *
+	 * @param budget (std::uint64_t) Target length of a tick in nanoseconds, 0 disables shedding.
+	 * @param overload (unsigned) Consecutive ticks needed to change the shedding level.
+	 * @param maxDefer (unsigned) Ticks after which a deferred subsystem runs anyway.
+	 */
+	Controller(std::uint64_t budget = 0, unsigned overload = 3, unsigned maxDefer = 10) : tickBudget(budget), tickAverage(0),
+		level(0), overTicks(0), underTicks(0), overloadTicks(overload ? overload : 1), maxDeferred(maxDefer), registry(nullptr), levelGauge(nullptr) {}
+	Controller& setTickBudget(std::uint64_t budget) {
+		tickBudget = budget;
+		return *this;
+	}
+	std::uint64_t getTickBudget() const {return tickBudget;}
+	/**
+	 * @brief Register a subsystem.
+	 *
+	 * @param name (const std::string&) Name of the subsystem.
+	 * @param p (Priority) Priority of the subsystem.
+	 * @param budget (std::uint64_t) Nanoseconds it may spend in a tick, 0 is unlimited.
+	 * @return std::size_t The id of the subsystem.
+	 */
+	std::size_t add(const std::string& name, Priority p, std::uint64_t budget = 0) {
+		subsystems.push_back({name, p, budget, 0, 0, 0, registry ? shedCounter(name) : nullptr});
+		return subsystems.size() - 1;
+	}
+	/**
+	 * @brief Decide whether a subsystem runs in this tick, records it as shed otherwise.
+	 *
+	 * @param id (std::size_t) Id of the subsystem.
+	 * @return true if the subsystem should run.
+	 */
+	bool shouldRun(std::size_t id) {
+		Subsystem& s = subsystems[id];
+		bool run = true;
+		if (tickBudget && s.priority != Priority::Critical && s.deferred < maxDeferred) {
+			if (level >= (s.priority == Priority::Low ? 1 : 2)) {
+				run = false;
+			} else if (s.budget && s.average > s.budget && tickAverage > tickBudget) {
+				run = false;
+			}
+		}
+		if (run) {
+			s.deferred = 0;
+		} else {
+			s.deferred++;
+			s.shedTotal++;
+			if (s.shedCounter) s.shedCounter->inc();
+			shed.push_back(id);
+		}
+		return run;
+	}
+	/**
+	 * @brief Record the time a subsystem spent in this tick.
+	 *
+	 * @param id (std::size_t) Id of the subsystem.
+	 * @param ns (std::uint64_t) Nanoseconds spent.
+	 */
+	void record(std::size_t id, std::uint64_t ns) {
+		Subsystem& s = subsystems[id];
+		s.average = s.average ? s.average + smoothing * (ns - s.average) : ns;
+	}
+	/**
+	 * @brief Start a new tick, forgetting what was shed in the previous one.
+	 *
+	 */
+	void beginTick() {shed.clear();}
+	/**
+	 * @brief Feed the length of the finished tick and adjust the shedding level.
+	 *
+	 * @param ns (std::uint64_t) Length of the tick in nanoseconds.
+	 */
+	void endTick(std::uint64_t ns) {
+		tickAverage = tickAverage ? tickAverage + smoothing * (ns - tickAverage) : ns;
+		if (!tickBudget) return;
+		if (ns > tickBudget) {
+			underTicks = 0;
+			if (++overTicks >= overloadTicks && level < 2) {
+				level++;
+				overTicks = 0;
+			}
+		} else if (ns < tickBudget * 0.7) {
+			overTicks = 0;
+			if (++underTicks >= overloadTicks && level > 0) {
+				level--;
+				underTicks = 0;
+			}
+		} else {
+			overTicks = 0;
+			underTicks = 0;
+		}
+		if (levelGauge) levelGauge->set(level);
+	}
+	/**
+	 * @brief Get the shedding level, 0 is nothing, 1 is Low and 2 is Low and Normal.
+	 *
+	 * @return int
+	 */
+	int getLevel() const {return level;}
+	/**
+	 * @brief Get the names of the subsystems shed in the current or last tick.
+	 *
+	 * @return std::vector<std::string>
+	 */
+	std::vector<std::string> getShed() const {
+		std::vector<std::string> names;
+		for (std::size_t id : shed) names.push_back(subsystems[id].name);
+		return names;
+	}
+	std::vector<Subsystem> const& getSubsystems() const {return subsystems;}
+	/**
+	 * @brief Export the shedding level and shed counts per subsystem, also of subsystems added later.
+	 *
+	 * @param r (metrics::Registry&) The registry, it must outlive the Controller.
+	 */
+	void attachMetrics(metrics::Registry& r) {
+		registry = &r;
+		levelGauge = &r.gauge("spacewalk_shed_level", "Load shedding level, 0 is none, 1 is low and 2 is low and normal priority.");
+		for (Subsystem& s : subsystems) {
+			s.shedCounter = shedCounter(s.name);
+		}
+	}
+};
+
+}
+#endif
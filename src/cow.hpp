@@ -0,0 +1,101 @@
+#ifndef COW
+#define COW
+/* Copy on write storage of forked World state. Copies share fixed size chunks of elements, so
+ * copying costs a pointer per chunk and a write copies only the chunk it lands in. */
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <vector>
+
+namespace cow {
+
+/**
+ * @brief Vector, whose copies share fixed size chunks until they are written to.
+ *
+ * @tparam T Type of the elements.
+ * @tparam N Elements per chunk.
+ */
+template <typename T, std::size_t N = 64>
+class Chunked {
+	typedef std::vector<T> Chunk;
+	std::vector<std::shared_ptr<Chunk>> chunks;
+	std::vector<T*> heads; // First element of every chunk, so reading skips the shared pointer.
+	std::size_t count;
+public:
+	/**
+	 * @brief Iterator over the elements, read only.
+	 *
+	 */
+	class const_iterator {
+		const Chunked* owner;
+		std::size_t i;
+		const T* p; // The element at i, null at the end.
+	public:
+		typedef std::forward_iterator_tag iterator_category;
+		typedef T value_type;
+		typedef std::ptrdiff_t difference_type;
+		typedef const T* pointer;
+		typedef const T& reference;
+		const_iterator(const Chunked* o, std::size_t at) : owner(o), i(at), p(at < o->count ? &(*o)[at] : nullptr) {}
+		reference operator*() const {return *p;}
+		pointer operator->() const {return p;}
+		const_iterator& operator++() {
+			i++;
+			if (i % N) {
+				p++;
+			} else {
+				p = i < owner->count ? owner->heads[i / N] : nullptr;
+			}
+			return *this;
+		}
+		bool operator==(const const_iterator& o) const {return i == o.i;}
+		bool operator!=(const const_iterator& o) const {return i != o.i;}
+	};
+	Chunked() : count(0) {}
+	std::size_t size() const {return count;}
+	bool empty() const {return !count;}
+	T const& operator[](std::size_t i) const {return heads[i / N][i % N];}
+	const_iterator begin() const {return const_iterator(this, 0);}
+	const_iterator end() const {return const_iterator(this, count);}
+	/**
+	 * @brief Get an element for writing, its chunk is copied first, if another copy shares it.
+	 *
+	 * @param i (std::size_t) Index of the element.
+	 * @return T&
+	 */
+	T& mutate(std::size_t i) {
+		std::shared_ptr<Chunk>& c = chunks[i / N];
+		if (c.use_count() > 1) {
+			c.reset(new Chunk(*c));
+			heads[i / N] = c->data();
+		}
+		return (*c)[i % N];
+	}
+	void push_back(T v) {
+		if (count % N == 0) {
+			chunks.push_back(std::shared_ptr<Chunk>(new Chunk()));
+			chunks.back()->reserve(N);
+		} else if (chunks.back().use_count() > 1) {
+			chunks.back().reset(new Chunk(*chunks.back()));
+		}
+		chunks.back()->push_back(std::move(v));
+		if (heads.size() < chunks.size()) heads.push_back(nullptr);
+		heads.back() = chunks.back()->data();
+		count++;
+	}
+	/**
+	 * @brief Number of chunks, that are not shared with another copy.
+	 *
+	 * @return std::size_t
+	 */
+	std::size_t owned() const {
+		std::size_t n = 0;
+		for (auto const& c : chunks) {
+			if (c.use_count() == 1) n++;
+		}
+		return n;
+	}
+};
+
+}
+#endif
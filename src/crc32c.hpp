@@ -0,0 +1,115 @@
+#ifndef CRC32C
+#define CRC32C
+/* CRC32C (Castagnoli) checksums of saved data. On x86 processors with SSE4.2 the crc32
+ * instruction computes 8 bytes per step, elsewhere a slicing by 8 table does. Both give the same
+ * checksums, so files move freely between machines. */
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <nmmintrin.h>
+#define CRC32C_HARDWARE 1
+#endif
+
+namespace crc32c {
+
+/**
+ * @brief Lookup tables of the software checksum, table[k][b] is the checksum of byte b followed
+ * by k zero bytes.
+ *
+ */
+struct Tables {
+	std::uint32_t table[8][256];
+	Tables() {
+		for (std::uint32_t b = 0; b < 256; b++) {
+			std::uint32_t c = b;
+			for (int k = 0; k < 8; k++) c = c & 1 ? (c >> 1) ^ 0x82F63B78u : c >> 1;
+			table[0][b] = c;
+		}
+		for (std::uint32_t b = 0; b < 256; b++) {
+			for (int k = 1; k < 8; k++) table[k][b] = (table[k - 1][b] >> 8) ^ table[0][table[k - 1][b] & 0xFF];
+		}
+	}
+};
+
+inline const Tables& tables() {
+	static const Tables t;
+	return t;
+}
+
+/**
+ * @brief Extend a checksum with the portable table implementation.
+ *
+ * @param crc (std::uint32_t) Checksum of the preceding data, 0 to start.
+ * @param data (const void*) The data.
+ * @param n (std::size_t) Its length.
+ * @return std::uint32_t
+ */
+inline std::uint32_t software(std::uint32_t crc, const void* data, std::size_t n) {
+	const std::uint32_t (*t)[256] = tables().table;
+	const unsigned char* p = static_cast<const unsigned char*>(data);
+	crc = ~crc;
+	for (; n >= 8; n -= 8, p += 8) {
+		std::uint32_t lo, hi;
+		std::memcpy(&lo, p, 4);
+		std::memcpy(&hi, p + 4, 4);
+		lo ^= crc;
+		crc = t[7][lo & 0xFF] ^ t[6][(lo >> 8) & 0xFF] ^ t[5][(lo >> 16) & 0xFF] ^ t[4][lo >> 24]
+			^ t[3][hi & 0xFF] ^ t[2][(hi >> 8) & 0xFF] ^ t[1][(hi >> 16) & 0xFF] ^ t[0][hi >> 24];
+	}
+	for (; n; n--, p++) crc = (crc >> 8) ^ t[0][(crc ^ *p) & 0xFF];
+	return ~crc;
+}
+
+#ifdef CRC32C_HARDWARE
+/**
+ * @brief Extend a checksum with the SSE4.2 crc32 instruction. Only call it if available() is true.
+ *
+ */
+__attribute__((target("sse4.2"))) inline std::uint32_t hardware(std::uint32_t crc, const void* data, std::size_t n) {
+	const unsigned char* p = static_cast<const unsigned char*>(data);
+	std::uint64_t c = ~crc;
+	for (; n >= 8; n -= 8, p += 8) {
+		std::uint64_t v;
+		std::memcpy(&v, p, 8);
+		c = _mm_crc32_u64(c, v);
+	}
+	std::uint32_t c32 = c;
+	for (; n; n--, p++) c32 = _mm_crc32_u8(c32, *p);
+	return ~c32;
+}
+#endif
+
+/**
+ * @brief Whether the processor computes checksums in hardware.
+ *
+ * @return bool
+ */
+inline bool available() {
+#ifdef CRC32C_HARDWARE
+	static const bool sse42 = __builtin_cpu_supports("sse4.2");
+	return sse42;
+#else
+	return false;
+#endif
+}
+
+/**
+ * @brief Extend a checksum with the fastest implementation of the processor.
+ *
+ * @param crc (std::uint32_t) Checksum of the preceding data, 0 to start.
+ * @param data (const void*) The data.
+ * @param n (std::size_t) Its length.
+ * @return std::uint32_t
+ */
+inline std::uint32_t extend(std::uint32_t crc, const void* data, std::size_t n) {
+#ifdef CRC32C_HARDWARE
+	if (available()) return hardware(crc, data, n);
+#endif
+	return software(crc, data, n);
+}
+
+inline std::uint32_t compute(const void* data, std::size_t n) {return extend(0, data, n);}
+
+}
+#endif
@@ -0,0 +1,114 @@
+#ifndef CROWD
+#define CROWD
+/* Occupancy limit of a room. Entering reserves a slot with a compare and swap, entrants, that
+ * were turned away, wait in a FIFO queue and get the freed slots in order. */
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <mutex>
+
+namespace crowd {
+
+/**
+ * @brief Size of a cache line, hot counters are aligned to it, so they do not share lines.
+ *
+ */
+constexpr std::size_t cacheLine = 64;
+
+/**
+ * @brief Counts the occupants of a room and limits them to a capacity.
+ *
+ */
+class Occupancy {
+	alignas(cacheLine) std::atomic<int> occupants; // Reserved slots.
+	alignas(cacheLine) std::atomic<int> waiting; // Queued entrants, new entrants do not overtake them.
+	alignas(cacheLine) int capacity;
+	std::mutex queueMutex; // Only taken by turned away entrants and by leaving with a queue.
+	std::deque<std::function<bool()>> queue;
+	/**
+	 * @brief Reserve a slot, even if entrants are queued.
+	 *
+	 * @return true if a slot was reserved.
+	 */
+	bool reserve() {
+		int n = occupants.load(std::memory_order_relaxed);
+		while (n < capacity) {
+			if (occupants.compare_exchange_weak(n, n + 1, std::memory_order_acq_rel, std::memory_order_relaxed)) return true;
+		}
+		return false;
+	}
+	/**
+	 * @brief Hand the free slots to the queued entrants, oldest first. The admission callbacks
+	 * run on the calling thread, outside of the queue mutex.
+	 *
+	 */
+	void admit() {
+		while (true) {
+			std::function<bool()> entrant;
+			{
+				std::lock_guard<std::mutex> lock(queueMutex);
+				if (queue.empty() || !reserve()) return;
+				entrant = std::move(queue.front());
+				queue.pop_front();
+				waiting.fetch_sub(1, std::memory_order_release);
+			}
+			if (!entrant()) occupants.fetch_sub(1, std::memory_order_acq_rel);
+		}
+	}
+public:
+	/**
+	 * @brief Construct a new Occupancy object
+	 *
+	 * @param c (int) Maximum number of occupants.
+	 * @param o (int) Occupants already inside.
+	 */
+	Occupancy(int c, int o = 0) : occupants(o), waiting(0), capacity(c) {}
+	Occupancy(const Occupancy&) = delete;
+	Occupancy& operator=(const Occupancy&) = delete;
+	int getCapacity() const {return capacity;}
+	int getOccupants() const {return occupants.load(std::memory_order_relaxed);}
+	int getWaiting() const {return waiting.load(std::memory_order_relaxed);}
+	/**
+	 * @brief Enter without queueing. Fails when the room is full or others are queued.
+	 *
+	 * @return true if the caller occupies a slot now.
+	 */
+	bool tryEnter() {
+		if (waiting.load(std::memory_order_acquire)) return false;
+		return reserve();
+	}
+	/**
+	 * @brief Enter, or queue for the next free slot when the room is full.
+	 *
+	 * @param admitted (std::function<bool()>) Called once a queued entrant got a slot, possibly on
+	 * another thread and before this call returns. Returning false gives the slot to the next entrant.
+	 * @return true if the caller entered at once, admitted is not called then.
+	 */
+	bool enterOrQueue(std::function<bool()> admitted) {
+		if (tryEnter()) return true;
+		{
+			std::lock_guard<std::mutex> lock(queueMutex);
+			waiting.fetch_add(1, std::memory_order_acq_rel);
+			queue.push_back(std::move(admitted));
+		}
+		/* A slot could have been freed between tryEnter() and queueing. */
+		admit();
+		return false;
+	}
+	/**
+	 * @brief Free a slot, that is handed to the oldest queued entrant.
+	 *
+	 * @return false if nobody occupied a slot, nothing is freed then.
+	 */
+	bool leave() {
+		int n = occupants.load(std::memory_order_relaxed);
+		do {
+			if (n <= 0) return false;
+		} while (!occupants.compare_exchange_weak(n, n - 1, std::memory_order_acq_rel, std::memory_order_relaxed));
+		if (waiting.load(std::memory_order_acquire)) admit();
+		return true;
+	}
+};
+
+}
+#endif
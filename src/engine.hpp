@@ -5,11 +5,28 @@
 #include <memory>
 #include <string>
 #include <map>
+#include <functional>
+#include <array>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include "cow.hpp"
+#include "profiler.hpp"
+#include "metrics.hpp"
+#include "controller.hpp"
+#include "jobs.hpp"
+#include "crowd.hpp"
+#include "stats.hpp"
 
 class World;
 class Object;
 class Room;
 class Entity;
+namespace txn {
+	class Transaction;
+}
 
 /**
  * @typedef Room wrapped in a shared_ptr to be able to connect it to other nodes.
@@ -31,49 +48,237 @@ typedef std::vector<node> nodes;
  * 
  */
 typedef std::vector<item> items;
+/**
+ * @typedef A function, that advances one part of the World by a tick.
+ * 
+ */
+typedef std::function<void(World&)> tickfunc;
+/**
+ * @typedef Rooms of a World, shared with its forks in chunks of a page.
+ * 
+ */
+typedef cow::Chunked<node, 256> nodetable;
+/**
+ * @typedef Entities of a World, shared with its forks in chunks of a page.
+ * 
+ */
+typedef cow::Chunked<std::shared_ptr<Entity>, 256> entitytable;
+
+/**
+ * @brief Version of a mutable container, like an inventory. Every change makes it bigger by two,
+ * odd versions mean, that a transaction is committing to the container.
+ * 
+ */
+class Version {
+	std::atomic<std::uint64_t> value;
+public:
+	Version() : value(0) {}
+	/**
+	 * @brief Get the current version, odd while a transaction holds it.
+	 * 
+	 * @return std::uint64_t 
+	 */
+	std::uint64_t get() const {return value.load(std::memory_order_acquire);}
+	/**
+	 * @brief Lock the container for a change made outside of a transaction, waiting while a
+	 * transaction holds it.
+	 * 
+	 */
+	void acquire() {
+		while (!lock(get())) std::this_thread::yield();
+	}
+	/**
+	 * @brief Holds the container locked for a change outside of a transaction, the change counts
+	 * on release.
+	 * 
+	 */
+	class Exclusive {
+		Version& version;
+	public:
+		Exclusive(Version& v) : version(v) {version.acquire();}
+		Exclusive(const Exclusive&) = delete;
+		Exclusive& operator=(const Exclusive&) = delete;
+		~Exclusive() {version.unlock(true);}
+	};
+	/**
+	 * @brief Lock the container, if it is still at the observed version.
+	 * 
+	 * @param observed (std::uint64_t) Even version seen before.
+	 * @return true if nobody changed or locked the container since.
+	 */
+	bool lock(std::uint64_t observed) {
+		return !(observed & 1) && value.compare_exchange_strong(observed, observed + 1, std::memory_order_acq_rel);
+	}
+	/**
+	 * @brief Unlock the container.
+	 * 
+	 * @param changed (bool) Whether the holder changed the container.
+	 */
+	void unlock(bool changed) {
+		if (changed) {
+			value.fetch_add(1, std::memory_order_acq_rel);
+		} else {
+			value.fetch_sub(1, std::memory_order_acq_rel);
+		}
+	}
+};
 
 /**
  * @brief Base class for a NPC, USER or any other Entity living in the game world.
  * 
  */
 class Entity {
+	friend class txn::Transaction;
 	std::string name;
 	int hp;
 	int stamina;
+	items inventory; // Items carried by the entity.
+	Version version; // Version of the inventory.
+public:
+	/**
+	 * @brief Construct a new Entity object
+	 * 
+	 * @param n (const std::string&): The name of the entity.
+	 * @param h (int): Hit points.
+	 * @param s (int): Stamina.
+	 */
+	Entity(const std::string& n, int h = 100, int s = 100) : name(n), hp(h), stamina(s) {}
+	/**
+	 * @brief Get the Name object
+	 * 
+	 * @return name (std::string) 
+	 */
+	std::string getName() const {return name;}
+	int getHp() const {return hp;}
+	int getStamina() const {return stamina;}
+	Entity& setHp(int h) {
+		hp = h;
+		return *this;
+	}
+	Entity& setStamina(int s) {
+		stamina = s;
+		return *this;
+	}
+	/**
+	 * @brief Get the Items object
+	 * 
+	 * @return items const& 
+	 */
+	items const& getItems() const {return inventory;}
+	/**
+	 * @brief Add new item to the Inventory of the Entity
+	 * 
+	 * @param i (item&) new Item
+	 * @return Entity& 
+	 */
+	Entity& addItem(item& i) {
+		Version::Exclusive exclusive(version);
+		inventory.push_back(item(std::move(i)));
+		return *this;
+	}
+	/**
+	 * @brief Take every item out of the Inventory of the Entity
+	 * 
+	 * @return items The former inventory.
+	 */
+	items takeItems() {
+		items taken;
+		Version::Exclusive exclusive(version);
+		taken.swap(inventory);
+		return taken;
+	}
+	/**
+	 * @brief Get the Version object of the inventory.
+	 * 
+	 * @return Version const& 
+	 */
+	Version const& getVersion() const {return version;}
+	/**
+	 * @brief Copy the entity and its inventory.
+	 * 
+	 * @return std::shared_ptr<Entity> 
+	 */
+	std::shared_ptr<Entity> clone() const;
 };
 
+/**
+ * @brief Immutable template of rooms. Rooms built from a prefab share its name, description
+ * and item layout instead of holding their own copies.
+ * 
+ */
+struct Prefab {
+	/**
+	 * @brief An item of the layout, a Key if keyID is not empty.
+	 * 
+	 */
+	struct Slot {
+		std::string name;
+		std::string keyID;
+		bool operator==(const Slot& o) const {return name == o.name && keyID == o.keyID;}
+	};
+	std::string name; // Rooms are named "<name> <instance>".
+	std::string description; // Description of every room.
+	std::vector<Slot> layout; // Items every room starts with.
+};
+/**
+ * @typedef Shared, immutable room template.
+ * 
+ */
+typedef std::shared_ptr<const Prefab> prefab;
+
 /**
  * @brief Part of the World. A room that contains items, that can be collected.
  * 
  * 
  */
 class Room {
+	friend class txn::Transaction;
 	nodes neighbours; // Neighbouring rooms.
 	std::string roomName; // Name of the room.
 	std::string roomID; // ID of the room, that connects a key to this room.
-	items inventory; // Items, that can be found in the room.
+	mutable items inventory; // Items, that can be found in the room.
 	std::string description; // Description of the room.
+	std::unique_ptr<crowd::Occupancy> occupancy; // Null, if the room has no capacity limit.
+	Version version; // Version of the inventory.
+	prefab roomPrefab; // Template of the room, null for rooms without one.
+	std::uint32_t instance; // Number of the room among the rooms of its prefab.
+	mutable std::once_flag stockOnce; // The layout of the prefab is turned into items on the first access.
+	mutable std::atomic<bool> stocked;
+	/**
+	 * @brief Get the inventory, creating the items of the prefab layout first.
+	 * 
+	 * @return items& 
+	 */
+	items& stock() const;
 public:
 	/**
 	 * @brief Construct a new Room object
 	 * 
 	 * @param n (const std::string&): The name of the room.
 	 */
-	Room(const std::string& n) : roomName(n) {}
+	Room(const std::string& n) : roomName(n), instance(0), stocked(true) {}
+	/**
+	 * @brief Construct a new Room object from a prefab. Name, description and items stay in the
+	 * prefab until they are overridden or, for the items, first accessed.
+	 * 
+	 * @param p (const prefab&) The template.
+	 * @param i (std::uint32_t) Number of the room, that is appended to the name of the prefab.
+	 */
+	Room(const prefab& p, std::uint32_t i) : roomPrefab(p), instance(i), stocked(!p || p->layout.empty()) {}
 	/**
 	 * @brief Construct a new Room object
 	 * 
 	 * @param n (const std::string&): The name of the room.
 	 * @param inv (item&): An item that will be added to the inventory of the room.
 	 */
-	Room(const std::string& n, item& inv) : roomName(n) {inventory.push_back(std::move(inv));}
+	Room(const std::string& n, item& inv) : roomName(n), instance(0), stocked(true) {inventory.push_back(std::move(inv));}
 	/**
 	 * @brief Construct a new Room object
 	 * 
 	 * @param n (const std::string&): The name of the room.
 	 * @param inv (items&): Vector of items, that will be added to the inventory of the room.
 	 */
-	Room(const std::string& n, items& inv) : roomName(n) {
+	Room(const std::string& n, items& inv) : roomName(n), instance(0), stocked(true) {
 		addItems(inv);
 	}
 	/**
@@ -82,7 +287,7 @@ public:
 	 * @param n (const std::string&): The name of the room.
 	 * @param ne (node&): A node that will be added to the neighbours of the room.
 	 */
-	Room(const std::string& n, node& ne) : roomName(n) {
+	Room(const std::string& n, node& ne) : roomName(n), instance(0), stocked(true) {
 		addNeighbour(ne);
 	}
 	/**
@@ -91,7 +296,7 @@ public:
 	 * @param n (const std::string&): The name of the room.
 	 * @param ns (nodes&): Nodes that will be the neighbourhood of the room.
 	 */
-	Room(const std::string& n, nodes& ns) : roomName(n) {
+	Room(const std::string& n, nodes& ns) : roomName(n), instance(0), stocked(true) {
 		addNeighbours(ns);
 	}
 	/**
@@ -101,7 +306,7 @@ public:
 	 * @param inv (item&): An item that will be added to the inventory of the room.
 	 * @param ne (node&): A node that will be added to the neighbours of the room.
 	 */
-	Room(const std::string& n, item& inv, node& ne) : roomName(n) {
+	Room(const std::string& n, item& inv, node& ne) : roomName(n), instance(0), stocked(true) {
 		inventory.push_back(std::move(inv));
 		addNeighbour(ne);
 	}
@@ -112,7 +317,7 @@ public:
 	 * @param inv (item&): An item that will be added to the inventory of the room.
 	 * @param ns (nodes&): Nodes that will be the neighbourhood of the room.
 	 */
-	Room(const std::string& n, item& inv, nodes& ns) : roomName(n) {
+	Room(const std::string& n, item& inv, nodes& ns) : roomName(n), instance(0), stocked(true) {
 		inventory.push_back(std::move(inv));
 		addNeighbours(ns);
 	}
@@ -123,7 +328,7 @@ public:
 	 * @param inv (items&): Vector of items, that will be added to the inventory of the room. 
 	 * @param ne (node&): A node that will be added to the neighbours of the room.
 	 */
-	Room(const std::string& n, items& inv, node& ne) : roomName(n) {
+	Room(const std::string& n, items& inv, node& ne) : roomName(n), instance(0), stocked(true) {
 		addNeighbour(ne);
 		addItems(inv);
 	}
@@ -134,7 +339,7 @@ public:
 	 * @param inv (items&): Vector of items, that will be added to the inventory of the room. 
 	 * @param ns (nodes&): Nodes that will be the neighbourhood of the room.
 	 */
-	Room(const std::string& n, items& inv, nodes& ns) : roomName(n) {
+	Room(const std::string& n, items& inv, nodes& ns) : roomName(n), instance(0), stocked(true) {
 		addNeighbours(ns);
 		addItems(inv);
 	}
@@ -143,13 +348,69 @@ public:
 	 * 
 	 * @return roomName (std::string) 
 	 */
-	std::string getName() const {return roomName;}
+	std::string getName() const {
+		if (roomName.empty() && roomPrefab) return roomPrefab->name + " " + std::to_string(instance);
+		return roomName;
+	}
+	/**
+	 * @brief Override the name of the prefab.
+	 * 
+	 * @param n (const std::string&) The name.
+	 * @return Room& 
+	 */
+	Room& setName(const std::string& n) {
+		roomName = n;
+		return *this;
+	}
+	/**
+	 * @brief Get the Description object
+	 * 
+	 * @return std::string const& The own description, or the one of the prefab.
+	 */
+	std::string const& getDescription() const {
+		return description.empty() && roomPrefab ? roomPrefab->description : description;
+	}
+	/**
+	 * @brief Override the description of the prefab.
+	 * 
+	 * @param d (const std::string&) The description.
+	 * @return Room& 
+	 */
+	Room& setDescription(const std::string& d) {
+		description = d;
+		return *this;
+	}
+	/**
+	 * @brief Get the Prefab object
+	 * 
+	 * @return prefab const& Null, if the room was not built from a prefab.
+	 */
+	prefab const& getPrefab() const {return roomPrefab;}
+	/**
+	 * @brief Whether the items of the prefab layout were created already.
+	 * 
+	 * @return bool
+	 */
+	bool isStocked() const {return stocked.load(std::memory_order_acquire);}
+	/**
+	 * @brief Number of items, without creating the items of the prefab layout.
+	 * 
+	 * @return std::size_t 
+	 */
+	std::size_t countItems() const {return isStocked() ? inventory.size() : roomPrefab->layout.size();}
+	/**
+	 * @brief Copy the room and its inventory. The copy has the same neighbours, a prefab layout,
+	 * that was not stocked yet, stays in the prefab.
+	 * 
+	 * @return node 
+	 */
+	node clone() const;
 	/**
 	 * @brief Get the Neighbours object
 	 * 
-	 * @return neighbours (const nodes) 
+	 * @return neighbours (nodes const&) 
 	 */
-	nodes getNeighbours() const {return neighbours;}	
+	nodes const& getNeighbours() const {return neighbours;}	
 	/**
 	 * @brief Add a neighbour to the Neighours object
 	 * 
@@ -177,7 +438,7 @@ public:
 	 * 
 	 * @return items const& 
 	 */
-	items const& getItems() {return inventory;}	
+	items const& getItems() const {return stock();}	
 	/**
 	 * @brief Add new item to the Inventory of the Room 
 	 * 
@@ -185,7 +446,9 @@ public:
 	 * @return Room& 
 	 */
 	Room& addItem(item& i) {
-		inventory.push_back(item(std::move(i)));
+		items& own = stock();
+		Version::Exclusive exclusive(version);
+		own.push_back(item(std::move(i)));
 		return *this;
 	}
 	/**
@@ -195,11 +458,60 @@ public:
 	 * @return Room& 
 	 */
 	Room& addItems(items& inv) {
+		items& own = stock();
+		Version::Exclusive exclusive(version);
 		for (items::iterator it = inv.begin(); it != inv.end(); it++) {
-			inventory.push_back(item(std::move(*it)));
+			own.push_back(item(std::move(*it)));
 		}
 		return *this;
 	}
+	/**
+	 * @brief Take every item out of the Inventory of the Room
+	 * 
+	 * @return items The former inventory.
+	 */
+	items takeItems() {
+		items taken;
+		items& own = stock();
+		Version::Exclusive exclusive(version);
+		taken.swap(own);
+		return taken;
+	}
+	/**
+	 * @brief Get the Version object of the inventory.
+	 * 
+	 * @return Version const& 
+	 */
+	Version const& getVersion() const {return version;}
+	/**
+	 * @brief Limit the number of entities in the room, like in an airlock or an escape pod.
+	 * Must be set before entities enter the room.
+	 * 
+	 * @param c (int) Maximum number of occupants.
+	 * @return Room& 
+	 */
+	Room& setCapacity(int c) {
+		occupancy.reset(new crowd::Occupancy(c));
+		return *this;
+	}
+	/**
+	 * @brief Get the Occupancy object
+	 * 
+	 * @return crowd::Occupancy* Null, if the room has no capacity limit.
+	 */
+	crowd::Occupancy* getOccupancy() const {return occupancy.get();}
+	/**
+	 * @brief Enter the room, if it is not full. Safe to call from parallel systems.
+	 * 
+	 * @return true if the entity may enter.
+	 */
+	bool tryEnter() {return !occupancy || occupancy->tryEnter();}
+	/**
+	 * @brief Leave the room, the freed slot goes to the oldest queued entrant.
+	 * 
+	 * @return false if the room has a capacity limit and nobody was in it.
+	 */
+	bool leave() {return !occupancy || occupancy->leave();}
 };
 
 /**
@@ -215,12 +527,19 @@ public:
 	 * @param n (std::string&) Name of the Object
 	 */
 	Object(const std::string& n) : objectName(n) {}
+	virtual ~Object() {}
 	/**
 	 * @brief Get the Name object
 	 * 
-	 * @return objectName (std::string) 
+	 * @return objectName (std::string const&) 
+	 */
+	std::string const& getName() const {return objectName;}
+	/**
+	 * @brief Copy the Object, keeping its type.
+	 * 
+	 * @return item 
 	 */
-	std::string getName() const {return objectName;}
+	virtual item clone() const {return item(new Object(*this));}
 };
 
 /**
@@ -229,5 +548,440 @@ public:
  */
 class Key : public Object {
 	std::string keyID;
+public:
+	/**
+	 * @brief Construct a new Key object
+	 * 
+	 * @param n (const std::string&) Name of the Key
+	 * @param id (const std::string&) ID of the room, that the Key opens
+	 */
+	Key(const std::string& n, const std::string& id) : Object(n), keyID(id) {}
+	/**
+	 * @brief Get the ID of the room, that the Key opens
+	 * 
+	 * @return keyID (std::string const&) 
+	 */
+	std::string const& getKeyID() const {return keyID;}
+	item clone() const override {return item(new Key(*this));}
+};
+
+inline items& Room::stock() const {
+	if (!stocked.load(std::memory_order_acquire)) {
+		std::call_once(stockOnce, [this] {
+			items layout;
+			for (Prefab::Slot const& s : roomPrefab->layout) {
+				layout.push_back(item(s.keyID.empty() ? new Object(s.name) : new Key(s.name, s.keyID)));
+			}
+			for (item& i : inventory) layout.push_back(std::move(i));
+			inventory.swap(layout);
+			stocked.store(true, std::memory_order_release);
+		});
+	}
+	return inventory;
+}
+
+inline node Room::clone() const {
+	node r(new Room(roomPrefab, instance));
+	r->neighbours = neighbours;
+	r->roomName = roomName;
+	r->roomID = roomID;
+	r->description = description;
+	if (occupancy) r->occupancy.reset(new crowd::Occupancy(occupancy->getCapacity(), occupancy->getOccupants()));
+	if (isStocked()) {
+		for (item const& i : inventory) r->inventory.push_back(i->clone());
+		r->stocked.store(true, std::memory_order_release);
+	}
+	return r;
+}
+
+inline std::shared_ptr<Entity> Entity::clone() const {
+	std::shared_ptr<Entity> e(new Entity(name, hp, stamina));
+	for (item const& i : inventory) e->inventory.push_back(i->clone());
+	return e;
+}
+
+/**
+ * @brief Immutable copy of a Room, the only way background jobs may look at rooms.
+ * 
+ */
+struct RoomView {
+	std::string name; // Name of the room.
+	std::vector<std::size_t> neighbours; // Indices of the neighbours in the snapshot.
+	std::vector<std::string> items; // Names of the items in the inventory.
+	std::vector<std::string> keyIDs; // Key ids of the items, empty for other objects.
+	std::size_t keys; // Number of Keys in the inventory.
+};
+
+/**
+ * @typedef Read only copy of every room of a World, shared between jobs.
+ * 
+ */
+typedef std::shared_ptr<const std::vector<RoomView>> snapshot;
+
+/**
+ * @brief Statistics of a World, that systems may update from any thread.
+ * They are merged at the end of every tick.
+ * 
+ */
+struct WorldStats {
+	stats::Accumulator itemsPickedUp;
+	stats::Accumulator damageDealt;
+	stats::Accumulator roomsVisited;
+};
+
+/**
+ * @brief Phases of a World tick, run in this order.
+ * 
+ */
+enum class Phase {
+	Movement,
+	Combat,
+	Diffusion,
+	Replication
+};
+
+/**
+ * @brief The game world. Owns the rooms and advances them tick by tick.
+ * 
+ * A World can be forked to simulate ticks ahead without touching it. A fork shares the rooms and
+ * entities with its origin, until it writes to them through mutateRoom() or mutateEntity(), which
+ * give the fork its own copy. Systems, that run on forks, must write only through these and
+ * follow neighbours through resolve(), neighbours of a copy still lead to the shared rooms.
+ * Copying is one-sided: the origin writes its rooms and entities in place, and the fork sees
+ * those writes on everything it still shares. A fork must therefore be used and discarded on
+ * the tick thread before the origin ticks or is written to again.
+ * 
+ */
+class World {
+public:
+	static const std::size_t phaseCount = 4;
+	/**
+	 * @brief Get the name of a phase, that is also the name of its profiler zone.
+	 * 
+	 * @param p (Phase) The phase.
+	 * @return const char* 
+	 */
+	static const char* phaseName(Phase p) {
+		static const char* names[phaseCount] = {"movement", "combat", "diffusion", "replication"};
+		return names[static_cast<std::size_t>(p)];
+	}
+private:
+	nodetable rooms; // Every room of the world.
+	entitytable entities; // Entities registered with the world.
+	unsigned long tickCount; // Number of finished ticks.
+	bool forked; // Whether the World is a fork, that copies what it writes.
+	mutable std::unordered_set<const void*> owned; // Rooms and entities copied by this fork, shared again once it is forked.
+	std::shared_ptr<std::unordered_map<const Room*, node>> copies; // Copies of shared rooms in this fork and its origins.
+	/**
+	 * @brief A system and its id in the load controller.
+	 * 
+	 */
+	struct System {
+		tickfunc f;
+		std::size_t id;
+		std::string name;
+	};
+	std::array<std::vector<System>, phaseCount> systems; // Systems of each phase.
+	load::Controller loadController; // Decides which systems are shed when the ticks run long.
+	jobs::Mailbox mailbox; // Results of background jobs, drained at the end of the tick.
+	WorldStats worldStats; // Statistics of the systems.
+	profiler::FrameProfiler frameProfiler; // Zones of the last ticks.
+	/**
+	 * @brief Metrics of the World in an attached registry.
+	 * 
+	 */
+	struct WorldMetrics {
+		metrics::Histogram* tickSeconds;
+		metrics::Counter* ticks;
+		metrics::Gauge* rooms;
+		metrics::Gauge* entities;
+		metrics::Gauge* items;
+		metrics::Gauge* roomsMemory;
+		metrics::Gauge* itemsMemory;
+		metrics::Counter* itemsPickedUp;
+		metrics::Counter* damageDealt;
+		metrics::Counter* roomsVisited;
+	};
+	std::unique_ptr<WorldMetrics> worldMetrics; // Null until attachMetrics() is called.
+	unsigned long metricsInterval; // Ticks between two full walks over the rooms.
+	/**
+	 * @brief Publish the metrics of the finished tick. Counting items and memory walks every room,
+	 * so it is only done every metricsInterval ticks.
+	 * 
+	 * @param seconds (double) Length of the tick.
+	 * @param itemsPickedUp (std::int64_t) Items picked up in the tick.
+	 * @param damageDealt (std::int64_t) Damage dealt in the tick.
+	 * @param roomsVisited (std::int64_t) Rooms visited in the tick.
+	 */
+	void publishMetrics(double seconds, std::int64_t itemsPickedUp, std::int64_t damageDealt, std::int64_t roomsVisited) {
+		worldMetrics->tickSeconds->observe(seconds);
+		worldMetrics->ticks->inc();
+		worldMetrics->rooms->set(rooms.size());
+		worldMetrics->entities->set(entities.size());
+		worldMetrics->itemsPickedUp->inc(itemsPickedUp);
+		worldMetrics->damageDealt->inc(damageDealt);
+		worldMetrics->roomsVisited->inc(roomsVisited);
+		if (tickCount % metricsInterval) return;
+		std::size_t itemCount = 0;
+		std::size_t roomBytes = 0;
+		for (node const& r : rooms) {
+			std::size_t count = r->countItems();
+			itemCount += count;
+			roomBytes += sizeof(Room) + r->getNeighbours().capacity() * sizeof(node) + count * sizeof(item);
+			if (!r->getPrefab()) roomBytes += r->getName().capacity();
+		}
+		worldMetrics->items->set(itemCount);
+		worldMetrics->roomsMemory->set(roomBytes);
+		worldMetrics->itemsMemory->set(itemCount * sizeof(Object));
+	}
+public:
+	/**
+	 * @brief Construct a new World object
+	 * 
+	 */
+	World() : tickCount(0), forked(false), metricsInterval(64) {}
+	/**
+	 * @brief Add a room to the World
+	 * 
+	 * @param r (node&) The new room.
+	 * @return World& 
+	 */
+	World& addRoom(node& r) {
+		rooms.push_back(node(r));
+		return *this;
+	}
+	/**
+	 * @brief Get the Rooms object
+	 * 
+	 * @return nodetable const& 
+	 */
+	nodetable const& getRooms() const {return rooms;}
+	/**
+	 * @brief Register an entity with the World, so forks can simulate it.
+	 * 
+	 * @param e (const std::shared_ptr<Entity>&) The entity.
+	 * @return std::size_t Index of the entity.
+	 */
+	std::size_t addEntity(const std::shared_ptr<Entity>& e) {
+		entities.push_back(e);
+		return entities.size() - 1;
+	}
+	/**
+	 * @brief Get the Entities object
+	 * 
+	 * @return entitytable const& 
+	 */
+	entitytable const& getEntities() const {return entities;}
+	/**
+	 * @brief Get a room for writing. A fork copies the room first, if it shares it.
+	 * 
+	 * @param i (std::size_t) Index of the room.
+	 * @return Room& 
+	 */
+	Room& mutateRoom(std::size_t i) {
+		Room* r = rooms[i].get();
+		if (!forked || owned.count(r)) return *r;
+		node copy = r->clone();
+		if (copies.use_count() > 1) copies.reset(new std::unordered_map<const Room*, node>(*copies));
+		(*copies)[r] = copy;
+		owned.insert(copy.get());
+		rooms.mutate(i) = copy;
+		return *copy;
+	}
+	/**
+	 * @brief Get an entity for writing. A fork copies the entity first, if it shares it.
+	 * 
+	 * @param i (std::size_t) Index of the entity.
+	 * @return Entity& 
+	 */
+	Entity& mutateEntity(std::size_t i) {
+		Entity* e = entities[i].get();
+		if (!forked || owned.count(e)) return *e;
+		std::shared_ptr<Entity> copy = e->clone();
+		owned.insert(copy.get());
+		entities.mutate(i) = copy;
+		return *copy;
+	}
+	/**
+	 * @brief Get the version of a room in this World, for following the neighbours of a room.
+	 * 
+	 * @param r (const node&) The room, maybe one, that a fork replaced by a copy.
+	 * @return node 
+	 */
+	node resolve(const node& r) const {
+		node n = r;
+		if (!copies) return n;
+		for (auto it = copies->find(n.get()); it != copies->end(); it = copies->find(n.get())) n = it->second;
+		return n;
+	}
+	bool isFork() const {return forked;}
+	/**
+	 * @brief Fork the World. The fork shares every room and entity, has the tick count and the
+	 * systems of this World and runs every system, none is shed. Metrics are not attached and
+	 * the profiler is disabled. Must be called from the tick thread, outside of the systems, and
+	 * the fork must be dropped before this World ticks again, whose writes it would see.
+	 * 
+	 * @return std::unique_ptr<World> 
+	 */
+	std::unique_ptr<World> fork() const {
+		std::unique_ptr<World> f(new World());
+		f->rooms = rooms;
+		f->entities = entities;
+		f->tickCount = tickCount;
+		f->forked = true;
+		f->copies = copies ? copies : std::make_shared<std::unordered_map<const Room*, node>>();
+		for (std::size_t p = 0; p < phaseCount; p++) {
+			for (System const& sys : systems[p]) {
+				f->systems[p].push_back({sys.f, f->loadController.add(sys.name, load::Priority::Critical), sys.name});
+			}
+		}
+		f->frameProfiler.setEnabled(false);
+		owned.clear();
+		return f;
+	}
+	/**
+	 * @brief Get the number of finished ticks.
+	 * 
+	 * @return unsigned long 
+	 */
+	unsigned long getTickCount() const {return tickCount;}
+	/**
+	 * @brief Register a critical system, that runs in the given phase of every tick.
+	 * 
+	 * @param p (Phase) The phase of the system.
+	 * @param f (tickfunc) The system.
+	 * @return World& 
+	 */
+	World& addSystem(Phase p, tickfunc f) {
+		return addSystem(p, phaseName(p), load::Priority::Critical, 0, std::move(f));
+	}
+	/**
+	 * @brief Register a system, that the load controller may shed or defer.
+	 * 
+	 * @param p (Phase) The phase of the system.
+	 * @param name (const std::string&) Name of the system in the load controller.
+	 * @param priority (load::Priority) Shedding priority of the system.
+	 * @param budget (std::uint64_t) Nanoseconds the system may spend in a tick, 0 is unlimited.
+	 * @param f (tickfunc) The system.
+	 * @return World& 
+	 */
+	World& addSystem(Phase p, const std::string& name, load::Priority priority, std::uint64_t budget, tickfunc f) {
+		systems[static_cast<std::size_t>(p)].push_back({std::move(f), loadController.add(name, priority, budget), name});
+		return *this;
+	}
+	/**
+	 * @brief Get the Controller object
+	 * 
+	 * @return load::Controller& 
+	 */
+	load::Controller& getController() {return loadController;}
+	/**
+	 * @brief Get the Mailbox object, background jobs post their results here.
+	 * 
+	 * @return jobs::Mailbox& 
+	 */
+	jobs::Mailbox& getMailbox() {return mailbox;}
+	/**
+	 * @brief Get the Stats object, the totals are updated at the end of every tick.
+	 * 
+	 * @return WorldStats& 
+	 */
+	WorldStats& getStats() {return worldStats;}
+	/**
+	 * @brief Copy the rooms into an immutable snapshot, that background jobs can read.
+	 * Must be called from the tick thread, outside of the systems of other threads.
+	 * 
+	 * @return snapshot 
+	 */
+	snapshot makeSnapshot() const {
+		std::unordered_map<const Room*, std::size_t> index;
+		for (std::size_t i = 0; i < rooms.size(); i++) index[rooms[i].get()] = i;
+		std::shared_ptr<std::vector<RoomView>> views(new std::vector<RoomView>(rooms.size()));
+		for (std::size_t i = 0; i < rooms.size(); i++) {
+			RoomView& v = (*views)[i];
+			v.name = rooms[i]->getName();
+			for (node const& n : rooms[i]->getNeighbours()) {
+				auto it = index.find(n.get());
+				if (it != index.end()) v.neighbours.push_back(it->second);
+			}
+			v.keys = 0;
+			if (!rooms[i]->isStocked()) {
+				for (Prefab::Slot const& s : rooms[i]->getPrefab()->layout) {
+					v.items.push_back(s.name);
+					v.keyIDs.push_back(s.keyID);
+					if (!s.keyID.empty()) v.keys++;
+				}
+				continue;
+			}
+			for (item const& it : rooms[i]->getItems()) {
+				const Key* k = dynamic_cast<const Key*>(it.get());
+				v.items.push_back(it->getName());
+				v.keyIDs.push_back(k ? k->getKeyID() : std::string());
+				if (k) v.keys++;
+			}
+		}
+		return views;
+	}
+	/**
+	 * @brief Get the Profiler object
+	 * 
+	 * @return profiler::FrameProfiler& 
+	 */
+	profiler::FrameProfiler& getProfiler() {return frameProfiler;}
+	/**
+	 * @brief Publish the metrics of the World into a registry after every tick.
+	 * 
+	 * @param r (metrics::Registry&) The registry, it must outlive the World.
+	 * @param interval (unsigned long) Ticks between two updates of the item and memory metrics.
+	 * @return World& 
+	 */
+	World& attachMetrics(metrics::Registry& r, unsigned long interval = 64) {
+		worldMetrics.reset(new WorldMetrics({
+			&r.histogram("spacewalk_tick_seconds", metrics::Histogram::exponential(0.0001, 2, 14), "Length of a World tick."),
+			&r.counter("spacewalk_ticks_total", "Number of finished ticks."),
+			&r.gauge("spacewalk_rooms", "Rooms loaded in the World."),
+			&r.gauge("spacewalk_entities", "Entities in the World."),
+			&r.gauge("spacewalk_items", "Items in the inventory of the rooms."),
+			&r.gauge("spacewalk_memory_bytes{subsystem=\"rooms\"}", "Estimated memory use by subsystem."),
+			&r.gauge("spacewalk_memory_bytes{subsystem=\"items\"}", "Estimated memory use by subsystem."),
+			&r.counter("spacewalk_items_picked_up_total", "Items picked up by entities."),
+			&r.counter("spacewalk_damage_dealt_total", "Damage dealt by entities."),
+			&r.counter("spacewalk_rooms_visited_total", "Rooms entered by entities.")
+		}));
+		metricsInterval = interval ? interval : 1;
+		return *this;
+	}
+	/**
+	 * @brief Advance the World by one tick, running the systems phase by phase.
+	 * Every phase is recorded as a zone of the frame profiler, systems shed by the load
+	 * controller are skipped. Results of background jobs are handed over after the last phase.
+	 * 
+	 */
+	void tick() {
+		std::uint64_t begin = profiler::now();
+		loadController.beginTick();
+		{
+			profiler::TickScope scope(frameProfiler, tickCount);
+			for (std::size_t p = 0; p < phaseCount; p++) {
+				if (systems[p].empty()) continue;
+				PROFILE_ZONE(frameProfiler, phaseName(static_cast<Phase>(p)));
+				for (System& sys : systems[p]) {
+					if (!loadController.shouldRun(sys.id)) continue;
+					std::uint64_t start = profiler::now();
+					sys.f(*this);
+					loadController.record(sys.id, profiler::now() - start);
+				}
+			}
+			PROFILE_ZONE(frameProfiler, "completions");
+			mailbox.drain();
+		}
+		std::int64_t itemsPickedUp = worldStats.itemsPickedUp.merge();
+		std::int64_t damageDealt = worldStats.damageDealt.merge();
+		std::int64_t roomsVisited = worldStats.roomsVisited.merge();
+		std::uint64_t duration = profiler::now() - begin;
+		loadController.endTick(duration);
+		if (worldMetrics) publishMetrics(duration / 1e9, itemsPickedUp, damageDealt, roomsVisited);
+		tickCount++;
+	}
 };
 #endif
\ No newline at end of file
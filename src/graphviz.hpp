@@ -0,0 +1,237 @@
+#ifndef GRAPHVIZ
+#define GRAPHVIZ
+/* Dump of the room graph to DOT or GraphML for debugging the world layout. Works on the
+ * read only query::Store, so it can run as a background job, and streams through a large
+ * buffer, so huge maps are written in few system calls. */
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "query.hpp"
+
+namespace graphviz {
+
+enum class Format {
+	Dot,
+	GraphML
+};
+
+/**
+ * @brief Which rooms are dumped. Edges are dumped, if both of their rooms are.
+ *
+ */
+struct Selection {
+	std::string center; // Dump only rooms within hops of this room, empty dumps every room.
+	unsigned hops;
+	std::uint32_t begin; // Dump only rooms with an index in [begin, end), one partition of the map.
+	std::uint32_t end;
+	double sample; // Keep this fraction of the selected rooms, 1 keeps all.
+	std::uint64_t seed; // Seed of the sampling, the same seed keeps the same rooms.
+	Selection() : hops(0), begin(0), end(UINT32_MAX), sample(1), seed(0) {}
+};
+
+/**
+ * @brief Write only file with a large buffer.
+ *
+ */
+class BufferedFile {
+	std::FILE* file;
+	std::string path;
+	std::vector<char> buffer;
+	std::size_t used;
+	void put(const char* s, std::size_t n) {
+		if (std::fwrite(s, 1, n, file) != n) throw std::runtime_error("graphviz: cannot write " + path);
+	}
+public:
+	/**
+	 * @brief Construct a new Buffered File object
+	 *
+	 * @param path (const std::string&) The file.
+	 * @param size (std::size_t) Size of the buffer.
+	 * @throws std::runtime_error if the file cannot be opened.
+	 */
+	BufferedFile(const std::string& path, std::size_t size = 1 << 20) : file(std::fopen(path.c_str(), "wb")), path(path), buffer(size), used(0) {
+		if (!file) throw std::runtime_error("graphviz: cannot open " + path);
+		std::setvbuf(file, nullptr, _IONBF, 0);
+	}
+	BufferedFile(const BufferedFile&) = delete;
+	BufferedFile& operator=(const BufferedFile&) = delete;
+	/**
+	 * @brief Destroy the Buffered File object, closing the file. Write errors are only reported
+	 * by an explicit close().
+	 *
+	 */
+	~BufferedFile() {
+		if (!file) return;
+		try {
+			flush();
+		} catch (const std::runtime_error&) {}
+		std::fclose(file);
+	}
+	/**
+	 * @brief Write a string.
+	 *
+	 * @throws std::runtime_error if the file cannot be written.
+	 */
+	BufferedFile& write(const char* s, std::size_t n) {
+		if (used + n > buffer.size()) flush();
+		if (n > buffer.size()) {
+			put(s, n);
+			return *this;
+		}
+		std::memcpy(buffer.data() + used, s, n);
+		used += n;
+		return *this;
+	}
+	BufferedFile& operator<<(const std::string& s) {return write(s.data(), s.size());}
+	BufferedFile& operator<<(const char* s) {return write(s, std::strlen(s));}
+	BufferedFile& operator<<(std::uint64_t v) {
+		char digits[24];
+		int n = std::snprintf(digits, sizeof(digits), "%llu", static_cast<unsigned long long>(v));
+		return write(digits, n);
+	}
+	void flush() {
+		std::size_t n = used;
+		used = 0;
+		if (n) put(buffer.data(), n);
+	}
+	/**
+	 * @brief Flush and close the file.
+	 *
+	 * @throws std::runtime_error if the file cannot be written.
+	 */
+	void close() {
+		flush();
+		std::FILE* f = file;
+		file = nullptr;
+		if (std::fclose(f)) throw std::runtime_error("graphviz: cannot write " + path);
+	}
+};
+
+/**
+ * @brief Escape a name for a quoted DOT string or for XML.
+ *
+ */
+inline std::string escape(const std::string& s, Format f) {
+	std::string e;
+	for (char c : s) {
+		if (f == Format::Dot) {
+			if (c == '"' || c == '\\') e += '\\';
+			e += c;
+		} else if (c == '&') {
+			e += "&amp;";
+		} else if (c == '<') {
+			e += "&lt;";
+		} else if (c == '>') {
+			e += "&gt;";
+		} else if (c == '"') {
+			e += "&quot;";
+		} else {
+			e += c;
+		}
+	}
+	return e;
+}
+
+/**
+ * @brief Decide with a hash of the room, whether it is in the sample.
+ *
+ */
+inline bool sampled(std::uint32_t room, const Selection& sel) {
+	if (sel.sample >= 1) return true;
+	std::uint64_t h = (room + sel.seed + 1) * 0x9E3779B97F4A7C15ull;
+	h ^= h >> 31;
+	h *= 0xBF58476D1CE4E5B9ull;
+	h ^= h >> 29;
+	return (h >> 11) * (1.0 / 9007199254740992.0) < sel.sample;
+}
+
+/**
+ * @brief Counts of a dump.
+ *
+ */
+struct Summary {
+	std::size_t rooms;
+	std::size_t edges;
+};
+
+/**
+ * @brief Write the selected part of the room graph.
+ *
+ * @param s (const query::Store&) The rooms.
+ * @param path (const std::string&) The file.
+ * @param f (Format) DOT or GraphML.
+ * @param sel (const Selection&) The dumped rooms.
+ * @return Summary
+ * @throws std::runtime_error if the file cannot be written or the center room does not exist.
+ */
+inline Summary write(const query::Store& s, const std::string& path, Format f, const Selection& sel = Selection()) {
+	std::vector<std::uint8_t> keep(s.size(), 0);
+	std::vector<std::uint32_t> rooms;
+	if (!sel.center.empty()) {
+		const std::uint32_t* center = s.find(sel.center);
+		if (!center) throw std::runtime_error("graphviz: no room called " + sel.center);
+		rooms = s.within(*center, sel.hops);
+	} else {
+		for (std::uint32_t i = 0; i < s.size(); i++) rooms.push_back(i);
+	}
+	std::size_t kept = 0;
+	for (std::uint32_t r : rooms) {
+		if (r < sel.begin || r >= sel.end || !sampled(r, sel)) continue;
+		keep[r] = 1;
+		rooms[kept++] = r;
+	}
+	rooms.resize(kept);
+
+	Summary summary = {rooms.size(), 0};
+	BufferedFile out(path);
+	if (f == Format::Dot) {
+		out << "digraph world {\n";
+		for (std::uint32_t r : rooms) out << "  r" << r << " [label=\"" << escape(s.getName(r), f) << "\"];\n";
+	} else {
+		out << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+			<< "<graphml xmlns=\"http://graphml.graphdrawing.org/xmlns\">\n"
+			<< "  <key id=\"name\" for=\"node\" attr.name=\"name\" attr.type=\"string\"/>\n"
+			<< "  <graph id=\"world\" edgedefault=\"directed\">\n";
+		for (std::uint32_t r : rooms) out << "    <node id=\"r" << r << "\"><data key=\"name\">" << escape(s.getName(r), f) << "</data></node>\n";
+	}
+	std::vector<std::uint32_t> const& offsets = s.getOffsets();
+	std::vector<std::uint32_t> const& targets = s.getTargets();
+	for (std::uint32_t r : rooms) {
+		for (std::uint32_t e = offsets[r]; e < offsets[r + 1]; e++) {
+			std::uint32_t t = targets[e];
+			if (!keep[t]) continue;
+			summary.edges++;
+			if (f == Format::Dot) {
+				out << "  r" << r << " -> r" << t << ";\n";
+			} else {
+				out << "    <edge source=\"r" << r << "\" target=\"r" << t << "\"/>\n";
+			}
+		}
+	}
+	out << (f == Format::Dot ? "}\n" : "  </graph>\n</graphml>\n");
+	out.close();
+	return summary;
+}
+
+/**
+ * @brief Dump a snapshot on a background job, so the tick is not held up by the file.
+ *
+ * @param pool (jobs::Pool&) The pool.
+ * @param s (const snapshot&) The snapshot.
+ * @param path (const std::string&) The file.
+ * @param f (Format) DOT or GraphML.
+ * @param sel (const Selection&) The dumped rooms.
+ * @return jobs::handle The job, its wait() throws the error, that left the file incomplete.
+ */
+inline jobs::handle dump(jobs::Pool& pool, const snapshot& s, const std::string& path, Format f, const Selection& sel = Selection()) {
+	return pool.submit("graphviz_dump", jobs::Priority::Low, [s, path, f, sel] {
+		write(query::Store(s), path, f, sel);
+	});
+}
+
+}
+#endif
@@ -0,0 +1,245 @@
+#ifndef HOST
+#define HOST
+/* Hosting of many small Worlds on one job pool. Every World has a tick period, the due World with
+ * the earliest deadline is handed to the pool first, a World never ticks on two threads at once,
+ * and a World, that reports itself idle, hibernates until it is woken and costs nothing meanwhile. */
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <thread>
+#include <vector>
+#include "engine.hpp"
+
+namespace host {
+
+/**
+ * @brief Multiplexes the ticks of many Worlds over a jobs::Pool.
+ *
+ */
+class Host {
+	/**
+	 * @brief A hosted World and its schedule.
+	 *
+	 */
+	struct Hosted {
+		World* world;
+		std::string name;
+		std::uint64_t period; // Nanoseconds between two ticks.
+		std::uint64_t due; // Time of the next tick, its deadline is one period later.
+		std::function<bool(World&)> idle; // Asked after every tick, true hibernates the World.
+		bool hibernating;
+		bool wakePending; // Woken while ticking, the next idle answer is ignored.
+		std::uint64_t ticks;
+		std::uint64_t misses; // Ticks, that finished after their deadline.
+		std::uint64_t failures; // Ticks or idle checks, that threw.
+		metrics::Counter* tickCounter;
+		metrics::Counter* missCounter;
+		metrics::Counter* failureCounter;
+		metrics::Histogram* tickSeconds;
+	};
+	typedef std::pair<std::uint64_t, std::size_t> Entry; // Due time and World, the earliest first.
+	jobs::Pool& pool;
+	mutable std::mutex hostMutex;
+	std::vector<std::unique_ptr<Hosted>> worlds;
+	std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> queue;
+	std::condition_variable finished;
+	std::size_t ticking; // Ticks handed to the pool and not finished yet.
+	std::size_t hibernating;
+	metrics::Registry* registry;
+	metrics::Gauge* hibernatingGauge;
+	void attach(Hosted& h) {
+		std::string label = "{world=\"" + h.name + "\"}";
+		h.tickCounter = &registry->counter("spacewalk_world_ticks_total" + label, "Ticks of a hosted World.");
+		h.missCounter = &registry->counter("spacewalk_world_deadline_misses_total" + label, "Ticks of a hosted World, that missed their deadline.");
+		h.failureCounter = &registry->counter("spacewalk_world_tick_failures_total" + label, "Ticks of a hosted World, that threw an exception.");
+		h.tickSeconds = &registry->histogram("spacewalk_world_tick_seconds" + label, metrics::Histogram::exponential(0.0001, 2, 14), "Length of a tick of a hosted World.");
+	}
+	/**
+	 * @brief Tick a World on a worker and put it back into the queue, or into hibernation. A tick,
+	 * that throws, is counted as a failure and the World stays scheduled, nobody would see the
+	 * exception in the job handle.
+	 *
+	 */
+	void run(Hosted& h, std::size_t id) {
+		std::uint64_t begin = profiler::now();
+		std::uint64_t end = begin;
+		bool idle = false;
+		bool failed = false;
+		try {
+			h.world->tick();
+			end = profiler::now();
+			idle = h.idle && h.idle(*h.world);
+		} catch (...) {
+			end = profiler::now();
+			failed = true;
+		}
+		std::lock_guard<std::mutex> lock(hostMutex);
+		h.ticks++;
+		bool missed = end > h.due + h.period;
+		if (missed) h.misses++;
+		if (failed) h.failures++;
+		if (h.tickCounter) {
+			h.tickCounter->inc();
+			if (missed) h.missCounter->inc();
+			if (failed) h.failureCounter->inc();
+			h.tickSeconds->observe((end - begin) / 1e9);
+		}
+		/* A late World skips the ticks it missed instead of running them back to back. */
+		h.due = std::max(h.due + h.period, end);
+		if (idle && !h.wakePending) {
+			h.hibernating = true;
+			hibernating++;
+			if (hibernatingGauge) hibernatingGauge->set(hibernating);
+		} else {
+			queue.push(Entry(h.due, id));
+		}
+		h.wakePending = false;
+		ticking--;
+		finished.notify_all();
+	}
+public:
+	/**
+	 * @brief Construct a new Host object
+	 *
+	 * @param p (jobs::Pool&) The pool, that runs the ticks.
+	 */
+	Host(jobs::Pool& p) : pool(p), ticking(0), hibernating(0), registry(nullptr), hibernatingGauge(nullptr) {}
+	Host(const Host&) = delete;
+	Host& operator=(const Host&) = delete;
+	/**
+	 * @brief Destroy the Host object after the ticks on the pool finished.
+	 *
+	 */
+	~Host() {
+		std::unique_lock<std::mutex> lock(hostMutex);
+		finished.wait(lock, [this] {return ticking == 0;});
+	}
+	/**
+	 * @brief Host a World. It is ticked by pool workers, one tick at a time, and must not be
+	 * touched by other threads while it is hosted.
+	 *
+	 * @param w (World&) The World, it must outlive the Host.
+	 * @param name (const std::string&) Name of the World in the metrics.
+	 * @param period (std::uint64_t) Nanoseconds between two ticks.
+	 * @param idle (std::function<bool(World&)>) Asked after every tick, true hibernates the World.
+	 * @param profile (bool) Keep the frame profiler of the World enabled. Off by default, every
+	 * worker thread, that ticks a profiled World, holds a zone ring for it.
+	 * @return std::size_t Id of the World.
+	 */
+	std::size_t add(World& w, const std::string& name, std::uint64_t period, std::function<bool(World&)> idle = nullptr, bool profile = false) {
+		w.getProfiler().setEnabled(profile);
+		std::lock_guard<std::mutex> lock(hostMutex);
+		std::size_t id = worlds.size();
+		worlds.push_back(std::unique_ptr<Hosted>(new Hosted{&w, name, period ? period : 1, profiler::now(), std::move(idle),
+			false, false, 0, 0, 0, nullptr, nullptr, nullptr, nullptr}));
+		if (registry) attach(*worlds.back());
+		queue.push(Entry(worlds.back()->due, id));
+		return id;
+	}
+	/**
+	 * @brief Wake a hibernating World, it ticks at the next step(). A World, that is not
+	 * hibernating, stays awake after its next tick, even if it reports itself idle.
+	 *
+	 * @param id (std::size_t) The World.
+	 * @return false if the World was not hibernating.
+	 */
+	bool wake(std::size_t id) {
+		std::lock_guard<std::mutex> lock(hostMutex);
+		Hosted& h = *worlds[id];
+		if (!h.hibernating) {
+			h.wakePending = true;
+			return false;
+		}
+		h.hibernating = false;
+		h.due = profiler::now();
+		hibernating--;
+		if (hibernatingGauge) hibernatingGauge->set(hibernating);
+		queue.push(Entry(h.due, id));
+		return true;
+	}
+	/**
+	 * @brief Hand every due World to the pool, earliest deadline first.
+	 *
+	 * @param now (std::uint64_t) The current time.
+	 * @return std::uint64_t Time, when the next World is due, UINT64_MAX if none is queued.
+	 */
+	std::uint64_t step(std::uint64_t now = profiler::now()) {
+		std::vector<std::pair<Hosted*, std::size_t>> due;
+		std::uint64_t next;
+		{
+			std::lock_guard<std::mutex> lock(hostMutex);
+			while (!queue.empty() && queue.top().first <= now) {
+				std::size_t id = queue.top().second;
+				due.push_back(std::make_pair(worlds[id].get(), id));
+				queue.pop();
+			}
+			next = queue.empty() ? UINT64_MAX : queue.top().first;
+			ticking += due.size();
+		}
+		for (auto const& d : due) {
+			Hosted* h = d.first;
+			std::size_t id = d.second;
+			pool.submit("world_tick", jobs::Priority::High, [this, h, id] {run(*h, id);});
+		}
+		return next;
+	}
+	/**
+	 * @brief Step until the stop flag is set, sleeping while no World is due.
+	 *
+	 * @param stop (const std::atomic<bool>&) Set by another thread to return.
+	 * @param maxSleep (std::uint64_t) Longest sleep in nanoseconds, bounds the delay of woken Worlds.
+	 */
+	void run(const std::atomic<bool>& stop, std::uint64_t maxSleep = 1000000) {
+		while (!stop.load(std::memory_order_acquire)) {
+			std::uint64_t next = step();
+			std::uint64_t now = profiler::now();
+			if (next > now) std::this_thread::sleep_for(std::chrono::nanoseconds(std::min(next - now, maxSleep)));
+		}
+	}
+	std::size_t size() const {
+		std::lock_guard<std::mutex> lock(hostMutex);
+		return worlds.size();
+	}
+	std::size_t getHibernating() const {
+		std::lock_guard<std::mutex> lock(hostMutex);
+		return hibernating;
+	}
+	bool isHibernating(std::size_t id) const {
+		std::lock_guard<std::mutex> lock(hostMutex);
+		return worlds[id]->hibernating;
+	}
+	std::uint64_t getTicks(std::size_t id) const {
+		std::lock_guard<std::mutex> lock(hostMutex);
+		return worlds[id]->ticks;
+	}
+	std::uint64_t getMisses(std::size_t id) const {
+		std::lock_guard<std::mutex> lock(hostMutex);
+		return worlds[id]->misses;
+	}
+	std::uint64_t getFailures(std::size_t id) const {
+		std::lock_guard<std::mutex> lock(hostMutex);
+		return worlds[id]->failures;
+	}
+	/**
+	 * @brief Publish per World metrics, labelled with the name of the World.
+	 *
+	 * @param r (metrics::Registry&) The registry, it must outlive the Host.
+	 */
+	void attachMetrics(metrics::Registry& r) {
+		std::lock_guard<std::mutex> lock(hostMutex);
+		registry = &r;
+		hibernatingGauge = &r.gauge("spacewalk_worlds_hibernating", "Hosted Worlds, that are hibernating.");
+		hibernatingGauge->set(hibernating);
+		for (auto& h : worlds) attach(*h);
+	}
+};
+
+}
+#endif
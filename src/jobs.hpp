@@ -0,0 +1,297 @@
+#ifndef JOBS
+#define JOBS
+/* Background jobs for work, that must not run on the tick thread. Jobs run on a work stealing
+ * pool, their results are handed back to the tick through a Mailbox drained at a safe point. */
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "metrics.hpp"
+#include "profiler.hpp"
+
+namespace jobs {
+
+/**
+ * @brief Priority of a job, higher priorities are picked first by every worker.
+ *
+ */
+enum class Priority {
+	High,
+	Normal,
+	Low
+};
+
+/**
+ * @brief Completions waiting for the tick. Workers post, the tick thread drains.
+ *
+ */
+class Mailbox {
+	std::mutex postsMutex;
+	std::vector<std::function<void()>> posts;
+public:
+	void post(std::function<void()> f) {
+		std::lock_guard<std::mutex> lock(postsMutex);
+		posts.push_back(std::move(f));
+	}
+	/**
+	 * @brief Run every posted completion on the calling thread.
+	 *
+	 * @return std::size_t Number of completions run.
+	 */
+	std::size_t drain() {
+		std::vector<std::function<void()>> ready;
+		{
+			std::lock_guard<std::mutex> lock(postsMutex);
+			ready.swap(posts);
+		}
+		for (auto& f : ready) f();
+		return ready.size();
+	}
+};
+
+class Pool;
+
+/**
+ * @brief A submitted job. Owned by shared_ptr, so handles and dependents keep it alive.
+ *
+ */
+class Job {
+	friend class Pool;
+	std::string type; // Name of the job type, used as metric label.
+	Priority priority;
+	std::function<void()> work;
+	std::atomic<int> pending; // Unfinished dependencies plus one while submitting.
+	std::atomic<bool> cancelled;
+	std::mutex stateMutex; // Guards done and dependents.
+	std::condition_variable finished;
+	bool done;
+	std::exception_ptr error; // Exception thrown by the work, its dependents are skipped.
+	std::vector<std::shared_ptr<Job>> dependents;
+	std::uint64_t submitted; // Timestamp of submission.
+public:
+	Job(const std::string& t, Priority p, std::function<void()> w) : type(t), priority(p), work(std::move(w)),
+		pending(1), cancelled(false), done(false), submitted(profiler::now()) {}
+	/**
+	 * @brief Cancel the job and its dependents. A job, that already started, runs to the end.
+	 *
+	 */
+	void cancel() {
+		cancelled.store(true);
+		std::lock_guard<std::mutex> lock(stateMutex);
+		for (auto& d : dependents) d->cancelled.store(true);
+	}
+	bool isCancelled() const {return cancelled.load();}
+	bool isDone() {
+		std::lock_guard<std::mutex> lock(stateMutex);
+		return done;
+	}
+	/**
+	 * @brief Block until the job finished or was skipped because of cancellation.
+	 *
+	 * @throws the exception of the work, if it threw one.
+	 */
+	void wait() {
+		std::unique_lock<std::mutex> lock(stateMutex);
+		finished.wait(lock, [this] {return done;});
+		if (error) std::rethrow_exception(error);
+	}
+};
+
+/**
+ * @typedef Handle of a submitted job.
+ *
+ */
+typedef std::shared_ptr<Job> handle;
+
+/**
+ * @brief Fixed pool of workers. Every worker has a deque per priority, it takes its own newest
+ * job and steals the oldest job of another worker, when its own deques are empty.
+ *
+ */
+class Pool {
+	struct Worker {
+		std::mutex queueMutex;
+		std::deque<handle> queues[3];
+	};
+	std::vector<std::unique_ptr<Worker>> workers;
+	std::vector<std::thread> threads;
+	std::mutex sleepMutex;
+	std::condition_variable wake;
+	std::atomic<bool> running;
+	std::atomic<std::size_t> queued; // Jobs in the deques.
+	std::atomic<std::size_t> nextWorker; // Round robin target of submissions from outside.
+	metrics::Registry* registry;
+	metrics::Gauge* depthGauge;
+	std::mutex latencyMutex;
+	std::map<std::string, metrics::Histogram*> latencies;
+
+	void enqueue(handle j) {
+		Worker& w = *workers[nextWorker.fetch_add(1, std::memory_order_relaxed) % workers.size()];
+		std::size_t depth = queued.fetch_add(1) + 1;
+		if (depthGauge) depthGauge->set(depth);
+		{
+			std::lock_guard<std::mutex> lock(w.queueMutex);
+			w.queues[static_cast<int>(j->priority)].push_back(std::move(j));
+		}
+		std::lock_guard<std::mutex> lock(sleepMutex);
+		wake.notify_one();
+	}
+	handle take(std::size_t self) {
+		for (int p = 0; p < 3; p++) {
+			for (std::size_t i = 0; i < workers.size(); i++) {
+				Worker& w = *workers[(self + i) % workers.size()];
+				std::lock_guard<std::mutex> lock(w.queueMutex);
+				std::deque<handle>& q = w.queues[p];
+				if (q.empty()) continue;
+				handle j;
+				if (i == 0) {
+					j = std::move(q.back());
+					q.pop_back();
+				} else {
+					j = std::move(q.front());
+					q.pop_front();
+				}
+				std::size_t depth = queued.fetch_sub(1) - 1;
+				if (depthGauge) depthGauge->set(depth);
+				return j;
+			}
+		}
+		return handle();
+	}
+	void finish(const handle& j) {
+		std::vector<handle> ready;
+		{
+			std::lock_guard<std::mutex> lock(j->stateMutex);
+			j->done = true;
+			for (auto& d : j->dependents) {
+				if (j->cancelled.load() || j->error) d->cancelled.store(true);
+				if (d->pending.fetch_sub(1) == 1) ready.push_back(d);
+			}
+			j->dependents.clear();
+		}
+		j->finished.notify_all();
+		for (auto& d : ready) enqueue(d);
+	}
+	void observe(const handle& j) {
+		if (!registry) return;
+		metrics::Histogram* h;
+		{
+			std::lock_guard<std::mutex> lock(latencyMutex);
+			metrics::Histogram*& slot = latencies[j->type];
+			if (!slot) {
+				slot = &registry->histogram("spacewalk_job_seconds{type=\"" + j->type + "\"}",
+					metrics::Histogram::exponential(0.0001, 4, 10), "Time from submission to completion of a background job.");
+			}
+			h = slot;
+		}
+		h->observe((profiler::now() - j->submitted) / 1e9);
+	}
+	void run(std::size_t self) {
+		while (true) {
+			handle j = take(self);
+			if (!j) {
+				std::unique_lock<std::mutex> lock(sleepMutex);
+				wake.wait(lock, [this] {return !running.load() || queued.load() > 0;});
+				if (!running.load() && queued.load() == 0) return;
+				continue;
+			}
+			if (!j->cancelled.load()) {
+				try {
+					j->work();
+				} catch (...) {
+					j->error = std::current_exception();
+				}
+				observe(j);
+			}
+			finish(j);
+		}
+	}
+public:
+	/**
+	 * @brief Construct a new Pool object and start its workers.
+	 *
+	 * @param n (std::size_t) Number of workers, 0 uses one per hardware thread but the tick thread.
+	 */
+	Pool(std::size_t n = 0) : running(true), queued(0), nextWorker(0), registry(nullptr), depthGauge(nullptr) {
+		if (!n) n = std::thread::hardware_concurrency() > 1 ? std::thread::hardware_concurrency() - 1 : 1;
+		for (std::size_t i = 0; i < n; i++) workers.push_back(std::unique_ptr<Worker>(new Worker()));
+		for (std::size_t i = 0; i < n; i++) threads.push_back(std::thread(&Pool::run, this, i));
+	}
+	Pool(const Pool&) = delete;
+	Pool& operator=(const Pool&) = delete;
+	/**
+	 * @brief Destroy the Pool object, running the jobs still queued first.
+	 *
+	 */
+	~Pool() {
+		{
+			std::lock_guard<std::mutex> lock(sleepMutex);
+			running.store(false);
+		}
+		wake.notify_all();
+		for (auto& t : threads) t.join();
+	}
+	std::size_t size() const {return workers.size();}
+	/**
+	 * @brief Export the queue depth and a latency histogram per job type.
+	 *
+	 * @param r (metrics::Registry&) The registry, it must outlive the Pool.
+	 */
+	void attachMetrics(metrics::Registry& r) {
+		registry = &r;
+		depthGauge = &r.gauge("spacewalk_job_queue_depth", "Background jobs waiting for a worker.");
+	}
+	/**
+	 * @brief Submit a job, that runs after all of its dependencies finished.
+	 *
+	 * @param type (const std::string&) Name of the job type.
+	 * @param p (Priority) Priority of the job.
+	 * @param work (std::function<void()>) The work, it must not touch live World state.
+	 * @param deps (const std::vector<handle>&) Jobs, that have to finish first.
+	 * @return handle
+	 */
+	handle submit(const std::string& type, Priority p, std::function<void()> work, const std::vector<handle>& deps = {}) {
+		handle j(new Job(type, p, std::move(work)));
+		for (auto const& d : deps) {
+			std::lock_guard<std::mutex> lock(d->stateMutex);
+			if (d->done) {
+				if (d->cancelled.load() || d->error) j->cancelled.store(true);
+				continue;
+			}
+			j->pending.fetch_add(1);
+			d->dependents.push_back(j);
+		}
+		if (j->pending.fetch_sub(1) == 1) enqueue(j);
+		return j;
+	}
+	/**
+	 * @brief Submit a job, whose result is handed to a completion on the tick thread.
+	 *
+	 * @param type (const std::string&) Name of the job type.
+	 * @param p (Priority) Priority of the job.
+	 * @param work (std::function<T()>) The work, it must not touch live World state.
+	 * @param mailbox (Mailbox&) Mailbox drained by the tick.
+	 * @param complete (std::function<void(T&)>) Runs on the tick thread with the result.
+	 * @param deps (const std::vector<handle>&) Jobs, that have to finish first.
+	 * @return handle
+	 */
+	template <typename T>
+	handle submit(const std::string& type, Priority p, std::function<T()> work, Mailbox& mailbox,
+		std::function<void(T&)> complete, const std::vector<handle>& deps = {}) {
+		Mailbox* m = &mailbox;
+		return submit(type, p, [work, m, complete]() {
+			std::shared_ptr<T> result(new T(work()));
+			m->post([result, complete]() {complete(*result);});
+		}, deps);
+	}
+};
+
+}
+#endif
@@ -0,0 +1,475 @@
+#ifndef KV
+#define KV
+/* Embedded key value store for per player data, a small log structured merge tree. Writes go to a
+ * log, one fdatasync per batch, and into a sorted memtable. A full memtable is written as an
+ * immutable sorted table, whose keys stay in memory and whose values are read with pread(). When
+ * there are too many tables, they are merged into one.
+ *
+ * Log record: u32 body length, u32 checksum, body: u8 tombstone, key, value.
+ * Table "sst-<number>.sst": "SWSST002", u64 count, u32 section count, u32 CRC32C of the header so
+ * far, and the sections of wal::putSection(), whose bodies hold entries of key, u8 tombstone,
+ * value. Strings are u32 length and characters. Every section is verified when a table is opened,
+ * in parallel on a pool. */
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "wal.hpp"
+
+namespace kv {
+
+/**
+ * @brief Puts and erases, that are written together.
+ *
+ */
+class Batch {
+	friend class Store;
+	std::string records; // Encoded log records.
+	std::vector<std::pair<std::string, std::pair<bool, std::string>>> entries; // Key, tombstone and value.
+	void add(const std::string& key, bool tombstone, const std::string& value) {
+		std::size_t at = records.size();
+		wal::put<std::uint32_t>(records, 0);
+		wal::put<std::uint32_t>(records, 0);
+		wal::put<std::uint8_t>(records, tombstone);
+		wal::putString(records, key);
+		wal::putString(records, value);
+		std::uint32_t length = records.size() - at - 8;
+		std::uint32_t sum = wal::checksum(&records[at + 8], length);
+		std::memcpy(&records[at], &length, 4);
+		std::memcpy(&records[at + 4], &sum, 4);
+		entries.push_back(std::make_pair(key, std::make_pair(tombstone, value)));
+	}
+public:
+	Batch& put(const std::string& key, const std::string& value) {
+		add(key, false, value);
+		return *this;
+	}
+	Batch& erase(const std::string& key) {
+		add(key, true, "");
+		return *this;
+	}
+	std::size_t size() const {return entries.size();}
+	bool empty() const {return entries.empty();}
+	void clear() {
+		records.clear();
+		entries.clear();
+	}
+};
+
+/**
+ * @brief The store of a directory.
+ *
+ */
+class Store {
+	/**
+	 * @brief An immutable sorted table, only its keys are held in memory.
+	 *
+	 */
+	struct Table {
+		std::uint64_t number;
+		std::string path;
+		int fd = -1;
+		std::vector<std::string> keys;
+		std::vector<std::uint64_t> offsets; // Position of every value.
+		std::vector<std::uint32_t> lengths;
+		std::vector<std::uint8_t> tombstones;
+		~Table() {
+			if (fd >= 0) ::close(fd);
+		}
+	};
+	typedef std::pair<bool, std::string> Value; // Tombstone and value.
+	std::string dir;
+	std::size_t flushBytes; // Memtable size, that triggers a flush.
+	std::size_t maxTables; // Table count, that triggers a merge.
+	jobs::Pool* pool; // Verifies the sections of opened tables in parallel, may be null.
+	int logFd; // -1 after a write, whose torn record could not be cut off.
+	std::size_t logSize; // Bytes of whole records in the log.
+	std::map<std::string, Value> memtable;
+	std::size_t memtableBytes;
+	std::vector<std::unique_ptr<Table>> tables; // Oldest first.
+	std::uint64_t nextTable;
+	std::string logPath() const {return dir + "/kv.log";}
+	/**
+	 * @brief Open a table and read its keys.
+	 *
+	 * @return std::unique_ptr<Table> Null if the table is corrupt.
+	 */
+	std::unique_ptr<Table> openTable(std::uint64_t number, const std::string& path) {
+		std::string data = wal::readFile(path);
+		std::unique_ptr<Table> t(new Table());
+		t->number = number;
+		t->path = path;
+		auto entries = [&](wal::Cursor& c, std::uint64_t limit) {
+			while (!c.atEnd() && t->keys.size() < limit) {
+				std::string key;
+				std::uint8_t tombstone;
+				std::uint32_t n;
+				if (!c.getString(key) || !c.get(tombstone) || !c.get(n)) return false;
+				t->keys.push_back(std::move(key));
+				t->tombstones.push_back(tombstone);
+				t->offsets.push_back(c.position());
+				t->lengths.push_back(n);
+				if (!c.skip(n)) return false;
+			}
+			return c.atEnd();
+		};
+		std::uint64_t count;
+		if (data.size() >= 8 && !data.compare(0, 8, "SWSST002")) {
+			wal::Cursor header(data, 8, data.size());
+			std::uint32_t sections, sum;
+			if (!header.get(count) || !header.get(sections)) return nullptr;
+			std::uint32_t expected = crc32c::compute(data.data(), header.position());
+			std::vector<std::pair<std::size_t, std::size_t>> bodies;
+			if (!header.get(sum) || sum != expected || !wal::readSections(data, header.position(), sections, bodies, pool)) return nullptr;
+			for (auto const& b : bodies) {
+				wal::Cursor c(data, b.first, b.first + b.second);
+				if (!entries(c, count)) return nullptr;
+			}
+		} else {
+			/* Version 1 has one FNV-1a checksum over the whole file. */
+			if (data.size() < 20 || data.compare(0, 8, "SWSST001")) return nullptr;
+			std::uint32_t sum;
+			std::memcpy(&sum, &data[data.size() - 4], 4);
+			if (wal::checksum(data.data(), data.size() - 4) != sum) return nullptr;
+			wal::Cursor c(data, 8, data.size() - 4);
+			if (!c.get(count) || !entries(c, count)) return nullptr;
+		}
+		if (t->keys.size() != count) return nullptr;
+		t->fd = ::open(path.c_str(), O_RDONLY);
+		if (t->fd < 0) return nullptr;
+		return t;
+	}
+	/**
+	 * @brief Write sorted entries as a new table, durably.
+	 *
+	 * @return std::unique_ptr<Table> The table, it is not in the tables yet.
+	 */
+	std::unique_ptr<Table> writeTable(const std::map<std::string, Value>& entries) {
+		std::vector<std::string> bodies(1);
+		for (auto const& e : entries) {
+			if (bodies.back().size() >= wal::sectionBytes) bodies.emplace_back();
+			wal::putString(bodies.back(), e.first);
+			wal::put<std::uint8_t>(bodies.back(), e.second.first);
+			wal::putString(bodies.back(), e.second.second);
+		}
+		std::string data = "SWSST002";
+		wal::put<std::uint64_t>(data, entries.size());
+		wal::put<std::uint32_t>(data, bodies.size());
+		wal::put(data, crc32c::compute(data.data(), data.size()));
+		for (std::string const& b : bodies) wal::putSection(data, b);
+		std::uint64_t number = nextTable++;
+		std::string path = dir + "/" + wal::fileName("sst-", number, ".sst");
+		std::string temporary = path + ".tmp";
+		int fd = ::open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+		if (fd < 0) throw std::runtime_error("kv: cannot create " + temporary);
+		bool ok = wal::writeAll(fd, data.data(), data.size()) && ::fdatasync(fd) == 0;
+		::close(fd);
+		if (!ok || std::rename(temporary.c_str(), path.c_str())) throw std::runtime_error("kv: cannot write " + path);
+		wal::syncDirectory(dir);
+		std::unique_ptr<Table> t = openTable(number, path);
+		if (!t) throw std::runtime_error("kv: cannot read back " + path);
+		return t;
+	}
+	/**
+	 * @brief Read a value of a table.
+	 *
+	 */
+	std::string readValue(const Table& t, std::size_t i) const {
+		std::string value(t.lengths[i], '\0');
+		if (t.lengths[i] && ::pread(t.fd, &value[0], t.lengths[i], t.offsets[i]) != static_cast<ssize_t>(t.lengths[i])) {
+			throw std::runtime_error("kv: cannot read " + t.path);
+		}
+		return value;
+	}
+	/**
+	 * @brief Merge every table into one, dropping overwritten values and tombstones. The old
+	 * tables are only dropped once the merged one is durable.
+	 *
+	 */
+	void merge() {
+		std::map<std::string, Value> merged;
+		for (auto const& t : tables) {
+			for (std::size_t i = 0; i < t->keys.size(); i++) {
+				if (t->tombstones[i]) {
+					merged.erase(t->keys[i]);
+				} else {
+					merged[t->keys[i]] = Value(false, readValue(*t, i));
+				}
+			}
+		}
+		std::unique_ptr<Table> t = writeTable(merged);
+		std::vector<std::unique_ptr<Table>> old;
+		old.swap(tables);
+		tables.push_back(std::move(t));
+		for (auto const& o : old) ::unlink(o->path.c_str());
+		wal::syncDirectory(dir);
+	}
+	void openLog() {
+		logFd = ::open(logPath().c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+		if (logFd < 0) throw std::runtime_error("kv: cannot open " + logPath());
+		logSize = 0;
+	}
+public:
+	/**
+	 * @brief Open the store of a directory, reading the keys of its tables and replaying its log.
+	 *
+	 * @param d (const std::string&) The directory, it has to exist.
+	 * @param flush (std::size_t) Memtable bytes, that trigger writing a table.
+	 * @param merge (std::size_t) Tables, that trigger merging them into one.
+	 * @param p (jobs::Pool*) Pool, that verifies the sections of the tables in parallel, null
+	 * verifies on the calling thread.
+	 * @throws std::runtime_error if a table is corrupt or the log cannot be opened.
+	 */
+	Store(const std::string& d, std::size_t flush = 4 << 20, std::size_t merge = 4, jobs::Pool* p = nullptr)
+		: dir(d), flushBytes(flush), maxTables(merge ? merge : 1), pool(p), logFd(-1), logSize(0), memtableBytes(0), nextTable(1) {
+		for (auto const& f : wal::list(dir, "sst-", ".sst")) {
+			std::unique_ptr<Table> t = openTable(f.first, f.second);
+			if (!t) throw std::runtime_error("kv: corrupt table " + f.second);
+			tables.push_back(std::move(t));
+			nextTable = f.first + 1;
+		}
+		std::string log = wal::readFile(logPath());
+		std::size_t pos = 0;
+		while (pos + 8 <= log.size()) {
+			std::uint32_t length, sum;
+			std::memcpy(&length, &log[pos], 4);
+			std::memcpy(&sum, &log[pos + 4], 4);
+			if (pos + 8 + length > log.size() || wal::checksum(&log[pos + 8], length) != sum) break;
+			std::size_t p = pos + 9;
+			std::uint32_t n;
+			std::memcpy(&n, &log[p], 4);
+			std::string key = log.substr(p + 4, n);
+			p += 4 + n;
+			std::memcpy(&n, &log[p], 4);
+			memtableBytes += key.size() + n;
+			memtable[key] = Value(log[pos + 8] != 0, log.substr(p + 4, n));
+			pos += 8 + length;
+		}
+		openLog();
+		/* A torn record at the end would hide the batches written after it. */
+		if (pos < log.size() && (::ftruncate(logFd, pos) || ::fdatasync(logFd))) {
+			throw std::runtime_error("kv: cannot truncate " + logPath());
+		}
+		logSize = pos;
+	}
+	Store(const Store&) = delete;
+	Store& operator=(const Store&) = delete;
+	~Store() {
+		if (logFd >= 0) ::close(logFd);
+	}
+	/**
+	 * @brief Write a batch durably with one fdatasync. A full memtable is flushed afterwards, on
+	 * the calling thread.
+	 *
+	 * @param b (const Batch&) The batch.
+	 * @throws std::runtime_error if the log cannot be written. The log is cut back to the batches
+	 * before, if that fails too, the store refuses further writes.
+	 */
+	void write(const Batch& b) {
+		if (b.empty()) return;
+		if (logFd < 0) throw std::runtime_error("kv: cannot write " + logPath());
+		if (!wal::writeAll(logFd, b.records.data(), b.records.size()) || ::fdatasync(logFd)) {
+			if (::ftruncate(logFd, logSize)) {
+				::close(logFd);
+				logFd = -1;
+			}
+			throw std::runtime_error("kv: cannot write " + logPath());
+		}
+		logSize += b.records.size();
+		for (auto const& e : b.entries) {
+			memtableBytes += e.first.size() + e.second.second.size();
+			memtable[e.first] = e.second;
+		}
+		if (memtableBytes >= flushBytes) flush();
+	}
+	/**
+	 * @brief Read a value.
+	 *
+	 * @param key (const std::string&) The key.
+	 * @param value (std::string&) Receives the value.
+	 * @return false if the key does not exist.
+	 */
+	bool get(const std::string& key, std::string& value) const {
+		auto m = memtable.find(key);
+		if (m != memtable.end()) {
+			if (m->second.first) return false;
+			value = m->second.second;
+			return true;
+		}
+		for (auto t = tables.rbegin(); t != tables.rend(); t++) {
+			auto it = std::lower_bound((*t)->keys.begin(), (*t)->keys.end(), key);
+			if (it == (*t)->keys.end() || *it != key) continue;
+			std::size_t i = it - (*t)->keys.begin();
+			if ((*t)->tombstones[i]) return false;
+			value = readValue(**t, i);
+			return true;
+		}
+		return false;
+	}
+	/**
+	 * @brief Write the memtable as a table and start a new log, merging the tables if there are too many.
+	 * Runs on the calling thread: writing the table takes an fdatasync, a merge reads and rewrites
+	 * every table.
+	 *
+	 * @throws std::runtime_error if the table cannot be written.
+	 */
+	void flush() {
+		if (memtable.empty()) return;
+		tables.push_back(writeTable(memtable));
+		memtable.clear();
+		memtableBytes = 0;
+		if (logFd >= 0) ::close(logFd);
+		::unlink(logPath().c_str());
+		openLog();
+		wal::syncDirectory(dir);
+		if (tables.size() > maxTables) merge();
+	}
+	std::size_t tableCount() const {return tables.size();}
+};
+
+/**
+ * @brief The persisted part of a player's Entity.
+ *
+ */
+struct Profile {
+	std::string name;
+	int hp;
+	int stamina;
+	std::vector<Prefab::Slot> items;
+	/**
+	 * @brief Copy the persisted state of an Entity.
+	 *
+	 */
+	static Profile of(const Entity& e) {
+		Profile p = {e.getName(), e.getHp(), e.getStamina(), {}};
+		for (item const& i : e.getItems()) {
+			const Key* k = dynamic_cast<const Key*>(i.get());
+			p.items.push_back({i->getName(), k ? k->getKeyID() : std::string()});
+		}
+		return p;
+	}
+	/**
+	 * @brief Create the Entity of the profile.
+	 *
+	 */
+	std::unique_ptr<Entity> toEntity() const {
+		std::unique_ptr<Entity> e(new Entity(name, hp, stamina));
+		for (Prefab::Slot const& s : items) {
+			item i(s.keyID.empty() ? new Object(s.name) : new Key(s.name, s.keyID));
+			e->addItem(i);
+		}
+		return e;
+	}
+	std::string encode() const {
+		std::string out;
+		wal::putString(out, name);
+		wal::put<std::int32_t>(out, hp);
+		wal::put<std::int32_t>(out, stamina);
+		wal::put<std::uint32_t>(out, items.size());
+		for (Prefab::Slot const& s : items) {
+			wal::putString(out, s.name);
+			wal::putString(out, s.keyID);
+		}
+		return out;
+	}
+	/**
+	 * @brief Decode an encoded profile.
+	 *
+	 * @throws std::runtime_error if the data is truncated.
+	 */
+	static Profile decode(const std::string& data) {
+		std::size_t pos = 0;
+		auto get = [&](void* v, std::size_t n) {
+			if (pos + n > data.size()) throw std::runtime_error("kv: truncated profile");
+			std::memcpy(v, &data[pos], n);
+			pos += n;
+		};
+		auto getString = [&]() {
+			std::uint32_t n;
+			get(&n, 4);
+			if (pos + n > data.size()) throw std::runtime_error("kv: truncated profile");
+			pos += n;
+			return data.substr(pos - n, n);
+		};
+		Profile p;
+		p.name = getString();
+		std::int32_t v;
+		get(&v, 4);
+		p.hp = v;
+		get(&v, 4);
+		p.stamina = v;
+		std::uint32_t count;
+		get(&count, 4);
+		for (std::uint32_t i = 0; i < count; i++) {
+			std::string name = getString();
+			p.items.push_back({name, getString()});
+		}
+		return p;
+	}
+};
+
+/**
+ * @brief Profiles of the players. Profiles of online players are cached, saves of a tick are
+ * written as one batch.
+ *
+ */
+class Profiles {
+	Store& store;
+	std::unordered_map<std::string, Profile> cache; // Online players.
+	Batch pending;
+	static std::string key(const std::string& name) {return "profile/" + name;}
+public:
+	Profiles(Store& s) : store(s) {}
+	/**
+	 * @brief Load a profile through the cache, the player counts as online afterwards.
+	 *
+	 * @param name (const std::string&) Name of the player.
+	 * @return const Profile* Null if there is no profile, valid until the player goes offline.
+	 */
+	const Profile* load(const std::string& name) {
+		auto it = cache.find(name);
+		if (it != cache.end()) return &it->second;
+		std::string data;
+		if (!store.get(key(name), data)) return nullptr;
+		return &cache.emplace(name, Profile::decode(data)).first->second;
+	}
+	/**
+	 * @brief Save the state of an Entity with the next endTick().
+	 *
+	 * @param e (const Entity&) The Entity of the player.
+	 */
+	void save(const Entity& e) {
+		Profile p = Profile::of(e);
+		pending.put(key(p.name), p.encode());
+		cache[p.name] = std::move(p);
+	}
+	/**
+	 * @brief Drop a player from the cache, pending saves are kept.
+	 *
+	 * @param name (const std::string&) Name of the player.
+	 */
+	void offline(const std::string& name) {cache.erase(name);}
+	/**
+	 * @brief Write the saves of the tick as one batch. When the batch fills the memtable, the
+	 * table is written and maybe merged within this call, so that tick is longer by the write of
+	 * the flush bytes, or of every table for a merge. Keep the flush size small against the tick
+	 * budget.
+	 *
+	 * @return std::size_t Number of profiles written.
+	 * @throws std::runtime_error if the store cannot be written, the saves stay pending.
+	 */
+	std::size_t endTick() {
+		std::size_t n = pending.size();
+		store.write(pending);
+		pending.clear();
+		return n;
+	}
+	std::size_t cached() const {return cache.size();}
+};
+
+}
+#endif
@@ -0,0 +1,168 @@
+#ifndef LIGHTING
+#define LIGHTING
+/* Light level of every room. A room is as bright as its own source, or as its brightest adjacent
+ * room minus a falloff, so an outage darkens the surrounding rooms too. Only rooms around a
+ * changed source are recomputed, round by round, until the levels settle. */
+#include <algorithm>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+#include "engine.hpp"
+
+namespace lighting {
+
+/**
+ * @brief Light sources and levels of the rooms of a World. The rooms and their links are read once,
+ * a Lighting has to be rebuilt when the map changes.
+ *
+ */
+class Lighting {
+	std::unordered_map<const Room*, std::uint32_t> index;
+	std::vector<std::uint32_t> offsets; // Rooms adjacent to room i, in both directions, are targets[offsets[i]] to targets[offsets[i + 1]].
+	std::vector<std::uint32_t> targets;
+	std::vector<std::uint8_t> sources;
+	std::vector<std::uint8_t> levels;
+	std::vector<std::uint8_t> next; // Levels computed in the current round.
+	std::vector<std::uint8_t> dirty; // Flags of the rooms in the worklist.
+	std::vector<std::uint32_t> worklist;
+	std::uint8_t falloff;
+	std::size_t grain; // Rooms per job.
+	/**
+	 * @brief Compute the level of a room from the levels of the last round.
+	 *
+	 */
+	std::uint8_t compute(std::uint32_t r) const {
+		int level = sources[r];
+		for (std::uint32_t e = offsets[r]; e < offsets[r + 1]; e++) {
+			level = std::max(level, levels[targets[e]] - falloff);
+		}
+		return level;
+	}
+	void computeRange(std::size_t begin, std::size_t end) {
+		for (std::size_t i = begin; i < end; i++) next[worklist[i]] = compute(worklist[i]);
+	}
+public:
+	/**
+	 * @brief Construct a new Lighting object, every room starts dark.
+	 *
+	 * @param w (const World&) The World.
+	 * @param f (std::uint8_t) Light lost per step into an adjacent room, at least 1.
+	 * @param g (std::size_t) Rooms recomputed per job, when a pool is used.
+	 */
+	Lighting(const World& w, std::uint8_t f = 64, std::size_t g = 1024) : falloff(f ? f : 1), grain(g ? g : 1) {
+		nodetable const& rooms = w.getRooms();
+		for (std::size_t i = 0; i < rooms.size(); i++) index.emplace(rooms[i].get(), i);
+		std::vector<std::vector<std::uint32_t>> adjacent(rooms.size());
+		for (std::size_t i = 0; i < rooms.size(); i++) {
+			for (node const& n : rooms[i]->getNeighbours()) {
+				auto it = index.find(n.get());
+				if (it == index.end() || it->second == i) continue;
+				adjacent[i].push_back(it->second);
+				adjacent[it->second].push_back(i);
+			}
+		}
+		offsets.push_back(0);
+		for (auto& a : adjacent) {
+			std::sort(a.begin(), a.end());
+			a.erase(std::unique(a.begin(), a.end()), a.end());
+			targets.insert(targets.end(), a.begin(), a.end());
+			offsets.push_back(targets.size());
+		}
+		sources.assign(rooms.size(), 0);
+		levels.assign(rooms.size(), 0);
+		next.assign(rooms.size(), 0);
+		dirty.assign(rooms.size(), 0);
+	}
+	std::size_t size() const {return levels.size();}
+	/**
+	 * @brief Set the light source of a room, the levels change with the next update().
+	 *
+	 * @param r (std::uint32_t) Index of the room in the World.
+	 * @param level (std::uint8_t) Brightness of the source, 0 is an outage.
+	 */
+	void setSource(std::uint32_t r, std::uint8_t level) {
+		if (sources[r] == level) return;
+		sources[r] = level;
+		if (!dirty[r]) {
+			dirty[r] = 1;
+			worklist.push_back(r);
+		}
+	}
+	/**
+	 * @brief Set the light source of a room.
+	 *
+	 * @return false if the room is not part of this Lighting.
+	 */
+	bool setSource(const Room& r, std::uint8_t level) {
+		auto it = index.find(&r);
+		if (it == index.end()) return false;
+		setSource(it->second, level);
+		return true;
+	}
+	std::uint8_t getSource(std::uint32_t r) const {return sources[r];}
+	/**
+	 * @brief Get the light level of a room as of the last update().
+	 *
+	 * @param r (std::uint32_t) Index of the room in the World.
+	 * @return std::uint8_t
+	 */
+	std::uint8_t getLevel(std::uint32_t r) const {return levels[r];}
+	/**
+	 * @brief Get the light level of a room, 0 if the room is not part of this Lighting.
+	 *
+	 */
+	std::uint8_t getLevel(const Room& r) const {
+		auto it = index.find(&r);
+		return it == index.end() ? 0 : levels[it->second];
+	}
+	/**
+	 * @brief Number of rooms waiting to be recomputed.
+	 *
+	 * @return std::size_t
+	 */
+	std::size_t pending() const {return worklist.size();}
+	/**
+	 * @brief Recompute the rooms in the worklist until the levels settle. Every round computes the
+	 * worklist from the levels of the last round, a room whose level changed puts its adjacent rooms
+	 * into the next round.
+	 *
+	 * @param pool (jobs::Pool*) Pool, that computes large rounds in parallel, null computes on the calling thread.
+	 * @return std::size_t Number of rooms recomputed.
+	 */
+	std::size_t update(jobs::Pool* pool = nullptr) {
+		std::size_t recomputed = 0;
+		std::vector<std::uint32_t> following;
+		std::vector<jobs::handle> running;
+		while (!worklist.empty()) {
+			recomputed += worklist.size();
+			if (pool && worklist.size() > grain) {
+				for (std::size_t begin = 0; begin < worklist.size(); begin += grain) {
+					std::size_t end = std::min(worklist.size(), begin + grain);
+					running.push_back(pool->submit("lighting", jobs::Priority::High, [this, begin, end] {computeRange(begin, end);}));
+				}
+				for (jobs::handle const& j : running) j->wait();
+				running.clear();
+			} else {
+				computeRange(0, worklist.size());
+			}
+			for (std::uint32_t r : worklist) dirty[r] = 0;
+			for (std::uint32_t r : worklist) {
+				if (next[r] == levels[r]) continue;
+				levels[r] = next[r];
+				for (std::uint32_t e = offsets[r]; e < offsets[r + 1]; e++) {
+					std::uint32_t t = targets[e];
+					if (!dirty[t]) {
+						dirty[t] = 1;
+						following.push_back(t);
+					}
+				}
+			}
+			worklist.swap(following);
+			following.clear();
+		}
+		return recomputed;
+	}
+};
+
+}
+#endif
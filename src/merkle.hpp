@@ -0,0 +1,408 @@
+#ifndef MERKLE
+#define MERKLE
+/* Merkle hashes of the state of a World, to tell whether a replica or a replayed session still
+ * matches the original. Every room and every entity is a leaf, the hash of a node covers its two
+ * children. An update re-hashes only the leaves, whose version changed since the last one, and the
+ * nodes above them, and two trees are compared by descending only into differing subtrees, so
+ * finding k divergent rooms costs O(k log n). */
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "engine.hpp"
+
+namespace merkle {
+
+typedef std::uint64_t hash;
+
+/**
+ * @brief Hashes bytes with 64 bit FNV-1a.
+ *
+ */
+class Hasher {
+	hash value;
+public:
+	Hasher() : value(14695981039346656037ull) {}
+	Hasher& add(const void* data, std::size_t n) {
+		const unsigned char* p = static_cast<const unsigned char*>(data);
+		for (std::size_t i = 0; i < n; i++) value = (value ^ p[i]) * 1099511628211ull;
+		return *this;
+	}
+	/**
+	 * @brief Add a string with its length, so "ab", "c" and "a", "bc" differ.
+	 *
+	 */
+	Hasher& add(const std::string& s) {
+		std::uint64_t n = s.size();
+		return add(&n, sizeof(n)).add(s.data(), s.size());
+	}
+	Hasher& add(std::int64_t v) {return add(&v, sizeof(v));}
+	hash get() const {return value;}
+};
+
+/**
+ * @brief Hash of two children.
+ *
+ */
+inline hash combine(hash left, hash right) {
+	hash h = left * 0x9E3779B97F4A7C15ull ^ (right + 0x632BE59BD9B4E019ull + (left << 6) + (left >> 2));
+	h ^= h >> 31;
+	h *= 0xBF58476D1CE4E5B9ull;
+	return h ^ (h >> 29);
+}
+
+/**
+ * @brief Hash of the name and the items of a room. Rooms, whose prefab items were not created yet,
+ * hash like the same items created.
+ *
+ */
+inline hash hashRoom(const Room& r) {
+	Hasher h;
+	h.add(r.getName());
+	if (!r.isStocked()) {
+		h.add(static_cast<std::int64_t>(r.getPrefab()->layout.size()));
+		for (Prefab::Slot const& s : r.getPrefab()->layout) h.add(s.name).add(s.keyID);
+	} else {
+		h.add(static_cast<std::int64_t>(r.getItems().size()));
+		for (item const& i : r.getItems()) {
+			const Key* k = dynamic_cast<const Key*>(i.get());
+			h.add(i->getName()).add(k ? k->getKeyID() : std::string());
+		}
+	}
+	return h.get();
+}
+
+/**
+ * @brief Hash of the name, the hit points, the stamina and the items of an entity.
+ *
+ */
+inline hash hashEntity(const Entity& e) {
+	Hasher h;
+	h.add(e.getName()).add(static_cast<std::int64_t>(e.getHp())).add(static_cast<std::int64_t>(e.getStamina()));
+	h.add(static_cast<std::int64_t>(e.getItems().size()));
+	for (item const& i : e.getItems()) {
+		const Key* k = dynamic_cast<const Key*>(i.get());
+		h.add(i->getName()).add(k ? k->getKeyID() : std::string());
+	}
+	return h.get();
+}
+
+/**
+ * @brief A complete binary tree of hashes over a sequence of leaves, stored as an array with the
+ * root at 1 and the children of node i at 2i and 2i + 1. Missing leaves hash to 0.
+ *
+ */
+class Hashes {
+	std::size_t leaves;
+	std::size_t capacity; // Power of two, index of the first leaf.
+	std::vector<hash> nodes;
+	std::vector<std::size_t> dirty; // Nodes of the current level, whose children changed.
+	std::vector<std::uint8_t> marked;
+public:
+	Hashes() : leaves(0), capacity(1), nodes(2, 0), marked(2, 0) {}
+	/**
+	 * @brief Resize to n leaves. Added leaves hash to 0 until they are set, removed ones are set to
+	 * 0. A full tree doubles its capacity and becomes the left half of the new one, so no hash is
+	 * computed again and appending n leaves costs O(n) in total.
+	 *
+	 */
+	void resize(std::size_t n) {
+		for (std::size_t i = n; i < leaves; i++) set(i, 0);
+		leaves = n;
+		if (n <= capacity) return;
+		propagate();
+		std::size_t grown = capacity;
+		while (grown < n) grown *= 2;
+		std::vector<hash> next(2 * grown);
+		hash empty = 0; // Hash of a subtree without leaves, at the level being filled.
+		for (std::size_t width = grown; width; width /= 2) {
+			std::size_t kept = width / (grown / capacity); // Nodes of the old tree on this level.
+			if (kept) {
+				std::copy(nodes.begin() + kept, nodes.begin() + 2 * kept, next.begin() + width);
+			} else {
+				next[width] = combine(next[2 * width], next[2 * width + 1]);
+				kept = 1;
+			}
+			std::fill(next.begin() + width + kept, next.begin() + 2 * width, empty);
+			empty = combine(empty, empty);
+		}
+		nodes.swap(next);
+		marked.assign(2 * grown, 0);
+		capacity = grown;
+	}
+	std::size_t size() const {return leaves;}
+	std::size_t getCapacity() const {return capacity;}
+	hash root() const {return nodes[1];}
+	hash at(std::size_t node) const {return nodes[node];}
+	hash leaf(std::size_t i) const {return nodes[capacity + i];}
+	/**
+	 * @brief Set the hash of a leaf, its path is recomputed by the next propagate().
+	 *
+	 */
+	void set(std::size_t i, hash h) {
+		std::size_t n = capacity + i;
+		if (nodes[n] == h) return;
+		nodes[n] = h;
+		std::size_t parent = n / 2;
+		if (parent && !marked[parent]) {
+			marked[parent] = 1;
+			dirty.push_back(parent);
+		}
+	}
+	/**
+	 * @brief Recompute the nodes above the changed leaves, level by level.
+	 *
+	 * @return std::size_t Number of recomputed nodes.
+	 */
+	std::size_t propagate() {
+		std::size_t recomputed = 0;
+		std::vector<std::size_t> next;
+		while (!dirty.empty()) {
+			next.clear();
+			for (std::size_t n : dirty) {
+				marked[n] = 0;
+				nodes[n] = combine(nodes[2 * n], nodes[2 * n + 1]);
+				recomputed++;
+				std::size_t parent = n / 2;
+				if (parent && !marked[parent]) {
+					marked[parent] = 1;
+					next.push_back(parent);
+				}
+			}
+			dirty.swap(next);
+		}
+		return recomputed;
+	}
+	/**
+	 * @brief Collect the leaves, that differ from another tree of the same capacity.
+	 *
+	 * @param other (const Hashes&) The other tree.
+	 * @param out (std::vector<std::size_t>&) Receives the indices of the differing leaves.
+	 * @param node (std::size_t) Subtree to compare.
+	 */
+	void diff(const Hashes& other, std::vector<std::size_t>& out, std::size_t node = 1) const {
+		if (nodes[node] == other.nodes[node]) return;
+		if (node >= capacity) {
+			out.push_back(node - capacity);
+			return;
+		}
+		diff(other, out, 2 * node);
+		diff(other, out, 2 * node + 1);
+	}
+};
+
+/**
+ * @brief Rooms and entities, that differ between two trees.
+ *
+ */
+struct Diff {
+	std::vector<std::size_t> rooms; // Indices into World::getRooms().
+	std::vector<std::size_t> entities; // Indices into World::getEntities().
+	bool empty() const {return rooms.empty() && entities.empty();}
+};
+
+/**
+ * @brief Merkle tree of the rooms and entities of a World. Code, that changes a room or an entity,
+ * touches it, and the next update() hashes only the touched leaves and their paths. scan() finds
+ * changes by their versions instead, for code, that does not touch. Both must run on the tick
+ * thread, while no system and no transaction changes the World. Rooms and entities added to the
+ * World, and copies a fork made of them, are picked up by the next touch, update() or scan().
+ *
+ */
+class Tree {
+	/**
+	 * @brief What a leaf was hashed from, to find out by a scan whether it changed.
+	 *
+	 */
+	struct Seen {
+		std::uint64_t version;
+		int hp;
+		int stamina;
+	};
+	const World& world;
+	std::unordered_map<const Room*, std::size_t> roomIndex;
+	std::unordered_map<const Entity*, std::size_t> entityIndex;
+	Hashes rooms;
+	Hashes people;
+	std::vector<Seen> seenRooms;
+	std::vector<Seen> seenEntities;
+	std::vector<std::size_t> touchedRooms;
+	std::vector<std::size_t> touchedEntities;
+	std::vector<std::uint8_t> roomTouched;
+	std::vector<std::uint8_t> entityTouched;
+	std::size_t rehashed; // Leaves hashed by the last update.
+	/**
+	 * @brief Follow rooms and entities added to the World, new leaves count as touched.
+	 *
+	 */
+	void grow() {
+		nodetable const& r = world.getRooms();
+		if (r.size() != rooms.size()) {
+			std::size_t first = rooms.size();
+			rooms.resize(r.size());
+			seenRooms.resize(r.size());
+			roomTouched.resize(r.size(), 0);
+			for (std::size_t i = first; i < r.size(); i++) {
+				roomIndex[r[i].get()] = i;
+				markRoom(i);
+			}
+		}
+		entitytable const& e = world.getEntities();
+		if (e.size() != people.size()) {
+			std::size_t first = people.size();
+			people.resize(e.size());
+			seenEntities.resize(e.size());
+			entityTouched.resize(e.size(), 0);
+			for (std::size_t i = first; i < e.size(); i++) {
+				entityIndex[e[i].get()] = i;
+				markEntity(i);
+			}
+		}
+	}
+	/**
+	 * @brief Index the copies, that a fork put in place of shared rooms and entities. Only called
+	 * when a lookup misses, the shared originals keep their index too.
+	 *
+	 */
+	void reindex() {
+		std::size_t i = 0;
+		for (node const& r : world.getRooms()) roomIndex[r.get()] = i++;
+		i = 0;
+		for (std::shared_ptr<Entity> const& e : world.getEntities()) entityIndex[e.get()] = i++;
+	}
+	template <typename T>
+	static bool find(const std::unordered_map<const T*, std::size_t>& index, const T* key, std::size_t& i) {
+		auto it = index.find(key);
+		if (it == index.end()) return false;
+		i = it->second;
+		return true;
+	}
+	void markRoom(std::size_t i) {
+		if (roomTouched[i]) return;
+		roomTouched[i] = 1;
+		touchedRooms.push_back(i);
+	}
+	void markEntity(std::size_t i) {
+		if (entityTouched[i]) return;
+		entityTouched[i] = 1;
+		touchedEntities.push_back(i);
+	}
+public:
+	/**
+	 * @brief Construct a new Tree object. Every room and entity is hashed by the first update().
+	 *
+	 * @param w (const World&) The World, it must outlive the tree.
+	 */
+	Tree(const World& w) : world(w), rehashed(0) {grow();}
+	/**
+	 * @brief Mark a room as changed.
+	 *
+	 * @param r (const Room&) A room of the World, or the copy a fork made of it.
+	 * @return false if the room is not in the World.
+	 */
+	bool touch(const Room& r) {
+		grow();
+		std::size_t i;
+		if (!find(roomIndex, &r, i)) {
+			reindex();
+			if (!find(roomIndex, &r, i)) return false;
+		}
+		markRoom(i);
+		return true;
+	}
+	/**
+	 * @brief Mark an entity as changed.
+	 *
+	 * @param e (const Entity&) An entity of the World, or the copy a fork made of it.
+	 * @return false if the entity is not in the World.
+	 */
+	bool touch(const Entity& e) {
+		grow();
+		std::size_t i;
+		if (!find(entityIndex, &e, i)) {
+			reindex();
+			if (!find(entityIndex, &e, i)) return false;
+		}
+		markEntity(i);
+		return true;
+	}
+	/**
+	 * @brief Hash the touched rooms and entities again, and the nodes above them.
+	 *
+	 * @return std::size_t Number of leaves hashed.
+	 */
+	std::size_t update() {
+		grow();
+		nodetable const& r = world.getRooms();
+		for (std::size_t i : touchedRooms) {
+			roomTouched[i] = 0;
+			rooms.set(i, hashRoom(*r[i]));
+			seenRooms[i].version = r[i]->getVersion().get();
+		}
+		entitytable const& t = world.getEntities();
+		for (std::size_t i : touchedEntities) {
+			const Entity& e = *t[i];
+			entityTouched[i] = 0;
+			people.set(i, hashEntity(e));
+			seenEntities[i] = Seen{e.getVersion().get(), e.getHp(), e.getStamina()};
+		}
+		rehashed = touchedRooms.size() + touchedEntities.size();
+		touchedRooms.clear();
+		touchedEntities.clear();
+		rooms.propagate();
+		people.propagate();
+		return rehashed;
+	}
+	/**
+	 * @brief Touch every room and entity, whose inventory version, hit points or stamina changed
+	 * since it was hashed, then update. Costs a look at every room, renamed rooms are missed.
+	 *
+	 * @return std::size_t Number of leaves hashed.
+	 */
+	std::size_t scan() {
+		grow();
+		std::size_t i = 0;
+		for (node const& r : world.getRooms()) {
+			if (r->getVersion().get() != seenRooms[i].version) markRoom(i);
+			i++;
+		}
+		i = 0;
+		for (std::shared_ptr<Entity> const& e : world.getEntities()) {
+			Seen const& s = seenEntities[i];
+			if (e->getVersion().get() != s.version || e->getHp() != s.hp || e->getStamina() != s.stamina) markEntity(i);
+			i++;
+		}
+		return update();
+	}
+	/**
+	 * @brief Hash of the whole state, as of the last update().
+	 *
+	 * @return hash
+	 */
+	hash root() const {return combine(rooms.root(), people.root());}
+	hash roomHash(std::size_t i) const {return rooms.leaf(i);}
+	hash entityHash(std::size_t i) const {return people.leaf(i);}
+	std::size_t getRehashed() const {return rehashed;}
+	/**
+	 * @brief Find the rooms and entities, that differ from another tree.
+	 *
+	 * @param other (const Tree&) Tree of a World with the same rooms and entities in the same order.
+	 * @return Diff
+	 * @throws std::invalid_argument if the trees hold different numbers of rooms or entities.
+	 */
+	Diff diff(const Tree& other) const {
+		if (rooms.size() != other.rooms.size() || people.size() != other.people.size()
+			|| rooms.getCapacity() != other.rooms.getCapacity() || people.getCapacity() != other.people.getCapacity()) {
+			throw std::invalid_argument("merkle: trees of differently sized worlds");
+		}
+		Diff d;
+		rooms.diff(other.rooms, d.rooms);
+		people.diff(other.people, d.entities);
+		return d;
+	}
+};
+
+}
+#endif
@@ -0,0 +1,350 @@
+#ifndef METRICS
+#define METRICS
+/* Engine metrics. Updates are relaxed atomics, so the tick never waits for a scrape,
+ * rendering reads the atomics from the endpoint thread. */
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+namespace metrics {
+
+/**
+ * @brief Monotonically increasing value.
+ *
+ */
+class Counter {
+	std::atomic<std::uint64_t> value;
+public:
+	Counter() : value(0) {}
+	void inc(std::uint64_t n = 1) {value.fetch_add(n, std::memory_order_relaxed);}
+	std::uint64_t get() const {return value.load(std::memory_order_relaxed);}
+};
+
+/**
+ * @brief Value, that can go up and down.
+ *
+ */
+class Gauge {
+	std::atomic<double> value;
+public:
+	Gauge() : value(0) {}
+	void set(double v) {value.store(v, std::memory_order_relaxed);}
+	void add(double v) {
+		double old = value.load(std::memory_order_relaxed);
+		while (!value.compare_exchange_weak(old, old + v, std::memory_order_relaxed)) {}
+	}
+	double get() const {return value.load(std::memory_order_relaxed);}
+};
+
+/**
+ * @brief Distribution of observed values in fixed, cumulative buckets.
+ *
+ */
+class Histogram {
+	std::vector<double> bounds; // Upper bounds of the buckets, ascending.
+	std::unique_ptr<std::atomic<std::uint64_t>[]> buckets; // One more than bounds, the last is +Inf.
+	std::atomic<std::uint64_t> count;
+	std::atomic<double> sum;
+public:
+	/**
+	 * @brief Construct a new Histogram object
+	 *
+	 * @param b (const std::vector<double>&) Ascending upper bounds of the buckets.
+	 */
+	Histogram(const std::vector<double>& b) : bounds(b), buckets(new std::atomic<std::uint64_t>[b.size() + 1]), count(0), sum(0) {
+		for (std::size_t i = 0; i <= bounds.size(); i++) buckets[i].store(0, std::memory_order_relaxed);
+	}
+	/**
+	 * @brief Record a value.
+	 *
+	 * @param v (double) The observed value.
+	 */
+	void observe(double v) {
+		std::size_t i = 0;
+		while (i < bounds.size() && v > bounds[i]) i++;
+		buckets[i].fetch_add(1, std::memory_order_relaxed);
+		count.fetch_add(1, std::memory_order_relaxed);
+		double old = sum.load(std::memory_order_relaxed);
+		while (!sum.compare_exchange_weak(old, old + v, std::memory_order_relaxed)) {}
+	}
+	std::vector<double> const& getBounds() const {return bounds;}
+	std::uint64_t getCount() const {return count.load(std::memory_order_relaxed);}
+	double getSum() const {return sum.load(std::memory_order_relaxed);}
+	/**
+	 * @brief Get the number of observations in one bucket, not cumulative.
+	 *
+	 * @param i (std::size_t) Index of the bucket, bounds.size() is the +Inf bucket.
+	 * @return std::uint64_t
+	 */
+	std::uint64_t getBucket(std::size_t i) const {return buckets[i].load(std::memory_order_relaxed);}
+	/**
+	 * @brief Estimate a quantile by linear interpolation inside its bucket, like histogram_quantile().
+	 *
+	 * @param q (double) The quantile between 0 and 1.
+	 * @return double
+	 */
+	double quantile(double q) const {
+		std::uint64_t total = 0;
+		for (std::size_t i = 0; i <= bounds.size(); i++) total += getBucket(i);
+		if (!total) return 0;
+		double rank = q * total;
+		std::uint64_t seen = 0;
+		for (std::size_t i = 0; i < bounds.size(); i++) {
+			std::uint64_t n = getBucket(i);
+			if (seen + n >= rank && n) {
+				double lower = i ? bounds[i - 1] : 0;
+				return lower + (bounds[i] - lower) * (rank - seen) / n;
+			}
+			seen += n;
+		}
+		return bounds.empty() ? 0 : bounds.back();
+	}
+	/**
+	 * @brief Exponential bucket bounds.
+	 *
+	 * @param start (double) The first upper bound.
+	 * @param factor (double) Ratio of two neighbouring bounds.
+	 * @param n (std::size_t) Number of bounds.
+	 * @return std::vector<double>
+	 */
+	static std::vector<double> exponential(double start, double factor, std::size_t n) {
+		std::vector<double> b;
+		for (std::size_t i = 0; i < n; i++, start *= factor) b.push_back(start);
+		return b;
+	}
+};
+
+/**
+ * @brief Named metrics of the engine, rendered in the Prometheus text format.
+ * Names may carry labels, e.g. memory_bytes{subsystem="rooms"}, metrics with the same
+ * name before the labels share one HELP and TYPE line.
+ *
+ */
+class Registry {
+	struct Entry {
+		std::string help;
+		std::unique_ptr<Counter> counter;
+		std::unique_ptr<Gauge> gauge;
+		std::unique_ptr<Histogram> histogram;
+	};
+	mutable std::mutex entriesMutex; // Only taken on registration and rendering, never on update.
+	std::map<std::string, Entry> entries;
+	static std::string family(const std::string& name) {return name.substr(0, name.find('{'));}
+	static std::string labels(const std::string& name) {
+		std::size_t b = name.find('{');
+		return b == std::string::npos ? "" : name.substr(b + 1, name.size() - b - 2);
+	}
+public:
+	/**
+	 * @brief Get or create a counter.
+	 *
+	 * @param name (const std::string&) Name of the metric, with optional labels.
+	 * @param help (const std::string&) Description of the metric.
+	 * @return Counter&
+	 */
+	Counter& counter(const std::string& name, const std::string& help = "") {
+		std::lock_guard<std::mutex> lock(entriesMutex);
+		Entry& e = entries[name];
+		if (!e.counter) {
+			e.help = help;
+			e.counter.reset(new Counter());
+		}
+		return *e.counter;
+	}
+	/**
+	 * @brief Get or create a gauge.
+	 *
+	 * @param name (const std::string&) Name of the metric, with optional labels.
+	 * @param help (const std::string&) Description of the metric.
+	 * @return Gauge&
+	 */
+	Gauge& gauge(const std::string& name, const std::string& help = "") {
+		std::lock_guard<std::mutex> lock(entriesMutex);
+		Entry& e = entries[name];
+		if (!e.gauge) {
+			e.help = help;
+			e.gauge.reset(new Gauge());
+		}
+		return *e.gauge;
+	}
+	/**
+	 * @brief Get or create a histogram.
+	 *
+	 * @param name (const std::string&) Name of the metric, with optional labels.
+	 * @param bounds (const std::vector<double>&) Upper bounds of the buckets, only used on creation.
+	 * @param help (const std::string&) Description of the metric.
+	 * @return Histogram&
+	 */
+	Histogram& histogram(const std::string& name, const std::vector<double>& bounds, const std::string& help = "") {
+		std::lock_guard<std::mutex> lock(entriesMutex);
+		Entry& e = entries[name];
+		if (!e.histogram) {
+			e.help = help;
+			e.histogram.reset(new Histogram(bounds));
+		}
+		return *e.histogram;
+	}
+	/**
+	 * @brief Render every metric in the Prometheus text exposition format.
+	 *
+	 * @return std::string
+	 */
+	std::string render() const {
+		std::ostringstream out;
+		std::lock_guard<std::mutex> lock(entriesMutex);
+		/* Group by family explicitly, a name like x_total sorts between x and x{...}. */
+		std::map<std::string, std::vector<std::map<std::string, Entry>::const_iterator>> families;
+		for (auto it = entries.begin(); it != entries.end(); it++) families[family(it->first)].push_back(it);
+		for (auto const& members : families) {
+			const std::string& f = members.first;
+			Entry const& first = members.second.front()->second;
+			if (!first.help.empty()) out << "# HELP " << f << " " << first.help << "\n";
+			out << "# TYPE " << f << " " << (first.counter ? "counter" : first.gauge ? "gauge" : "histogram") << "\n";
+			for (auto const& it : members.second) {
+				const std::string l = labels(it->first);
+				Entry const& e = it->second;
+				if (e.counter) {
+					out << it->first << " " << e.counter->get() << "\n";
+				} else if (e.gauge) {
+					out << it->first << " " << e.gauge->get() << "\n";
+				} else if (e.histogram) {
+					const std::string sep = l.empty() ? "" : l + ",";
+					std::uint64_t cumulative = 0;
+					std::vector<double> const& bounds = e.histogram->getBounds();
+					for (std::size_t i = 0; i < bounds.size(); i++) {
+						cumulative += e.histogram->getBucket(i);
+						out << f << "_bucket{" << sep << "le=\"" << bounds[i] << "\"} " << cumulative << "\n";
+					}
+					cumulative += e.histogram->getBucket(bounds.size());
+					out << f << "_bucket{" << sep << "le=\"+Inf\"} " << cumulative << "\n";
+					const std::string suffix = l.empty() ? "" : "{" + l + "}";
+					out << f << "_sum" << suffix << " " << e.histogram->getSum() << "\n";
+					out << f << "_count" << suffix << " " << cumulative << "\n";
+				}
+			}
+		}
+		return out.str();
+	}
+};
+
+/**
+ * @brief Serves a Registry as Prometheus text over HTTP on the loopback interface,
+ * from its own thread.
+ *
+ */
+class Server {
+	Registry& registry;
+	int listenFd;
+	unsigned short port;
+	std::chrono::milliseconds timeout; // Longest wait for a client to send or to read.
+	std::atomic<bool> running;
+	std::thread worker;
+	void serve() {
+		std::chrono::milliseconds backoff(0);
+		while (running.load()) {
+			int fd = accept(listenFd, nullptr, nullptr);
+			if (fd < 0) {
+				if (errno == EINTR || errno == ECONNABORTED) continue;
+				/* Persistent errors like EMFILE would otherwise spin, wait for descriptors to free up. */
+				backoff = std::min(std::max(backoff * 2, std::chrono::milliseconds(1)), std::chrono::milliseconds(100));
+				std::this_thread::sleep_for(backoff);
+				continue;
+			}
+			backoff = std::chrono::milliseconds(0);
+			/* A client, that sends or reads nothing, would block the thread and stop(). */
+			timeval limit;
+			limit.tv_sec = timeout.count() / 1000;
+			limit.tv_usec = timeout.count() % 1000 * 1000;
+			setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &limit, sizeof(limit));
+			setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &limit, sizeof(limit));
+			char request[1024];
+			ssize_t n = recv(fd, request, sizeof(request) - 1, 0);
+			std::string response;
+			if (n > 0 && std::strncmp(request, "GET ", 4) == 0) {
+				const std::string body = registry.render();
+				response = "HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\nContent-Length: "
+					+ std::to_string(body.size()) + "\r\nConnection: close\r\n\r\n" + body;
+			} else {
+				response = "HTTP/1.0 405 Method Not Allowed\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+			}
+			for (std::size_t sent = 0; sent < response.size();) {
+				ssize_t s = send(fd, response.data() + sent, response.size() - sent, MSG_NOSIGNAL);
+				if (s <= 0) break;
+				sent += s;
+			}
+			close(fd);
+		}
+	}
+public:
+	/**
+	 * @brief Construct a new Server object, it does not listen until start() is called.
+	 *
+	 * @param r (Registry&) The served metrics.
+	 * @param t (std::chrono::milliseconds) Longest wait for a client to send its request or to
+	 * read the response, stop() may wait that long.
+	 */
+	Server(Registry& r, std::chrono::milliseconds t = std::chrono::milliseconds(1000))
+		: registry(r), listenFd(-1), port(0), timeout(t), running(false) {}
+	Server(const Server&) = delete;
+	Server& operator=(const Server&) = delete;
+	~Server() {stop();}
+	/**
+	 * @brief Listen on 127.0.0.1 and serve from a new thread.
+	 *
+	 * @param p (unsigned short) The port, 0 picks a free one.
+	 * @return true if the server is listening.
+	 */
+	bool start(unsigned short p = 0) {
+		if (running.load()) return true;
+		listenFd = socket(AF_INET, SOCK_STREAM, 0);
+		if (listenFd < 0) return false;
+		int yes = 1;
+		setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+		sockaddr_in addr;
+		std::memset(&addr, 0, sizeof(addr));
+		addr.sin_family = AF_INET;
+		addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+		addr.sin_port = htons(p);
+		socklen_t len = sizeof(addr);
+		if (bind(listenFd, reinterpret_cast<sockaddr*>(&addr), len) < 0 || listen(listenFd, 16) < 0
+			|| getsockname(listenFd, reinterpret_cast<sockaddr*>(&addr), &len) < 0) {
+			close(listenFd);
+			listenFd = -1;
+			return false;
+		}
+		port = ntohs(addr.sin_port);
+		running.store(true);
+		worker = std::thread(&Server::serve, this);
+		return true;
+	}
+	/**
+	 * @brief Stop serving and join the thread.
+	 *
+	 */
+	void stop() {
+		if (!running.exchange(false)) return;
+		shutdown(listenFd, SHUT_RDWR);
+		worker.join();
+		close(listenFd);
+		listenFd = -1;
+	}
+	unsigned short getPort() const {return port;}
+};
+
+}
+#endif
@@ -0,0 +1,253 @@
+#ifndef MVCC
+#define MVCC
+/* Multi version inventories for looting contests. Readers pin an epoch and see one immutable
+ * version, writers publish a new version with a compare and swap, old versions are freed once
+ * no reader can see them anymore. */
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+#include "engine.hpp"
+
+namespace mvcc {
+
+/**
+ * @brief Epoch based reclamation. Readers count themselves in the epoch they entered, the epoch
+ * only advances, when no reader of the previous epoch is left, so memory retired in epoch e is
+ * unreachable once the epoch is e + 2.
+ *
+ */
+class Epochs {
+	struct alignas(crowd::cacheLine) Slot {
+		std::atomic<int> readers[3];
+	};
+	static const std::size_t slotCount = 64;
+	std::unique_ptr<Slot[]> slots;
+	alignas(crowd::cacheLine) std::atomic<std::uint64_t> epoch;
+public:
+	Epochs() : slots(new Slot[slotCount]), epoch(0) {
+		for (std::size_t i = 0; i < slotCount; i++) {
+			for (auto& r : slots[i].readers) r.store(0, std::memory_order_relaxed);
+		}
+	}
+	/**
+	 * @brief The epochs shared by every inventory, that is not given its own.
+	 *
+	 * @return Epochs&
+	 */
+	static Epochs& global() {
+		static Epochs e;
+		return e;
+	}
+	std::uint64_t current() const {return epoch.load(std::memory_order_acquire);}
+	/**
+	 * @brief Enter the current epoch as a reader.
+	 *
+	 * @return std::pair<std::size_t, std::uint64_t> The slot and the epoch, to be passed to exit().
+	 */
+	std::pair<std::size_t, std::uint64_t> enter() {
+		std::size_t s = stats::threadIndex() % slotCount;
+		while (true) {
+			std::uint64_t e = epoch.load(std::memory_order_acquire);
+			slots[s].readers[e % 3].fetch_add(1, std::memory_order_seq_cst);
+			if (epoch.load(std::memory_order_seq_cst) == e) return std::make_pair(s, e);
+			slots[s].readers[e % 3].fetch_sub(1, std::memory_order_release);
+		}
+	}
+	void exit(std::pair<std::size_t, std::uint64_t> pinned) {
+		slots[pinned.first].readers[pinned.second % 3].fetch_sub(1, std::memory_order_release);
+	}
+	/**
+	 * @brief Advance the epoch, if no reader of the previous epoch is left.
+	 *
+	 * @return true if the epoch advanced.
+	 */
+	bool tryAdvance() {
+		std::uint64_t e = epoch.load(std::memory_order_seq_cst);
+		for (std::size_t i = 0; i < slotCount; i++) {
+			if (slots[i].readers[(e + 2) % 3].load(std::memory_order_seq_cst)) return false;
+		}
+		return epoch.compare_exchange_strong(e, e + 1, std::memory_order_seq_cst);
+	}
+};
+
+/**
+ * @brief Inventory, whose readers never block and never see a half done change.
+ *
+ */
+class Inventory {
+	/**
+	 * @brief One immutable state of the inventory.
+	 *
+	 */
+	struct Version {
+		std::uint64_t number;
+		std::vector<Object*> items;
+	};
+	std::atomic<Version*> head;
+	Epochs& epochs;
+	/**
+	 * @brief A replaced version and the item it lost, freed together once no reader can see them.
+	 *
+	 */
+	struct Retired {
+		std::uint64_t epoch;
+		Version* version;
+		Object* removed;
+	};
+	std::mutex retiredMutex; // Only taken by successful writers and by collect().
+	std::vector<Retired> retired;
+	/**
+	 * @brief Publish a version derived from the head, retrying on conflicts.
+	 *
+	 * @param change (F) Builds the new items from the current ones, returns false to give up.
+	 * @param removed (Object* const*) Item, that change() left out of the new version, retired with the old one.
+	 * @return true if a version was published.
+	 */
+	template <typename F>
+	bool publish(F change, Object* const* removed = nullptr) {
+		auto pinned = epochs.enter();
+		Version* current = head.load(std::memory_order_acquire);
+		while (true) {
+			std::unique_ptr<Version> next(new Version{current->number + 1, current->items});
+			if (!change(next->items)) {
+				epochs.exit(pinned);
+				return false;
+			}
+			if (head.compare_exchange_weak(current, next.get(), std::memory_order_acq_rel, std::memory_order_acquire)) {
+				next.release();
+				break;
+			}
+		}
+		epochs.exit(pinned);
+		std::lock_guard<std::mutex> lock(retiredMutex);
+		retired.push_back(Retired{epochs.current(), current, removed ? *removed : nullptr});
+		return true;
+	}
+public:
+	/**
+	 * @brief A pinned, stable version of the inventory, valid until the Reader is destroyed.
+	 *
+	 */
+	class Reader {
+		Epochs& epochs;
+		std::pair<std::size_t, std::uint64_t> pinned;
+		Version const* version;
+	public:
+		Reader(const Inventory& inv) : epochs(inv.epochs), pinned(epochs.enter()), version(inv.head.load(std::memory_order_acquire)) {}
+		Reader(const Reader&) = delete;
+		Reader& operator=(const Reader&) = delete;
+		~Reader() {epochs.exit(pinned);}
+		std::vector<Object*> const& getItems() const {return version->items;}
+		std::uint64_t getVersion() const {return version->number;}
+	};
+	/**
+	 * @brief Construct a new Inventory object
+	 *
+	 * @param inv (items&) Items moved into the inventory.
+	 * @param e (Epochs&) Epochs of the readers.
+	 */
+	Inventory(items& inv, Epochs& e = Epochs::global()) : head(new Version{0, {}}), epochs(e) {
+		for (item& i : inv) head.load()->items.push_back(i.release());
+		inv.clear();
+	}
+	Inventory(items&& inv, Epochs& e = Epochs::global()) : Inventory(inv, e) {}
+	Inventory(Epochs& e = Epochs::global()) : head(new Version{0, {}}), epochs(e) {}
+	Inventory(const Inventory&) = delete;
+	Inventory& operator=(const Inventory&) = delete;
+	/**
+	 * @brief Destroy the Inventory object, no reader may be left.
+	 *
+	 */
+	~Inventory() {
+		for (auto& r : retired) {
+			delete r.removed;
+			delete r.version;
+		}
+		Version* v = head.load();
+		for (Object* o : v->items) delete o;
+		delete v;
+	}
+	/**
+	 * @brief Add an item in a new version.
+	 *
+	 * @param i (item&) The item, moved into the inventory.
+	 */
+	void add(item& i) {
+		Object* o = i.release();
+		publish([o](std::vector<Object*>& next) {
+			next.push_back(o);
+			return true;
+		});
+	}
+	/**
+	 * @brief Take an item in a new version. When several threads take the same item, exactly one gets it.
+	 * Older versions keep reading the original until collect() frees it with them, the caller gets
+	 * its own copy.
+	 *
+	 * @param name (const std::string&) Name of the item.
+	 * @return item A copy of the taken item, null if there was none.
+	 */
+	item take(const std::string& name) {
+		Object* taken = nullptr;
+		/* Stay pinned until the copy is made, the original is retired once published. */
+		auto pinned = epochs.enter();
+		publish([&](std::vector<Object*>& next) {
+			for (std::size_t i = 0; i < next.size(); i++) {
+				if (next[i]->getName() == name) {
+					taken = next[i];
+					next.erase(next.begin() + i);
+					return true;
+				}
+			}
+			taken = nullptr;
+			return false;
+		}, &taken);
+		item copy = taken ? taken->clone() : item();
+		epochs.exit(pinned);
+		return copy;
+	}
+	/**
+	 * @brief Number of the newest version.
+	 *
+	 * @return std::uint64_t
+	 */
+	std::uint64_t getVersion() const {return head.load(std::memory_order_acquire)->number;}
+	/**
+	 * @brief Try to advance the epoch and free the versions, that no reader can see anymore.
+	 * Called at the end of the tick.
+	 *
+	 * @return std::size_t Number of versions still waiting.
+	 */
+	std::size_t collect() {
+		epochs.tryAdvance();
+		std::uint64_t e = epochs.current();
+		std::lock_guard<std::mutex> lock(retiredMutex);
+		std::size_t kept = 0;
+		for (auto& r : retired) {
+			if (r.epoch + 2 <= e) {
+				delete r.removed;
+				delete r.version;
+			} else {
+				retired[kept++] = r;
+			}
+		}
+		retired.resize(kept);
+		return kept;
+	}
+	/**
+	 * @brief Move every item of the newest version into a plain inventory. No reader or writer may be left.
+	 *
+	 * @param inv (items&) The destination.
+	 */
+	void drainInto(items& inv) {
+		Version* v = head.load();
+		for (Object* o : v->items) inv.push_back(item(o));
+		v->items.clear();
+	}
+};
+
+}
+#endif
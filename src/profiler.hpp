@@ -0,0 +1,379 @@
+#ifndef PROFILER
+#define PROFILER
+/* Per tick frame profiler. Zones are recorded into per thread rings, that only their owning
+ * thread writes, so recording a zone is two clock reads and a store. */
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+namespace profiler {
+
+/**
+ * @brief Monotonic timestamp in nanoseconds.
+ *
+ * @return std::uint64_t
+ */
+inline std::uint64_t now() {
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * @brief A finished, named scope on one thread.
+ *
+ */
+struct Zone {
+	const char* name; // Static name of the zone, never copied.
+	std::uint64_t begin; // Timestamp of entering the zone.
+	std::uint64_t end; // Timestamp of leaving the zone.
+	std::uint32_t depth; // Nesting depth on its thread, 0 is the outermost zone.
+	std::uint32_t thread; // Index of the recording thread in the profiler.
+};
+
+/**
+ * @brief Begin and end of one World tick.
+ *
+ */
+struct TickRecord {
+	unsigned long tick;
+	std::uint64_t begin;
+	std::uint64_t end;
+	/**
+	 * @brief Length of the tick in nanoseconds.
+	 *
+	 * @return std::uint64_t
+	 */
+	std::uint64_t duration() const {return end - begin;}
+};
+
+/**
+ * @brief Output format of a dumped tick.
+ *
+ */
+enum class DumpFormat {
+	Folded, // One "frame;frame;frame <self ns>" line per stack, input of flamegraph.pl.
+	ChromeTrace // JSON, that can be loaded into chrome://tracing or Perfetto.
+};
+
+/**
+ * @brief Single producer ring of finished zones. Only the owning thread pushes, readers
+ * are only allowed at safe points, when the owner is not inside the tick.
+ *
+ */
+class ZoneRing {
+public:
+	std::uint32_t thread; // Index of the owning thread.
+	std::uint32_t depth; // Current nesting depth, only touched by the owner.
+	/**
+	 * @brief Construct a new Zone Ring object
+	 *
+	 * @param t (std::uint32_t) Index of the owning thread.
+	 * @param n (std::size_t) Capacity, rounded up to a power of two.
+	 */
+	ZoneRing(std::uint32_t t, std::size_t n) : thread(t), depth(0), mask(1), head(0) {
+		while (mask < n) mask *= 2;
+		zones.resize(mask);
+		mask--;
+	}
+	std::size_t capacity() const {return mask + 1;}
+	/**
+	 * @brief Append a finished zone, overwriting the oldest one when full.
+	 *
+	 * @param z (const Zone&) The finished zone.
+	 */
+	void push(const Zone& z) {
+		std::uint64_t h = head.load(std::memory_order_relaxed);
+		zones[h & mask] = z;
+		head.store(h + 1, std::memory_order_release);
+	}
+	/**
+	 * @brief Number of zones pushed since construction.
+	 *
+	 * @return std::uint64_t
+	 */
+	std::uint64_t getHead() const {return head.load(std::memory_order_acquire);}
+	/**
+	 * @brief Get a zone by its absolute push index.
+	 *
+	 * @param i (std::uint64_t) Push index, must be within the last capacity pushes.
+	 * @return Zone const&
+	 */
+	Zone const& at(std::uint64_t i) const {return zones[i & mask];}
+private:
+	std::vector<Zone> zones;
+	std::uint64_t mask;
+	std::atomic<std::uint64_t> head;
+};
+
+/**
+ * @brief Keeps the zones of the last ticks and dumps the slowest tick, when it exceeds a threshold.
+ *
+ */
+class FrameProfiler {
+	static std::uint64_t nextId() {
+		static std::atomic<std::uint64_t> ids(1);
+		return ids.fetch_add(1, std::memory_order_relaxed);
+	}
+	/**
+	 * @brief Ids of the living profilers, so threads can drop the cached rings of dead ones.
+	 *
+	 */
+	static std::unordered_set<std::uint64_t>& living(std::unique_lock<std::mutex>& lock) {
+		static std::mutex livingMutex;
+		static std::unordered_set<std::uint64_t> ids;
+		lock = std::unique_lock<std::mutex>(livingMutex);
+		return ids;
+	}
+	std::uint64_t id; // Process unique id, used to find the thread local ring.
+	std::size_t ringCapacity; // Zones kept per thread.
+	std::atomic<bool> enabled;
+	std::mutex ringsMutex; // Only taken when a thread records its first zone.
+	std::vector<std::unique_ptr<ZoneRing>> rings;
+	std::vector<TickRecord> history; // Ring of the last ticks.
+	std::size_t historyHead;
+	std::size_t historySize;
+	TickRecord current;
+	bool inTick;
+	std::uint64_t threshold; // Ticks longer than this are dumped, 0 disables dumping.
+	std::string dumpPath;
+	DumpFormat dumpFormat;
+	std::uint64_t slowestDumped;
+public:
+	/**
+	 * @brief Construct a new Frame Profiler object
+	 *
+	 * @param n (std::size_t) Number of ticks kept in the history.
+	 * @param zones (std::size_t) Zones kept per recording thread, a ring costs 32 bytes per zone.
+	 * @param e (bool) Whether zones are recorded from the start.
+	 */
+	FrameProfiler(std::size_t n = 64, std::size_t zones = 4096, bool e = true) : id(nextId()), ringCapacity(zones ? zones : 1),
+		enabled(e), history(n ? n : 1), historyHead(0), historySize(0), current({0, 0, 0}), inTick(false), threshold(0),
+		dumpFormat(DumpFormat::Folded), slowestDumped(0) {
+		std::unique_lock<std::mutex> lock;
+		living(lock).insert(id);
+	}
+	~FrameProfiler() {
+		std::unique_lock<std::mutex> lock;
+		living(lock).erase(id);
+	}
+	FrameProfiler(const FrameProfiler&) = delete;
+	FrameProfiler& operator=(const FrameProfiler&) = delete;
+	bool isEnabled() const {return enabled.load(std::memory_order_relaxed);}
+	void setEnabled(bool e) {enabled.store(e, std::memory_order_relaxed);}
+	/**
+	 * @brief Dump every tick, that is slower than the threshold and all previously dumped ticks.
+	 *
+	 * @param ns (std::uint64_t) Threshold in nanoseconds, 0 disables dumping.
+	 * @param path (const std::string&) File, that is overwritten with the slowest tick.
+	 * @param f (DumpFormat) Format of the dump.
+	 * @return FrameProfiler&
+	 */
+	FrameProfiler& setDump(std::uint64_t ns, const std::string& path, DumpFormat f = DumpFormat::Folded) {
+		threshold = ns;
+		dumpPath = path;
+		dumpFormat = f;
+		slowestDumped = 0;
+		return *this;
+	}
+	/**
+	 * @brief Get the ring of the calling thread, registering it on first use. Registering also
+	 * drops the cached rings of destroyed profilers.
+	 *
+	 * @return ZoneRing&
+	 */
+	ZoneRing& threadRing() {
+		thread_local std::vector<std::pair<std::uint64_t, ZoneRing*>> cache;
+		for (auto& c : cache) {
+			if (c.first == id) return *c.second;
+		}
+		{
+			std::unique_lock<std::mutex> lock;
+			std::unordered_set<std::uint64_t>& ids = living(lock);
+			cache.erase(std::remove_if(cache.begin(), cache.end(), [&ids](const std::pair<std::uint64_t, ZoneRing*>& c) {
+				return !ids.count(c.first);
+			}), cache.end());
+		}
+		std::lock_guard<std::mutex> lock(ringsMutex);
+		rings.push_back(std::unique_ptr<ZoneRing>(new ZoneRing(static_cast<std::uint32_t>(rings.size()), ringCapacity)));
+		cache.push_back(std::make_pair(id, rings.back().get()));
+		return *rings.back();
+	}
+	/**
+	 * @brief Mark the start of a tick.
+	 *
+	 * @param tick (unsigned long) Number of the tick.
+	 */
+	void beginTick(unsigned long tick) {
+		inTick = isEnabled();
+		if (!inTick) return;
+		current.tick = tick;
+		current.begin = now();
+	}
+	/**
+	 * @brief Mark the end of the current tick. Must be called at a safe point, when no
+	 * other thread records zones of this profiler.
+	 *
+	 */
+	void endTick() {
+		if (!inTick) return;
+		inTick = false;
+		current.end = now();
+		history[historyHead] = current;
+		historyHead = (historyHead + 1) % history.size();
+		if (historySize < history.size()) historySize++;
+		if (threshold && current.duration() >= threshold && current.duration() > slowestDumped) {
+			slowestDumped = current.duration();
+			std::ofstream out(dumpPath, std::ios::trunc);
+			dump(out, current, dumpFormat);
+		}
+	}
+	/**
+	 * @brief Get the kept ticks, oldest first.
+	 *
+	 * @return std::vector<TickRecord>
+	 */
+	std::vector<TickRecord> getHistory() const {
+		std::vector<TickRecord> h;
+		for (std::size_t i = 0; i < historySize; i++) {
+			h.push_back(history[(historyHead + history.size() - historySize + i) % history.size()]);
+		}
+		return h;
+	}
+	/**
+	 * @brief Get the slowest of the kept ticks.
+	 *
+	 * @return TickRecord
+	 */
+	TickRecord slowestTick() const {
+		TickRecord slowest = {0, 0, 0};
+		for (auto const& t : getHistory()) {
+			if (t.duration() >= slowest.duration()) slowest = t;
+		}
+		return slowest;
+	}
+	/**
+	 * @brief Collect the zones, that were recorded during a tick, ordered by thread and begin.
+	 * Zones, that were already overwritten in their ring are missing.
+	 *
+	 * @param t (const TickRecord&) The tick.
+	 * @return std::vector<Zone>
+	 */
+	std::vector<Zone> collect(const TickRecord& t) {
+		std::vector<Zone> zones;
+		std::lock_guard<std::mutex> lock(ringsMutex);
+		for (auto const& r : rings) {
+			std::uint64_t head = r->getHead();
+			std::uint64_t first = head > r->capacity() ? head - r->capacity() : 0;
+			for (std::uint64_t i = first; i < head; i++) {
+				Zone const& z = r->at(i);
+				if (z.begin >= t.begin && z.end <= t.end) zones.push_back(z);
+			}
+		}
+		std::sort(zones.begin(), zones.end(), [](const Zone& a, const Zone& b) {
+			if (a.thread != b.thread) return a.thread < b.thread;
+			if (a.begin != b.begin) return a.begin < b.begin;
+			return a.depth < b.depth;
+		});
+		return zones;
+	}
+	/**
+	 * @brief Write the zones of a tick.
+	 *
+	 * @param out (std::ostream&) Destination.
+	 * @param t (const TickRecord&) The tick.
+	 * @param f (DumpFormat) Format of the output.
+	 */
+	void dump(std::ostream& out, const TickRecord& t, DumpFormat f) {
+		std::vector<Zone> zones = collect(t);
+		if (f == DumpFormat::ChromeTrace) {
+			out << "{\"traceEvents\":[";
+			for (std::size_t i = 0; i < zones.size(); i++) {
+				out << (i ? "," : "") << "{\"name\":\"" << zones[i].name << "\",\"ph\":\"X\",\"pid\":0"
+					<< ",\"tid\":" << zones[i].thread
+					<< ",\"ts\":" << (zones[i].begin - t.begin) / 1000.0
+					<< ",\"dur\":" << (zones[i].end - zones[i].begin) / 1000.0 << "}";
+			}
+			out << "],\"otherData\":{\"tick\":" << t.tick << ",\"duration_ns\":" << t.duration() << "}}\n";
+			return;
+		}
+		/* Self time of a zone is its length minus the length of its direct children. */
+		std::vector<std::uint64_t> self(zones.size());
+		std::vector<std::size_t> stack;
+		for (std::size_t i = 0; i < zones.size(); i++) {
+			self[i] = zones[i].end - zones[i].begin;
+			if (i && zones[i].thread != zones[i - 1].thread) stack.clear();
+			stack.resize(std::min<std::size_t>(stack.size(), zones[i].depth));
+			if (!stack.empty()) self[stack.back()] -= std::min(self[stack.back()], self[i]);
+			stack.push_back(i);
+		}
+		stack.clear();
+		for (std::size_t i = 0; i < zones.size(); i++) {
+			if (i && zones[i].thread != zones[i - 1].thread) stack.clear();
+			stack.resize(std::min<std::size_t>(stack.size(), zones[i].depth));
+			stack.push_back(i);
+			out << "tick_" << t.tick << ";thread_" << zones[i].thread;
+			for (std::size_t s : stack) out << ";" << zones[s].name;
+			out << " " << self[i] << "\n";
+		}
+	}
+};
+
+/**
+ * @brief Records a zone from its construction to its destruction.
+ *
+ */
+class ScopedZone {
+	ZoneRing* ring;
+	const char* name;
+	std::uint64_t begin;
+	std::uint32_t depth;
+public:
+	ScopedZone(FrameProfiler& p, const char* n) : ring(nullptr), name(n), begin(0), depth(0) {
+		if (!p.isEnabled()) return;
+		ring = &p.threadRing();
+		depth = ring->depth++;
+		begin = now();
+	}
+	ScopedZone(const ScopedZone&) = delete;
+	ScopedZone& operator=(const ScopedZone&) = delete;
+	~ScopedZone() {
+		if (!ring) return;
+		ring->depth--;
+		ring->push({name, begin, now(), depth, ring->thread});
+	}
+};
+
+/**
+ * @brief Begins a tick and its outermost "tick" zone, ends both on destruction.
+ *
+ */
+class TickScope {
+	struct Bracket {
+		FrameProfiler& profiler;
+		Bracket(FrameProfiler& p, unsigned long tick) : profiler(p) {profiler.beginTick(tick);}
+		~Bracket() {profiler.endTick();}
+	} bracket; // Declared first, so the tick ends after the zone.
+	ScopedZone zone;
+public:
+	TickScope(FrameProfiler& p, unsigned long tick) : bracket(p, tick), zone(p, "tick") {}
+};
+
+}
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+/**
+ * @brief Profile the rest of the enclosing scope as a zone called name.
+ *
+ */
+#define PROFILE_ZONE(frameProfiler, name) ::profiler::ScopedZone PROFILE_CONCAT(profileZone, __LINE__)(frameProfiler, name)
+#endif
@@ -0,0 +1,360 @@
+#ifndef QUERY
+#define QUERY
+/* Query language over a read only, columnar copy of the rooms, for game master tools and analytics.
+ *
+ *     [count] rooms [where <condition> {and <condition>}]
+ *     <condition> := items|keys|neighbours <|<=|>|>=|=|!= <number>
+ *                  | within <hops> of "<room name>"
+ *                  | name = "<room name>"
+ *
+ * e.g. count rooms where keys > 3 and within 5 of "Bridge"
+ * Conditions filter selection vectors batch by batch, hop conditions walk the adjacency index. */
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "engine.hpp"
+
+namespace query {
+
+/**
+ * @brief Columns of the rooms and their adjacency in compressed sparse rows. Immutable after it was built.
+ *
+ */
+class Store {
+	std::vector<std::string> names;
+	std::vector<std::uint32_t> itemCounts;
+	std::vector<std::uint32_t> keyCounts;
+	std::vector<std::uint32_t> offsets; // Neighbours of room i are targets[offsets[i]] to targets[offsets[i + 1]].
+	std::vector<std::uint32_t> targets;
+	std::unordered_map<std::string, std::uint32_t> byName; // First room of every name.
+public:
+	Store() : offsets(1, 0) {}
+	/**
+	 * @brief Construct a new Store object from a World snapshot.
+	 *
+	 * @param s (const snapshot&) The snapshot.
+	 */
+	Store(const snapshot& s) : offsets(1, 0) {
+		std::vector<std::uint32_t> neighbours;
+		for (RoomView const& v : *s) {
+			neighbours.assign(v.neighbours.begin(), v.neighbours.end());
+			addRoom(v.name, v.items.size(), v.keys, neighbours);
+		}
+	}
+	/**
+	 * @brief Append a room.
+	 *
+	 * @param name (const std::string&) Name of the room.
+	 * @param items (std::uint32_t) Number of items.
+	 * @param keys (std::uint32_t) Number of keys.
+	 * @param neighbours (const std::vector<std::uint32_t>&) Indices of the neighbours.
+	 * @return std::uint32_t Index of the room.
+	 */
+	std::uint32_t addRoom(const std::string& name, std::uint32_t items, std::uint32_t keys, const std::vector<std::uint32_t>& neighbours) {
+		std::uint32_t index = names.size();
+		names.push_back(name);
+		itemCounts.push_back(items);
+		keyCounts.push_back(keys);
+		targets.insert(targets.end(), neighbours.begin(), neighbours.end());
+		offsets.push_back(targets.size());
+		byName.emplace(name, index);
+		return index;
+	}
+	std::size_t size() const {return names.size();}
+	std::string const& getName(std::uint32_t i) const {return names[i];}
+	std::vector<std::string> const& getNames() const {return names;}
+	std::vector<std::uint32_t> const& getItemCounts() const {return itemCounts;}
+	std::vector<std::uint32_t> const& getKeyCounts() const {return keyCounts;}
+	std::vector<std::uint32_t> const& getOffsets() const {return offsets;}
+	std::vector<std::uint32_t> const& getTargets() const {return targets;}
+	/**
+	 * @brief Find a room by name.
+	 *
+	 * @param name (const std::string&) Name of the room.
+	 * @return const std::uint32_t* Index of the first room with this name, null if there is none.
+	 */
+	const std::uint32_t* find(const std::string& name) const {
+		auto it = byName.find(name);
+		return it == byName.end() ? nullptr : &it->second;
+	}
+	/**
+	 * @brief Rooms at most hops steps away from a room, itself included.
+	 *
+	 * @param from (std::uint32_t) Index of the start room.
+	 * @param hops (unsigned) Maximum number of steps.
+	 * @return std::vector<std::uint32_t> Sorted indices.
+	 */
+	std::vector<std::uint32_t> within(std::uint32_t from, unsigned hops) const {
+		std::vector<std::uint8_t> seen(size(), 0);
+		std::vector<std::uint32_t> reached(1, from);
+		seen[from] = 1;
+		std::size_t begin = 0;
+		for (unsigned h = 0; h < hops && begin < reached.size(); h++) {
+			std::size_t end = reached.size();
+			for (std::size_t i = begin; i < end; i++) {
+				for (std::uint32_t e = offsets[reached[i]]; e < offsets[reached[i] + 1]; e++) {
+					std::uint32_t t = targets[e];
+					if (!seen[t]) {
+						seen[t] = 1;
+						reached.push_back(t);
+					}
+				}
+			}
+			begin = end;
+		}
+		std::sort(reached.begin(), reached.end());
+		return reached;
+	}
+};
+
+/**
+ * @brief Numeric columns, that conditions can compare.
+ *
+ */
+enum class Column {
+	Items,
+	Keys,
+	Neighbours
+};
+
+enum class Op {
+	Lt,
+	Le,
+	Gt,
+	Ge,
+	Eq,
+	Ne
+};
+
+/**
+ * @brief One condition of the where clause.
+ *
+ */
+struct Condition {
+	enum Kind {
+		Compare, // column op value
+		Within, // within hops of room
+		Name // name = room
+	} kind;
+	Column column;
+	Op op;
+	std::int64_t value;
+	unsigned hops;
+	std::string room;
+};
+
+/**
+ * @brief A parsed query.
+ *
+ */
+struct Query {
+	bool count; // Only count the matching rooms.
+	std::vector<Condition> conditions; // Conditions, that all have to hold.
+};
+
+/**
+ * @brief Matching rooms of a query.
+ *
+ */
+struct Result {
+	std::vector<std::uint32_t> rooms; // Indices of the matching rooms, empty for count queries.
+	std::size_t count; // Number of matching rooms.
+};
+
+/**
+ * @brief Parse a query.
+ *
+ * @param text (const std::string&) The query.
+ * @return Query
+ * @throws std::invalid_argument if the query is malformed.
+ */
+inline Query parse(const std::string& text) {
+	std::vector<std::string> tokens;
+	for (std::size_t i = 0; i < text.size();) {
+		char c = text[i];
+		if (std::isspace(static_cast<unsigned char>(c))) {
+			i++;
+		} else if (c == '"') {
+			std::size_t end = text.find('"', i + 1);
+			if (end == std::string::npos) throw std::invalid_argument("query: unterminated string");
+			tokens.push_back(text.substr(i, end - i + 1));
+			i = end + 1;
+		} else if (std::isalnum(static_cast<unsigned char>(c)) || c == '_' || c == '-') {
+			std::size_t end = i;
+			while (end < text.size() && (std::isalnum(static_cast<unsigned char>(text[end])) || text[end] == '_' || text[end] == '-')) end++;
+			tokens.push_back(text.substr(i, end - i));
+			i = end;
+		} else {
+			std::size_t end = i;
+			while (end < text.size() && std::string("<>=!").find(text[end]) != std::string::npos) end++;
+			if (end == i) throw std::invalid_argument(std::string("query: unexpected character ") + c);
+			tokens.push_back(text.substr(i, end - i));
+			i = end;
+		}
+	}
+	std::size_t pos = 0;
+	auto next = [&]() -> const std::string& {
+		if (pos >= tokens.size()) throw std::invalid_argument("query: unexpected end");
+		return tokens[pos++];
+	};
+	auto expect = [&](const std::string& t) {
+		if (next() != t) throw std::invalid_argument("query: expected " + t + " near " + tokens[pos - 1]);
+	};
+	auto number = [&](std::int64_t max) -> std::int64_t {
+		const std::string& t = next();
+		if (t.empty() || !std::all_of(t.begin(), t.end(), [](char c) {return std::isdigit(static_cast<unsigned char>(c));})) {
+			throw std::invalid_argument("query: expected a number near " + t);
+		}
+		std::int64_t n = 0;
+		for (char d : t) {
+			if (n > (max - (d - '0')) / 10) throw std::invalid_argument("query: number out of range " + t);
+			n = n * 10 + (d - '0');
+		}
+		return n;
+	};
+	auto quoted = [&]() -> std::string {
+		const std::string& t = next();
+		if (t.size() < 2 || t.front() != '"') throw std::invalid_argument("query: expected a quoted name near " + t);
+		return t.substr(1, t.size() - 2);
+	};
+	Query q;
+	q.count = pos < tokens.size() && tokens[pos] == "count";
+	if (q.count) pos++;
+	expect("rooms");
+	if (pos == tokens.size()) return q;
+	expect("where");
+	while (true) {
+		Condition c = {Condition::Compare, Column::Items, Op::Eq, 0, 0, ""};
+		const std::string& t = next();
+		if (t == "within") {
+			c.kind = Condition::Within;
+			c.hops = static_cast<unsigned>(number(std::numeric_limits<unsigned>::max()));
+			expect("of");
+			c.room = quoted();
+		} else if (t == "name") {
+			c.kind = Condition::Name;
+			expect("=");
+			c.room = quoted();
+		} else {
+			if (t == "items") c.column = Column::Items;
+			else if (t == "keys") c.column = Column::Keys;
+			else if (t == "neighbours") c.column = Column::Neighbours;
+			else throw std::invalid_argument("query: unknown column " + t);
+			const std::string& o = next();
+			if (o == "<") c.op = Op::Lt;
+			else if (o == "<=") c.op = Op::Le;
+			else if (o == ">") c.op = Op::Gt;
+			else if (o == ">=") c.op = Op::Ge;
+			else if (o == "=") c.op = Op::Eq;
+			else if (o == "!=") c.op = Op::Ne;
+			else throw std::invalid_argument("query: unknown operator " + o);
+			c.value = number(std::numeric_limits<std::int64_t>::max());
+		}
+		q.conditions.push_back(c);
+		if (pos == tokens.size()) return q;
+		expect("and");
+	}
+}
+
+/**
+ * @brief Keep the selected rows, whose value satisfies the comparison.
+ *
+ * @return std::size_t Number of kept rows, compacted to the front of sel.
+ */
+template <typename Cmp>
+inline std::size_t filter(const std::uint32_t* column, std::uint32_t* sel, std::size_t n, std::int64_t value, Cmp cmp) {
+	std::size_t kept = 0;
+	for (std::size_t i = 0; i < n; i++) {
+		sel[kept] = sel[i];
+		kept += cmp(static_cast<std::int64_t>(column[sel[i]]), value);
+	}
+	return kept;
+}
+
+/**
+ * @brief Run a parsed query batch by batch over a store.
+ *
+ * @param q (const Query&) The query.
+ * @param s (const Store&) The store.
+ * @return Result
+ */
+inline Result execute(const Query& q, const Store& s) {
+	static const std::size_t batch = 1024;
+	Result r = {{}, 0};
+	/* Hop conditions shrink the candidates the most, so they are evaluated first. */
+	bool restricted = false;
+	std::vector<std::uint32_t> candidates;
+	std::vector<const Condition*> rest;
+	for (const Condition& c : q.conditions) {
+		if (c.kind == Condition::Compare) {
+			rest.push_back(&c);
+			continue;
+		}
+		const std::uint32_t* from = s.find(c.room);
+		std::vector<std::uint32_t> matched;
+		if (from && c.kind == Condition::Within) {
+			matched = s.within(*from, c.hops);
+		} else if (from) {
+			for (std::uint32_t i = *from; i < s.size(); i++) {
+				if (s.getName(i) == c.room) matched.push_back(i);
+			}
+		}
+		if (restricted) {
+			std::vector<std::uint32_t> both;
+			std::set_intersection(candidates.begin(), candidates.end(), matched.begin(), matched.end(), std::back_inserter(both));
+			candidates.swap(both);
+		} else {
+			candidates.swap(matched);
+			restricted = true;
+		}
+	}
+	std::vector<std::uint32_t> degrees;
+	for (const Condition* c : rest) {
+		if (c->column != Column::Neighbours) continue;
+		degrees.resize(s.size());
+		for (std::size_t i = 0; i < s.size(); i++) degrees[i] = s.getOffsets()[i + 1] - s.getOffsets()[i];
+		break;
+	}
+	std::size_t total = restricted ? candidates.size() : s.size();
+	std::uint32_t sel[batch];
+	for (std::size_t start = 0; start < total; start += batch) {
+		std::size_t n = std::min(batch, total - start);
+		for (std::size_t i = 0; i < n; i++) sel[i] = restricted ? candidates[start + i] : start + i;
+		for (const Condition* c : rest) {
+			const std::uint32_t* column = c->column == Column::Items ? s.getItemCounts().data()
+				: c->column == Column::Keys ? s.getKeyCounts().data() : degrees.data();
+			switch (c->op) {
+			case Op::Lt: n = filter(column, sel, n, c->value, [](std::int64_t a, std::int64_t b) {return a < b;}); break;
+			case Op::Le: n = filter(column, sel, n, c->value, [](std::int64_t a, std::int64_t b) {return a <= b;}); break;
+			case Op::Gt: n = filter(column, sel, n, c->value, [](std::int64_t a, std::int64_t b) {return a > b;}); break;
+			case Op::Ge: n = filter(column, sel, n, c->value, [](std::int64_t a, std::int64_t b) {return a >= b;}); break;
+			case Op::Eq: n = filter(column, sel, n, c->value, [](std::int64_t a, std::int64_t b) {return a == b;}); break;
+			case Op::Ne: n = filter(column, sel, n, c->value, [](std::int64_t a, std::int64_t b) {return a != b;}); break;
+			}
+		}
+		r.count += n;
+		if (!q.count) r.rooms.insert(r.rooms.end(), sel, sel + n);
+	}
+	return r;
+}
+
+/**
+ * @brief Parse and run a query.
+ *
+ * @param text (const std::string&) The query.
+ * @param s (const Store&) The store.
+ * @return Result
+ * @throws std::invalid_argument if the query is malformed.
+ */
+inline Result run(const std::string& text, const Store& s) {
+	return execute(parse(text), s);
+}
+
+}
+#endif
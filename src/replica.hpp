@@ -0,0 +1,444 @@
+#ifndef REPLICA
+#define REPLICA
+/* Hot standby of a World. The primary publishes every inventory mutation, in the record format of
+ * the write ahead log, and sends the records of a tick over a Unix socket at the end of the tick.
+ * A standby process applies them to its own copy of the World on its own tick and acknowledges the
+ * last applied sequence, so the primary knows how far behind it is. A standby, that connects late,
+ * first receives the current inventories of the rooms and entities as Clear and Add mutations, and
+ * the hit points and stamina of the entities as Vitals. A tick without mutations sends a Heartbeat.
+ * When the primary dies, the socket closes, and the standby holds the World as of the last tick the
+ * primary sent. A primary, that hangs, is noticed when nothing arrives for the timeout. */
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "metrics.hpp"
+#include "wal.hpp"
+
+namespace replica {
+
+/**
+ * @brief Address of a Unix socket.
+ *
+ * @throws std::invalid_argument if the path is too long.
+ */
+inline sockaddr_un address(const std::string& path) {
+	sockaddr_un a = {};
+	a.sun_family = AF_UNIX;
+	if (path.size() >= sizeof(a.sun_path)) throw std::invalid_argument("replica: socket path too long: " + path);
+	std::memcpy(a.sun_path, path.c_str(), path.size() + 1);
+	return a;
+}
+
+inline void setNonBlocking(int fd) {
+	::fcntl(fd, F_SETFL, ::fcntl(fd, F_GETFL) | O_NONBLOCK);
+}
+
+/**
+ * @brief The publishing side, lives next to the World on the tick thread of the primary.
+ *
+ */
+class Primary {
+	/**
+	 * @brief A connected standby.
+	 *
+	 */
+	struct Standby {
+		int fd;
+		std::string outbound; // Records the socket did not take yet.
+		std::string inbound; // Partial acknowledgement.
+		std::uint64_t acked; // Last sequence the standby applied.
+		bool joined; // Accepted by the current flush, its catch-up already holds the pending records.
+		~Standby() {::close(fd);}
+	};
+	const World& world;
+	std::string path;
+	int listener;
+	std::size_t maxBacklog; // Outbound bytes, after which a standby that does not read is dropped.
+	std::vector<std::unique_ptr<Standby>> standbys;
+	std::string pending; // Records of the current tick.
+	std::uint64_t sequence; // Last published sequence.
+	std::deque<std::pair<std::uint64_t, std::uint64_t>> sent; // Last sequence and time of every flush, until acknowledged.
+	std::uint64_t published;
+	std::uint64_t bytes;
+	metrics::Counter* mutationCounter;
+	metrics::Counter* byteCounter;
+	metrics::Gauge* lagGauge;
+	metrics::Gauge* standbyGauge;
+	metrics::Histogram* lagSeconds;
+	static void encodeItems(std::string& out, std::uint64_t sequence, const std::string& key, const items& inventory) {
+		for (item const& i : inventory) {
+			const Key* k = dynamic_cast<const Key*>(i.get());
+			wal::encode(out, sequence, {wal::Op::Add, key, i->getName(), k ? k->getKeyID() : std::string()});
+		}
+	}
+	/**
+	 * @brief Queue the current rooms and entities for a new standby, at the current sequence.
+	 *
+	 */
+	void catchUp(Standby& s) {
+		for (node const& r : world.getRooms()) {
+			std::string key = wal::roomKey(r->getName());
+			wal::encode(s.outbound, sequence, {wal::Op::Clear, key, ""});
+			if (!r->isStocked()) {
+				for (Prefab::Slot const& slot : r->getPrefab()->layout) wal::encode(s.outbound, sequence, {wal::Op::Add, key, slot.name, slot.keyID});
+			} else {
+				encodeItems(s.outbound, sequence, key, r->getItems());
+			}
+		}
+		for (std::shared_ptr<Entity> const& e : world.getEntities()) {
+			std::string key = wal::entityKey(e->getName());
+			wal::encode(s.outbound, sequence, {wal::Op::Clear, key, ""});
+			encodeItems(s.outbound, sequence, key, e->getItems());
+			wal::encode(s.outbound, sequence, {wal::Op::Vitals, key, "", "", e->getHp(), e->getStamina()});
+		}
+		s.acked = 0;
+		s.joined = true;
+	}
+	/**
+	 * @brief Send what the socket takes.
+	 *
+	 * @return false if the standby is gone or too far behind.
+	 */
+	bool send(Standby& s) {
+		std::size_t done = 0;
+		while (done < s.outbound.size()) {
+			ssize_t n = ::send(s.fd, s.outbound.data() + done, s.outbound.size() - done, MSG_NOSIGNAL);
+			if (n < 0 && errno == EINTR) continue;
+			if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+			if (n <= 0) return false;
+			done += n;
+			bytes += n;
+			if (byteCounter) byteCounter->inc(n);
+		}
+		s.outbound.erase(0, done);
+		return s.outbound.size() <= maxBacklog;
+	}
+	/**
+	 * @brief Read the acknowledgements of a standby, u64 sequences.
+	 *
+	 * @return false if the standby closed the socket.
+	 */
+	bool receive(Standby& s) {
+		char buffer[256];
+		while (true) {
+			ssize_t n = ::recv(s.fd, buffer, sizeof(buffer), 0);
+			if (n < 0 && errno == EINTR) continue;
+			if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+			if (n <= 0) return false;
+			s.inbound.append(buffer, n);
+		}
+		std::size_t whole = s.inbound.size() / 8 * 8;
+		if (whole) {
+			std::memcpy(&s.acked, &s.inbound[whole - 8], 8);
+			s.inbound.erase(0, whole);
+		}
+		return true;
+	}
+public:
+	/**
+	 * @brief Construct a new Primary object listening on a Unix socket.
+	 *
+	 * @param w (const World&) The World, it must outlive the primary.
+	 * @param p (const std::string&) Path of the socket, an old socket file is replaced.
+	 * @param backlog (std::size_t) Unsent bytes, after which a standby is dropped.
+	 * @throws std::runtime_error if the socket cannot be created.
+	 */
+	Primary(const World& w, const std::string& p, std::size_t backlog = 64 << 20)
+		: world(w), path(p), maxBacklog(backlog), sequence(0), published(0), bytes(0), mutationCounter(nullptr),
+		byteCounter(nullptr), lagGauge(nullptr), standbyGauge(nullptr), lagSeconds(nullptr) {
+		sockaddr_un a = address(path);
+		::unlink(path.c_str());
+		listener = ::socket(AF_UNIX, SOCK_STREAM, 0);
+		if (listener < 0) throw std::runtime_error("replica: cannot create a socket");
+		if (::bind(listener, reinterpret_cast<sockaddr*>(&a), sizeof(a)) || ::listen(listener, 4)) {
+			::close(listener);
+			throw std::runtime_error("replica: cannot listen on " + path);
+		}
+		setNonBlocking(listener);
+	}
+	Primary(const Primary&) = delete;
+	Primary& operator=(const Primary&) = delete;
+	~Primary() {
+		standbys.clear();
+		::close(listener);
+		::unlink(path.c_str());
+	}
+	/**
+	 * @brief Publish a mutation, that the tick applied to the World. It is sent by the next flush().
+	 *
+	 * @param m (const wal::Mutation&) The mutation.
+	 * @return std::uint64_t Its sequence.
+	 */
+	std::uint64_t publish(const wal::Mutation& m) {
+		wal::encode(pending, ++sequence, m);
+		published++;
+		if (mutationCounter) mutationCounter->inc();
+		return sequence;
+	}
+	/**
+	 * @brief Accept new standbys, send the mutations of the tick and collect acknowledgements.
+	 * Call it at the end of every tick, also on ticks without mutations, so the standbys do not
+	 * time out. Never blocks.
+	 *
+	 * @return std::size_t Connected standbys.
+	 */
+	std::size_t flush() {
+		int fd;
+		while ((fd = ::accept(listener, nullptr, nullptr)) >= 0) {
+			setNonBlocking(fd);
+			standbys.push_back(std::unique_ptr<Standby>(new Standby{fd, "", "", 0, false}));
+			catchUp(*standbys.back());
+		}
+		std::uint64_t now = profiler::now();
+		if (!pending.empty() && !standbys.empty()) sent.push_back(std::make_pair(sequence, now));
+		for (std::size_t i = 0; i < standbys.size();) {
+			Standby& s = *standbys[i];
+			if (!s.joined) s.outbound += pending;
+			s.joined = false;
+			if (s.outbound.empty()) wal::encode(s.outbound, sequence, {wal::Op::Heartbeat, "", ""});
+			if (send(s) && receive(s)) {
+				i++;
+			} else {
+				standbys[i] = std::move(standbys.back());
+				standbys.pop_back();
+			}
+		}
+		pending.clear();
+		std::uint64_t acked = getAcked();
+		while (!sent.empty() && sent.front().first <= acked) {
+			if (lagSeconds) lagSeconds->observe((now - sent.front().second) / 1e9);
+			sent.pop_front();
+		}
+		if (lagGauge) lagGauge->set(sequence - acked);
+		if (standbyGauge) standbyGauge->set(standbys.size());
+		return standbys.size();
+	}
+	std::uint64_t getSequence() const {return sequence;}
+	/**
+	 * @brief Last sequence every standby applied.
+	 *
+	 * @return std::uint64_t The current sequence without standbys.
+	 */
+	std::uint64_t getAcked() const {
+		std::uint64_t acked = sequence;
+		for (auto const& s : standbys) acked = std::min(acked, s->acked);
+		return acked;
+	}
+	std::size_t getStandbys() const {return standbys.size();}
+	std::uint64_t getBytes() const {return bytes;}
+	/**
+	 * @brief Publish the replication metrics.
+	 *
+	 * @param r (metrics::Registry&) The registry, it must outlive the primary.
+	 */
+	void attachMetrics(metrics::Registry& r) {
+		mutationCounter = &r.counter("spacewalk_replication_mutations_total", "Mutations published to standbys.");
+		byteCounter = &r.counter("spacewalk_replication_bytes_total", "Bytes sent to standbys.");
+		lagGauge = &r.gauge("spacewalk_replication_lag_mutations", "Mutations the slowest standby did not apply yet.");
+		standbyGauge = &r.gauge("spacewalk_replication_standbys", "Connected standbys.");
+		lagSeconds = &r.histogram("spacewalk_replication_lag_seconds", metrics::Histogram::exponential(0.0001, 2, 14),
+			"Time from sending the mutations of a tick until every standby applied them.");
+		mutationCounter->inc(published);
+		byteCounter->inc(bytes);
+	}
+};
+
+/**
+ * @brief The applying side, lives next to the copy of the World on the tick thread of the standby.
+ *
+ */
+class Standby {
+	World& world;
+	int fd;
+	std::unordered_map<std::string, Room*> rooms; // Rooms by roomKey().
+	std::unordered_map<std::string, Entity*> people; // Entities of the World by entityKey().
+	wal::State entities; // Inventories of the entities, that are not in the World.
+	std::string inbound; // Records not applied yet.
+	std::string outbound; // Acknowledgement bytes the socket did not take yet.
+	std::uint64_t applied; // Last applied sequence.
+	std::uint64_t mutations;
+	std::uint64_t timeout; // Nanoseconds without data, after which the primary counts as lost.
+	std::uint64_t heard; // Time data last arrived.
+	bool connected;
+	metrics::Counter* mutationCounter;
+	metrics::Gauge* sequenceGauge;
+	/**
+	 * @brief Apply an inventory mutation to a room or an entity.
+	 *
+	 */
+	template <typename T>
+	static void change(T& holder, const wal::Mutation& m) {
+		if (m.op == wal::Op::Add) {
+			item i(m.keyID.empty() ? new Object(m.item) : new Key(m.item, m.keyID));
+			holder.addItem(i);
+		} else if (m.op == wal::Op::Clear) {
+			holder.takeItems();
+		} else if (m.op == wal::Op::Remove) {
+			items all = holder.takeItems();
+			for (auto i = all.begin(); i != all.end(); i++) {
+				if ((*i)->getName() == m.item) {
+					all.erase(i);
+					break;
+				}
+			}
+			for (item& i : all) holder.addItem(i);
+		}
+	}
+	void apply(const wal::Mutation& m) {
+		auto r = rooms.find(m.target);
+		if (r != rooms.end()) {
+			change(*r->second, m);
+			return;
+		}
+		auto e = people.find(m.target);
+		if (e == people.end()) {
+			if (!m.target.compare(0, 7, "entity/")) wal::applyMutation(entities, m);
+			return;
+		}
+		if (m.op == wal::Op::Vitals) {
+			e->second->setHp(m.hp);
+			e->second->setStamina(m.stamina);
+		} else {
+			change(*e->second, m);
+		}
+	}
+	/**
+	 * @brief Send the acknowledgement, a full socket keeps it for the next poll.
+	 *
+	 */
+	void acknowledge() {
+		while (!outbound.empty()) {
+			ssize_t n = ::send(fd, outbound.data(), outbound.size(), MSG_NOSIGNAL);
+			if (n < 0 && errno == EINTR) continue;
+			if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return;
+			if (n <= 0) {
+				lost();
+				return;
+			}
+			outbound.erase(0, n);
+		}
+	}
+	void lost() {
+		if (!connected) return;
+		connected = false;
+		::close(fd);
+	}
+public:
+	/**
+	 * @brief Construct a new Standby object connected to a primary.
+	 *
+	 * @param w (World&) The copy of the World, with the rooms of the primary. Entities of the
+	 * primary, that it holds too, are kept up to date, the others only in getEntities().
+	 * @param path (const std::string&) Path of the socket of the primary.
+	 * @param t (std::uint64_t) Nanoseconds without data from the primary, after which it counts as lost.
+	 * @throws std::runtime_error if the primary cannot be reached.
+	 */
+	Standby(World& w, const std::string& path, std::uint64_t t = 5000000000ull) : world(w), applied(0), mutations(0),
+		timeout(t), heard(profiler::now()), connected(true), mutationCounter(nullptr), sequenceGauge(nullptr) {
+		sockaddr_un a = address(path);
+		fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+		if (fd < 0) throw std::runtime_error("replica: cannot create a socket");
+		if (::connect(fd, reinterpret_cast<sockaddr*>(&a), sizeof(a))) {
+			::close(fd);
+			throw std::runtime_error("replica: cannot connect to " + path);
+		}
+		setNonBlocking(fd);
+		for (node const& r : world.getRooms()) rooms[wal::roomKey(r->getName())] = r.get();
+		for (std::shared_ptr<Entity> const& e : world.getEntities()) people[wal::entityKey(e->getName())] = e.get();
+	}
+	Standby(const Standby&) = delete;
+	Standby& operator=(const Standby&) = delete;
+	~Standby() {lost();}
+	/**
+	 * @brief Apply the mutations, that arrived, and acknowledge them. Call it on every tick of
+	 * the standby, it never blocks.
+	 *
+	 * @return std::size_t Mutations applied.
+	 */
+	std::size_t poll() {
+		if (!connected) return 0;
+		char buffer[65536];
+		std::uint64_t now = profiler::now();
+		std::size_t before = inbound.size();
+		while (true) {
+			ssize_t n = ::recv(fd, buffer, sizeof(buffer), 0);
+			if (n < 0 && errno == EINTR) continue;
+			if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+			if (n <= 0) {
+				lost();
+				break;
+			}
+			inbound.append(buffer, n);
+		}
+		if (inbound.size() != before) {
+			heard = now;
+		} else if (now - heard > timeout) {
+			lost();
+		}
+		wal::Decoder d(inbound);
+		std::size_t done = 0;
+		std::size_t count = 0;
+		std::uint64_t sequence;
+		wal::Mutation m;
+		std::uint64_t last = applied;
+		while (d.next(sequence, m)) {
+			done = d.position();
+			applied = sequence;
+			if (m.op == wal::Op::Heartbeat) continue;
+			apply(m);
+			count++;
+		}
+		if (inbound.size() - done >= 8) {
+			std::uint32_t length;
+			std::memcpy(&length, &inbound[done], 4);
+			if (done + 8 + length <= inbound.size()) lost(); // A whole record, that does not decode.
+		}
+		inbound.erase(0, done);
+		mutations += count;
+		if (mutationCounter) mutationCounter->inc(count);
+		if (sequenceGauge) sequenceGauge->set(applied);
+		if (applied != last) outbound.append(reinterpret_cast<const char*>(&applied), sizeof(applied));
+		if (connected) acknowledge();
+		return count;
+	}
+	/**
+	 * @brief Whether the primary is still connected. Once it is not, the standby may take over
+	 * the World.
+	 *
+	 * @return bool
+	 */
+	bool isConnected() const {return connected;}
+	std::uint64_t getApplied() const {return applied;}
+	std::uint64_t getMutations() const {return mutations;}
+	/**
+	 * @brief Inventories of the entities, by entityKey().
+	 *
+	 * @return wal::State const&
+	 */
+	wal::State const& getEntities() const {return entities;}
+	/**
+	 * @brief Publish the replication metrics of the standby.
+	 *
+	 * @param r (metrics::Registry&) The registry, it must outlive the standby.
+	 */
+	void attachMetrics(metrics::Registry& r) {
+		mutationCounter = &r.counter("spacewalk_standby_mutations_total", "Mutations applied by the standby.");
+		sequenceGauge = &r.gauge("spacewalk_standby_sequence", "Last sequence applied by the standby.");
+		mutationCounter->inc(mutations);
+		sequenceGauge->set(applied);
+	}
+};
+
+}
+#endif
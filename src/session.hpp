@@ -0,0 +1,252 @@
+#ifndef SESSION
+#define SESSION
+/* Sessions of the connected players. The transient state of a session, its pending commands and
+ * its outbound text, lives in an Arena of the session, that is reset after every tick. Closed
+ * sessions keep their arena and are reused, so players coming and going stop touching the heap. */
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include <sys/uio.h>
+#include "arena.hpp"
+#include "engine.hpp"
+
+namespace session {
+
+/**
+ * @typedef Identifies a session, the slot in the low and its generation in the high 32 bits.
+ * Ids of closed sessions stay invalid when the slot is reused.
+ *
+ */
+typedef std::uint64_t id;
+
+/**
+ * @brief A piece of text in the arena of a session, the pieces form a singly linked list.
+ *
+ */
+struct Text {
+	const char* data;
+	std::size_t length;
+	Text* next;
+};
+
+/**
+ * @brief State of one connected player.
+ *
+ */
+class Session {
+	friend class Manager;
+	id sessionID;
+	node room; // Room the player is in.
+	Entity* entity; // The player's entity, owned by the game.
+	Arena arena; // Transient state of the current tick.
+	Text* commands; // Pending commands, oldest first.
+	Text* lastCommand;
+	std::size_t commandCount;
+	Text* outbound; // Text to send, oldest first.
+	Text* lastOutbound;
+	std::size_t outboundBytes;
+	static void append(Text*& first, Text*& last, Text* t) {
+		if (last) {
+			last->next = t;
+		} else {
+			first = t;
+		}
+		last = t;
+	}
+	/**
+	 * @brief Drop the transient state, the arena keeps its blocks.
+	 *
+	 */
+	void clear() {
+		arena.reset();
+		commands = lastCommand = nullptr;
+		commandCount = 0;
+		outbound = lastOutbound = nullptr;
+		outboundBytes = 0;
+	}
+public:
+	/**
+	 * @brief Construct a new Session object
+	 *
+	 * @param b (std::size_t) Size of an arena block.
+	 */
+	Session(std::size_t b) : sessionID(0), entity(nullptr), arena(b), commands(nullptr), lastCommand(nullptr), commandCount(0),
+		outbound(nullptr), lastOutbound(nullptr), outboundBytes(0) {}
+	Session(const Session&) = delete;
+	Session& operator=(const Session&) = delete;
+	id getID() const {return sessionID;}
+	node const& getRoom() const {return room;}
+	void setRoom(const node& r) {room = r;}
+	Entity* getEntity() const {return entity;}
+	/**
+	 * @brief Queue a command received from the player, it is dropped at the end of the tick.
+	 *
+	 * @param s (const char*) The command.
+	 * @param n (std::size_t) Length of the command.
+	 */
+	void pushCommand(const char* s, std::size_t n) {
+		append(commands, lastCommand, arena.make<Text>(Text{arena.copy(s, n), n, nullptr}));
+		commandCount++;
+	}
+	Text const* getCommands() const {return commands;}
+	std::size_t getCommandCount() const {return commandCount;}
+	/**
+	 * @brief Queue text for the player, the network layer sends it before the end of the tick.
+	 *
+	 * @param s (const char*) The text.
+	 * @param n (std::size_t) Length of the text.
+	 */
+	void send(const char* s, std::size_t n) {
+		append(outbound, lastOutbound, arena.make<Text>(Text{arena.copy(s, n), n, nullptr}));
+		outboundBytes += n;
+	}
+	/**
+	 * @brief Queue text for the player without copying it, for text shared by many players.
+	 *
+	 * @param s (const char*) The text, it must stay unchanged until the end of the tick.
+	 * @param n (std::size_t) Length of the text.
+	 */
+	void sendShared(const char* s, std::size_t n) {
+		append(outbound, lastOutbound, arena.make<Text>(Text{s, n, nullptr}));
+		outboundBytes += n;
+	}
+	Text const* getOutbound() const {return outbound;}
+	/**
+	 * @brief Describe the outbound text for a single writev(), without copying it.
+	 *
+	 * @param out (std::vector<iovec>&) Receives one entry per piece of text, it is cleared first.
+	 * @return std::size_t Bytes described.
+	 */
+	std::size_t gather(std::vector<iovec>& out) const {
+		out.clear();
+		for (Text const* t = outbound; t; t = t->next) out.push_back({const_cast<char*>(t->data), t->length});
+		return outboundBytes;
+	}
+	std::size_t getOutboundBytes() const {return outboundBytes;}
+	/**
+	 * @brief Bytes reserved by the arena of the session.
+	 *
+	 * @return std::size_t
+	 */
+	std::size_t capacity() const {return arena.capacity();}
+};
+
+/**
+ * @brief Opens, finds and closes sessions in constant time. Slots are reused, the heap is only
+ * touched when more players are connected than ever before, or a tick needs a larger arena.
+ *
+ */
+class Manager {
+	std::vector<std::unique_ptr<Session>> slots;
+	std::vector<std::uint32_t> generations; // Generation of every slot, odd while it is open.
+	std::vector<std::uint32_t> positions; // Position of every open slot in live.
+	std::vector<std::uint32_t> live; // Open slots.
+	std::vector<std::uint32_t> freeSlots;
+	std::size_t blockSize;
+	std::uint32_t slotOf(id s) const {return static_cast<std::uint32_t>(s);}
+	std::uint32_t generationOf(id s) const {return static_cast<std::uint32_t>(s >> 32);}
+public:
+	/**
+	 * @brief Construct a new Manager object
+	 *
+	 * @param b (std::size_t) Size of the arena blocks of the sessions.
+	 */
+	Manager(std::size_t b = 4096) : blockSize(b) {}
+	/**
+	 * @brief Reserve slots, so that opening up to n sessions does not allocate.
+	 *
+	 * @param n (std::size_t) Number of sessions.
+	 */
+	void reserve(std::size_t n) {
+		slots.reserve(n);
+		generations.reserve(n);
+		positions.reserve(n);
+		live.reserve(n);
+		freeSlots.reserve(n);
+	}
+	/**
+	 * @brief Open a session.
+	 *
+	 * @param e (Entity*) The player's entity, it must outlive the session.
+	 * @param r (const node&) The room the player starts in.
+	 * @return id
+	 */
+	id open(Entity* e, const node& r) {
+		std::uint32_t slot;
+		if (freeSlots.empty()) {
+			slot = slots.size();
+			slots.push_back(std::unique_ptr<Session>(new Session(blockSize)));
+			generations.push_back(0);
+			positions.push_back(0);
+		} else {
+			slot = freeSlots.back();
+			freeSlots.pop_back();
+		}
+		std::uint32_t generation = ++generations[slot];
+		Session& s = *slots[slot];
+		s.sessionID = static_cast<id>(generation) << 32 | slot;
+		s.entity = e;
+		s.room = r;
+		positions[slot] = live.size();
+		live.push_back(slot);
+		return s.sessionID;
+	}
+	/**
+	 * @brief Find an open session.
+	 *
+	 * @param s (id) The session.
+	 * @return Session* Null if the session was closed.
+	 */
+	Session* get(id s) const {
+		std::uint32_t slot = slotOf(s);
+		if (slot >= slots.size() || generations[slot] != generationOf(s) || !(generations[slot] & 1)) return nullptr;
+		return slots[slot].get();
+	}
+	/**
+	 * @brief Close a session, its slot and arena are kept for the next one.
+	 *
+	 * @param s (id) The session.
+	 * @return false if the session was already closed.
+	 */
+	bool close(id s) {
+		Session* session = get(s);
+		if (!session) return false;
+		std::uint32_t slot = slotOf(s);
+		generations[slot]++;
+		session->clear();
+		session->room.reset();
+		session->entity = nullptr;
+		std::uint32_t moved = live.back();
+		live[positions[slot]] = moved;
+		positions[moved] = positions[slot];
+		live.pop_back();
+		freeSlots.push_back(slot);
+		return true;
+	}
+	/**
+	 * @brief Number of open sessions.
+	 *
+	 * @return std::size_t
+	 */
+	std::size_t size() const {return live.size();}
+	/**
+	 * @brief Call a function with every open session, in no particular order.
+	 *
+	 * @param f (F) Called with a Session&, it must not open or close sessions.
+	 */
+	template <typename F>
+	void forEach(F f) {
+		for (std::uint32_t slot : live) f(*slots[slot]);
+	}
+	/**
+	 * @brief Drop the commands and outbound text of every session. Called once the tick handled
+	 * the commands and the outbound text was sent.
+	 *
+	 */
+	void endTick() {
+		for (std::uint32_t slot : live) slots[slot]->clear();
+	}
+};
+
+}
+#endif
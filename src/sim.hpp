@@ -0,0 +1,30 @@
+#ifndef SIM
+#define SIM
+/* Speculative simulation. A what-if runs on a fork of the World, that shares the rooms and
+ * entities with the live World and copies only those it writes, so forking copies a pointer per
+ * chunk and the registered systems run on the fork as on the live World. The live World is never
+ * written to, but it writes the rooms it shares in place, so a what-if is run and read between two
+ * live ticks. */
+#include <memory>
+#include "engine.hpp"
+
+namespace sim {
+
+/**
+ * @brief Fork the World, apply a change to the fork and advance it with the systems of the World.
+ *
+ * @param w (const World&) The World.
+ * @param ticks (unsigned) Number of simulated ticks.
+ * @param change (const tickfunc&) Applied to the fork before the first tick, it writes through
+ * mutateRoom() and mutateEntity(). May be empty.
+ * @return std::unique_ptr<World> The fork after the ticks, valid until the World ticks again.
+ */
+inline std::unique_ptr<World> simulate(const World& w, unsigned ticks, const tickfunc& change = tickfunc()) {
+	std::unique_ptr<World> f = w.fork();
+	if (change) change(*f);
+	for (unsigned t = 0; t < ticks; t++) f->tick();
+	return f;
+}
+
+}
+#endif
@@ -0,0 +1,154 @@
+#ifndef STATS
+#define STATS
+/* Statistics, that parallel systems update. Every thread adds into its own cache line,
+ * the slots are merged once per tick, so no line bounces between the cores. */
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "crowd.hpp"
+
+namespace stats {
+
+/**
+ * @brief Number of indices handed out so far, every thread, that holds one, has a lower index.
+ *
+ * @return std::atomic<std::size_t>&
+ */
+inline std::atomic<std::size_t>& threadCount() {
+	static std::atomic<std::size_t> count(0);
+	return count;
+}
+
+/**
+ * @brief Indices of exited threads, handed out again before new ones.
+ *
+ */
+struct FreeIndices {
+	std::mutex mutex;
+	std::vector<std::size_t> indices;
+};
+
+/**
+ * @brief The free indices. Never destroyed, threads may still exit after the statics are gone.
+ *
+ * @return FreeIndices&
+ */
+inline FreeIndices& freeIndices() {
+	static FreeIndices* indices = new FreeIndices();
+	return *indices;
+}
+
+/**
+ * @brief The index of a thread, returned to the free indices when the thread exits. The mutex
+ * orders the adds of the exited thread before those of the next owner of its slots.
+ *
+ */
+class ThreadIndex {
+	std::size_t index;
+public:
+	ThreadIndex() {
+		FreeIndices& f = freeIndices();
+		std::lock_guard<std::mutex> lock(f.mutex);
+		if (f.indices.empty()) {
+			index = threadCount().fetch_add(1, std::memory_order_relaxed);
+		} else {
+			index = f.indices.back();
+			f.indices.pop_back();
+		}
+	}
+	~ThreadIndex() {
+		FreeIndices& f = freeIndices();
+		std::lock_guard<std::mutex> lock(f.mutex);
+		f.indices.push_back(index);
+	}
+	ThreadIndex(const ThreadIndex&) = delete;
+	ThreadIndex& operator=(const ThreadIndex&) = delete;
+	std::size_t get() const {return index;}
+};
+
+/**
+ * @brief Small, stable index of the calling thread, used to pick a slot. Indices of exited
+ * threads are reused, so short lived threads do not push the others into the overflow slot.
+ *
+ * @return std::size_t
+ */
+inline std::size_t threadIndex() {
+	thread_local ThreadIndex index;
+	return index.get();
+}
+
+/**
+ * @brief Sum, that is sharded into one cache line per thread and merged at the end of the tick.
+ * A slot is written only by its own thread, so adding is a relaxed load and store, no locked
+ * instruction. Threads beyond the slot count share an overflow slot with an atomic add.
+ *
+ */
+class Accumulator {
+	struct alignas(crowd::cacheLine) Slot {
+		std::atomic<std::int64_t> value; // Running sum of the owner, never reset.
+		std::int64_t merged; // Part of the value, that is in the total, only touched by the merging thread.
+	};
+	std::unique_ptr<Slot[]> slots; // Slot i belongs to the thread with index i, the last one overflows.
+	std::size_t shards;
+	std::int64_t total; // Merged value, only touched by the merging thread.
+public:
+	/**
+	 * @brief Construct a new Accumulator object
+	 *
+	 * @param n (std::size_t) Number of owned slots. Threads beyond it share one overflow slot.
+	 */
+	Accumulator(std::size_t n = 64) : shards(n ? n : 1), total(0) {
+		slots.reset(new Slot[shards + 1]);
+		for (std::size_t i = 0; i <= shards; i++) {
+			slots[i].value.store(0, std::memory_order_relaxed);
+			slots[i].merged = 0;
+		}
+	}
+	Accumulator(const Accumulator&) = delete;
+	Accumulator& operator=(const Accumulator&) = delete;
+	/**
+	 * @brief Add to the slot of the calling thread.
+	 *
+	 * @param n (std::int64_t) The added value.
+	 */
+	void add(std::int64_t n = 1) {
+		std::size_t i = threadIndex();
+		if (i < shards) {
+			std::atomic<std::int64_t>& v = slots[i].value;
+			v.store(v.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+		} else {
+			slots[shards].value.fetch_add(n, std::memory_order_relaxed);
+		}
+	}
+	/**
+	 * @brief Move what the slots gained since the last merge into the total. Called once per tick
+	 * from the tick thread. Only the slots of indices, that were handed out, are visited.
+	 *
+	 * @return std::int64_t The value merged in this call.
+	 */
+	std::int64_t merge() {
+		std::int64_t delta = 0;
+		std::size_t used = std::min(shards, threadCount().load(std::memory_order_relaxed));
+		auto take = [&delta](Slot& s) {
+			std::int64_t v = s.value.load(std::memory_order_relaxed);
+			delta += v - s.merged;
+			s.merged = v;
+		};
+		for (std::size_t i = 0; i < used; i++) take(slots[i]);
+		take(slots[shards]);
+		total += delta;
+		return delta;
+	}
+	/**
+	 * @brief Get the total as of the last merge.
+	 *
+	 * @return std::int64_t
+	 */
+	std::int64_t get() const {return total;}
+};
+
+}
+#endif
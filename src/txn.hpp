@@ -0,0 +1,227 @@
+#ifndef TXN
+#define TXN
+/* Transactions over the inventories of rooms and entities. A transaction records its moves and
+ * the versions of the inventories it saw, the commit locks the inventories only if nobody changed
+ * them since, applies the moves and undoes the applied ones, if a later move fails. */
+#include <algorithm>
+#include <cstring>
+#include "arena.hpp"
+#include "engine.hpp"
+
+namespace txn {
+
+/**
+ * @brief Outcome of a commit.
+ *
+ */
+enum class Result {
+	Committed, // Every move was applied.
+	Conflict, // Another thread changed an inventory since it was observed, nothing was applied.
+	Failed // A move could not be applied, the applied ones were undone.
+};
+
+/**
+ * @brief Moves items between inventories all or nothing.
+ *
+ * The records live in an Arena, so reusing a transaction, or its arena, is allocation free.
+ * While other threads commit, inventories must only be changed through transactions or the
+ * mutators of Room and Entity, which take the version lock for the change and wait while a
+ * commit holds it. Reading an inventory, that another thread may change, is not safe.
+ *
+ */
+class Transaction {
+	/**
+	 * @brief An inventory and its version, as seen by the transaction.
+	 *
+	 */
+	struct Container {
+		items* inventory;
+		Version* version;
+		std::uint64_t observed; // Version on the first touch.
+		std::size_t incoming; // Planned moves into the inventory.
+		Container* next;
+	};
+	/**
+	 * @brief A planned move of the item called name.
+	 *
+	 */
+	struct Move {
+		Container* from;
+		Container* to;
+		const char* name;
+		std::size_t length;
+		Move* next;
+	};
+	/**
+	 * @brief Undo record of an applied move, the item went from index of from to the back of to.
+	 *
+	 */
+	struct Undo {
+		items* from;
+		items* to;
+		std::size_t index;
+		Undo* previous;
+	};
+	Arena ownArena;
+	Arena& arena; // The records of the transaction.
+	Container* containers;
+	std::size_t containerCount;
+	Move* first;
+	Move* last;
+	/**
+	 * @brief Get the record of an inventory, observing its version on the first touch.
+	 *
+	 */
+	Container* touch(items& inventory, Version& version) {
+		for (Container* c = containers; c; c = c->next) {
+			if (c->inventory == &inventory) return c;
+		}
+		/* Wait out a commit in progress, the observed version has to be even. */
+		std::uint64_t v = version.get();
+		while (v & 1) v = version.get();
+		containers = arena.make<Container>(Container{&inventory, &version, v, 0, containers});
+		containerCount++;
+		return containers;
+	}
+	Transaction& plan(Container* from, const std::string& name, Container* to) {
+		Move* m = arena.make<Move>(Move{from, to, arena.copy(name.data(), name.size()), name.size(), nullptr});
+		to->incoming++;
+		if (last) {
+			last->next = m;
+		} else {
+			first = m;
+		}
+		last = m;
+		return *this;
+	}
+	static void undo(Undo* u) {
+		for (; u; u = u->previous) {
+			item i(std::move(u->to->back()));
+			u->to->pop_back();
+			u->from->insert(u->from->begin() + u->index, std::move(i));
+		}
+	}
+	/**
+	 * @brief The locked inventories of a commit. Unless the moves were applied, they are undone,
+	 * also when an exception leaves the commit. Then the versions are unlocked and the transaction
+	 * is emptied in any case.
+	 *
+	 */
+	class Locked {
+		Transaction& owner;
+		Container** order;
+		std::size_t count;
+	public:
+		Undo* log; // Applied moves, newest first.
+		bool applied; // Every move was applied.
+		Locked(Transaction& t, Container** o, std::size_t n) : owner(t), order(o), count(n), log(nullptr), applied(false) {}
+		Locked(const Locked&) = delete;
+		Locked& operator=(const Locked&) = delete;
+		~Locked() {
+			if (!applied) undo(log);
+			for (std::size_t i = 0; i < count; i++) order[i]->version->unlock(applied && log);
+			owner.rollback();
+		}
+	};
+public:
+	/**
+	 * @brief Construct a new Transaction object with its own arena.
+	 *
+	 */
+	Transaction() : arena(ownArena), containers(nullptr), containerCount(0), first(nullptr), last(nullptr) {}
+	/**
+	 * @brief Construct a new Transaction object, that keeps its records in a shared arena.
+	 *
+	 * @param a (Arena&) The arena, reset() by the transaction after commit or rollback.
+	 */
+	Transaction(Arena& a) : arena(a), containers(nullptr), containerCount(0), first(nullptr), last(nullptr) {}
+	Transaction(const Transaction&) = delete;
+	Transaction& operator=(const Transaction&) = delete;
+	/**
+	 * @brief Plan to move an item from a room to an entity.
+	 *
+	 * @param from (Room&) The room.
+	 * @param name (const std::string&) Name of the item.
+	 * @param to (Entity&) The entity.
+	 * @return Transaction&
+	 */
+	Transaction& move(Room& from, const std::string& name, Entity& to) {
+		return plan(touch(from.stock(), from.version), name, touch(to.inventory, to.version));
+	}
+	/**
+	 * @brief Plan to move an item from one entity to another one.
+	 *
+	 * @param from (Entity&) The giving entity.
+	 * @param name (const std::string&) Name of the item.
+	 * @param to (Entity&) The receiving entity.
+	 * @return Transaction&
+	 */
+	Transaction& move(Entity& from, const std::string& name, Entity& to) {
+		return plan(touch(from.inventory, from.version), name, touch(to.inventory, to.version));
+	}
+	/**
+	 * @brief Plan to drop an item of an entity into a room.
+	 *
+	 * @param from (Entity&) The entity.
+	 * @param name (const std::string&) Name of the item.
+	 * @param to (Room&) The room.
+	 * @return Transaction&
+	 */
+	Transaction& move(Entity& from, const std::string& name, Room& to) {
+		return plan(touch(from.inventory, from.version), name, touch(to.stock(), to.version));
+	}
+	/**
+	 * @brief Forget every planned move.
+	 *
+	 */
+	void rollback() {
+		containers = nullptr;
+		containerCount = 0;
+		first = last = nullptr;
+		arena.reset();
+	}
+	/**
+	 * @brief Apply every planned move or none of them. The transaction is empty afterwards.
+	 *
+	 * @return Result
+	 */
+	Result commit() {
+		/* Lock in address order, so two commits never wait for each other in a circle. */
+		Container** order = static_cast<Container**>(arena.allocate(containerCount * sizeof(Container*), alignof(Container*)));
+		std::size_t n = 0;
+		for (Container* c = containers; c; c = c->next) order[n++] = c;
+		std::sort(order, order + n, [](Container* a, Container* b) {return a->version < b->version;});
+		std::size_t locked = 0;
+		while (locked < n && order[locked]->version->lock(order[locked]->observed)) locked++;
+		if (locked < n) {
+			while (locked) order[--locked]->version->unlock(false);
+			rollback();
+			return Result::Conflict;
+		}
+		bool failed = false;
+		{
+			Locked guard(*this, order, n);
+			/* Every move is undone if an exception leaves here: the inventories have room for
+			 * every move, so only making an undo record can throw, and it is made before its move. */
+			for (std::size_t i = 0; i < n; i++) order[i]->inventory->reserve(order[i]->inventory->size() + order[i]->incoming);
+			for (Move* m = first; m; m = m->next) {
+				items& from = *m->from->inventory;
+				std::size_t i = 0;
+				while (i < from.size() && from[i]->getName().compare(0, std::string::npos, m->name, m->length)) i++;
+				if (i == from.size()) {
+					failed = true;
+					break;
+				}
+				Undo* u = arena.make<Undo>(Undo{&from, m->to->inventory, i, guard.log});
+				m->to->inventory->push_back(std::move(from[i]));
+				from.erase(from.begin() + i);
+				guard.log = u;
+			}
+			guard.applied = !failed;
+		}
+		return failed ? Result::Failed : Result::Committed;
+	}
+};
+
+}
+#endif
@@ -0,0 +1,695 @@
+#ifndef WAL
+#define WAL
+/* Write ahead log of the inventory mutations. Appends are buffered and a writer thread makes a
+ * whole group durable with one write and one fdatasync, either when the group window elapsed or
+ * when the tick asks for it. Acknowledgements are only sent once their group is on disk.
+ *
+ * A log directory holds segments "wal-<first sequence>.log" and base snapshots
+ * "base-<sequence>.snap". A record is
+ *     u32 body length, u32 checksum of the body, body: u64 sequence, u8 op, target, item, keyID,
+ * and for Vitals i32 hit points, i32 stamina, with strings as u32 length and characters. Recovery
+ * loads the newest base and replays the records after it, a torn record at the end of the last
+ * segment ends the replay.
+ *
+ * A base is "SWBASE03", u64 sequence, u32 section count, u32 CRC32C of the header so far, and the
+ * sections, each u32 length, u32 CRC32C of the body, body: u32 targets, per target its key, u32
+ * item count and per item name and keyID. The sections are verified independently, in parallel on
+ * a pool, before any of them is parsed. */
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "crc32c.hpp"
+#include "engine.hpp"
+
+namespace wal {
+
+enum class Op : std::uint8_t {
+	Add = 1, // Add the item to the inventory of the target.
+	Remove = 2, // Remove one item of that name.
+	Clear = 3, // Empty the inventory.
+	Vitals = 4, // Set the hit points and the stamina of an entity.
+	Heartbeat = 5 // Nothing, keeps an idle replication stream alive.
+};
+
+/**
+ * @brief A change of the inventory of a room or an entity.
+ *
+ */
+struct Mutation {
+	Op op;
+	std::string target; // roomKey() or entityKey().
+	std::string item;
+	std::string keyID; // Not empty if the item is a Key.
+	std::int32_t hp = 0; // Vitals only.
+	std::int32_t stamina = 0;
+};
+
+inline std::string roomKey(const std::string& name) {return "room/" + name;}
+inline std::string entityKey(const std::string& name) {return "entity/" + name;}
+
+/**
+ * @typedef Items in the inventory of every target, sorted by target.
+ *
+ */
+typedef std::map<std::string, std::vector<Prefab::Slot>> State;
+
+/**
+ * @brief Apply a mutation to a state, Vitals and Heartbeats leave it as it is.
+ *
+ * @param s (State&) The state.
+ * @param m (const Mutation&) The mutation.
+ */
+inline void applyMutation(State& s, const Mutation& m) {
+	if (m.op == Op::Vitals || m.op == Op::Heartbeat) return;
+	if (m.op == Op::Add) {
+		s[m.target].push_back({m.item, m.keyID});
+		return;
+	}
+	auto it = s.find(m.target);
+	if (it == s.end()) return;
+	if (m.op == Op::Remove) {
+		auto i = std::find_if(it->second.begin(), it->second.end(), [&](const Prefab::Slot& x) {return x.name == m.item;});
+		if (i != it->second.end()) it->second.erase(i);
+	}
+	if (m.op == Op::Clear || it->second.empty()) s.erase(it);
+}
+
+/**
+ * @brief FNV-1a checksum of a record body.
+ *
+ */
+inline std::uint32_t checksum(const char* data, std::size_t n) {
+	std::uint32_t h = 2166136261u;
+	for (std::size_t i = 0; i < n; i++) {
+		h ^= static_cast<unsigned char>(data[i]);
+		h *= 16777619u;
+	}
+	return h;
+}
+
+template <typename T>
+inline void put(std::string& out, T v) {
+	out.append(reinterpret_cast<const char*>(&v), sizeof(v));
+}
+
+inline void putString(std::string& out, const std::string& s) {
+	put<std::uint32_t>(out, s.size());
+	out += s;
+}
+
+/**
+ * @brief Append the encoded record of a mutation.
+ *
+ * @param out (std::string&) The buffer.
+ * @param sequence (std::uint64_t) Sequence number of the mutation.
+ * @param m (const Mutation&) The mutation.
+ */
+inline void encode(std::string& out, std::uint64_t sequence, const Mutation& m) {
+	std::size_t at = out.size();
+	put<std::uint32_t>(out, 0);
+	put<std::uint32_t>(out, 0);
+	put(out, sequence);
+	put(out, static_cast<std::uint8_t>(m.op));
+	putString(out, m.target);
+	putString(out, m.item);
+	putString(out, m.keyID);
+	if (m.op == Op::Vitals) {
+		put(out, m.hp);
+		put(out, m.stamina);
+	}
+	std::uint32_t length = out.size() - at - 8;
+	std::uint32_t sum = checksum(&out[at + 8], length);
+	std::memcpy(&out[at], &length, 4);
+	std::memcpy(&out[at + 4], &sum, 4);
+}
+
+/**
+ * @brief Reads values from a range of a buffer, never past its end.
+ *
+ */
+class Cursor {
+	const std::string& data;
+	std::size_t pos;
+	std::size_t end;
+public:
+	Cursor(const std::string& d, std::size_t from, std::size_t to) : data(d), pos(from), end(to) {}
+	template <typename T>
+	bool get(T& v) {
+		if (end - pos < sizeof(T)) return false;
+		std::memcpy(&v, &data[pos], sizeof(T));
+		pos += sizeof(T);
+		return true;
+	}
+	bool getString(std::string& s) {
+		std::uint32_t n;
+		if (!get(n) || end - pos < n) return false;
+		s.assign(data, pos, n);
+		pos += n;
+		return true;
+	}
+	bool skip(std::size_t n) {
+		if (end - pos < n) return false;
+		pos += n;
+		return true;
+	}
+	std::size_t position() const {return pos;}
+	bool atEnd() const {return pos == end;}
+};
+
+/**
+ * @brief Reads the records of an encoded buffer.
+ *
+ */
+class Decoder {
+	const std::string& data;
+	std::size_t pos;
+public:
+	Decoder(const std::string& d) : data(d), pos(0) {}
+	/**
+	 * @brief Read the next record.
+	 *
+	 * @param sequence (std::uint64_t&) Receives the sequence number.
+	 * @param m (Mutation&) Receives the mutation.
+	 * @return false at the end of the data, or at a torn or corrupt record.
+	 */
+	bool next(std::uint64_t& sequence, Mutation& m) {
+		Cursor header(data, pos, data.size());
+		std::uint32_t length, sum;
+		if (!header.get(length) || !header.get(sum) || data.size() - header.position() < length) return false;
+		std::size_t end = header.position() + length;
+		if (checksum(&data[header.position()], length) != sum) return false;
+		Cursor c(data, header.position(), end);
+		std::uint8_t op;
+		if (!c.get(sequence) || !c.get(op) || !c.getString(m.target) || !c.getString(m.item)) return false;
+		m.keyID.clear();
+		if (!c.atEnd() && !c.getString(m.keyID)) return false; // Records without a keyID are from older logs.
+		m.op = static_cast<Op>(op);
+		if (m.op == Op::Vitals && (!c.get(m.hp) || !c.get(m.stamina))) return false;
+		pos = end;
+		return true;
+	}
+	std::size_t position() const {return pos;}
+};
+
+/**
+ * @brief Bytes of whole, intact records at the start of an encoded buffer.
+ *
+ */
+inline std::size_t validLength(const std::string& data) {
+	Decoder d(data);
+	std::size_t valid = 0;
+	std::uint64_t sequence;
+	Mutation m;
+	while (d.next(sequence, m)) valid = d.position();
+	return valid;
+}
+
+/**
+ * @brief Name of a segment or base file, the sequence is zero padded so names sort by it.
+ *
+ */
+inline std::string fileName(const std::string& prefix, std::uint64_t sequence, const std::string& suffix) {
+	char digits[24];
+	std::snprintf(digits, sizeof(digits), "%020llu", static_cast<unsigned long long>(sequence));
+	return prefix + digits + suffix;
+}
+
+/**
+ * @brief Files of a log directory with the given prefix and suffix.
+ *
+ * @return std::vector<std::pair<std::uint64_t, std::string>> Sequence and path, sorted by sequence.
+ */
+inline std::vector<std::pair<std::uint64_t, std::string>> list(const std::string& dir, const std::string& prefix, const std::string& suffix) {
+	std::vector<std::pair<std::uint64_t, std::string>> files;
+	DIR* d = opendir(dir.c_str());
+	if (!d) return files;
+	while (dirent* e = readdir(d)) {
+		std::string name = e->d_name;
+		if (name.size() != prefix.size() + 20 + suffix.size() || name.compare(0, prefix.size(), prefix)
+			|| name.compare(name.size() - suffix.size(), suffix.size(), suffix)) continue;
+		files.push_back(std::make_pair(std::stoull(name.substr(prefix.size(), 20)), dir + "/" + name));
+	}
+	closedir(d);
+	std::sort(files.begin(), files.end());
+	return files;
+}
+
+inline std::string readFile(const std::string& path) {
+	std::string data;
+	int fd = ::open(path.c_str(), O_RDONLY);
+	if (fd < 0) return data;
+	char buffer[65536];
+	ssize_t n;
+	while ((n = ::read(fd, buffer, sizeof(buffer))) > 0) data.append(buffer, n);
+	::close(fd);
+	return data;
+}
+
+/**
+ * @brief Write a whole buffer to a file descriptor.
+ *
+ * @return false on an error.
+ */
+inline bool writeAll(int fd, const char* data, std::size_t n) {
+	while (n) {
+		ssize_t w = ::write(fd, data, n);
+		if (w < 0 && errno == EINTR) continue;
+		if (w < 0) return false;
+		data += w;
+		n -= w;
+	}
+	return true;
+}
+
+/**
+ * @brief Make the entries of a directory durable.
+ *
+ */
+inline void syncDirectory(const std::string& dir) {
+	int fd = ::open(dir.c_str(), O_RDONLY | O_DIRECTORY);
+	if (fd < 0) return;
+	::fsync(fd);
+	::close(fd);
+}
+
+/**
+ * @brief Append a section: u32 length, u32 CRC32C of the body, body.
+ *
+ */
+inline void putSection(std::string& out, const std::string& body) {
+	put<std::uint32_t>(out, body.size());
+	put(out, crc32c::compute(body.data(), body.size()));
+	out += body;
+}
+
+/**
+ * @brief Locate the sections of a buffer and verify their checksums.
+ *
+ * @param data (const std::string&) The buffer.
+ * @param pos (std::size_t) Position of the first section.
+ * @param count (std::uint32_t) Number of sections, the last one has to end with the buffer.
+ * @param sections (std::vector<std::pair<std::size_t, std::size_t>>&) Receives position and length
+ * of every body.
+ * @param pool (jobs::Pool*) Pool, that verifies the sections in parallel, null verifies on the
+ * calling thread.
+ * @return false if a section is truncated or does not match its checksum.
+ */
+inline bool readSections(const std::string& data, std::size_t pos, std::uint32_t count,
+	std::vector<std::pair<std::size_t, std::size_t>>& sections, jobs::Pool* pool = nullptr) {
+	Cursor c(data, pos, data.size());
+	std::vector<std::uint32_t> sums;
+	sections.clear();
+	for (std::uint32_t i = 0; i < count; i++) {
+		std::uint32_t length, sum;
+		if (!c.get(length) || !c.get(sum)) return false;
+		sections.push_back(std::make_pair(c.position(), length));
+		sums.push_back(sum);
+		if (!c.skip(length)) return false;
+	}
+	if (!c.atEnd()) return false;
+	auto intact = [&](std::size_t i) {
+		return crc32c::compute(&data[sections[i].first], sections[i].second) == sums[i];
+	};
+	std::vector<std::uint8_t> ok(count, 1);
+	if (pool && count > 1) {
+		std::vector<jobs::handle> checks;
+		for (std::size_t i = 0; i < count; i++) {
+			checks.push_back(pool->submit("section_verify", jobs::Priority::Normal, [&ok, &intact, i] {ok[i] = intact(i);}));
+		}
+		for (jobs::handle const& h : checks) h->wait();
+	} else {
+		for (std::size_t i = 0; i < count; i++) ok[i] = intact(i);
+	}
+	return std::find(ok.begin(), ok.end(), 0) == ok.end();
+}
+
+constexpr std::size_t sectionBytes = 1 << 16; // A section is closed once it is larger.
+
+/**
+ * @brief Write a base snapshot of a state, durably and atomically.
+ *
+ * @param dir (const std::string&) The log directory.
+ * @param s (const State&) The state.
+ * @param sequence (std::uint64_t) Sequence of the last mutation contained in the state.
+ * @throws std::runtime_error if the file cannot be written.
+ */
+inline void writeBase(const std::string& dir, const State& s, std::uint64_t sequence) {
+	std::vector<std::string> bodies;
+	std::string body;
+	std::uint32_t targets = 0;
+	auto seal = [&]() {
+		std::string section;
+		put(section, targets);
+		bodies.push_back(section + body);
+		body.clear();
+		targets = 0;
+	};
+	for (auto const& e : s) {
+		putString(body, e.first);
+		put<std::uint32_t>(body, e.second.size());
+		for (Prefab::Slot const& i : e.second) {
+			putString(body, i.name);
+			putString(body, i.keyID);
+		}
+		targets++;
+		if (body.size() >= sectionBytes) seal();
+	}
+	if (targets) seal();
+	std::string data = "SWBASE03";
+	put(data, sequence);
+	put<std::uint32_t>(data, bodies.size());
+	put(data, crc32c::compute(data.data(), data.size()));
+	for (std::string const& b : bodies) putSection(data, b);
+	std::string path = dir + "/" + fileName("base-", sequence, ".snap");
+	std::string temporary = path + ".tmp";
+	int fd = ::open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0) throw std::runtime_error("wal: cannot create " + temporary);
+	bool ok = writeAll(fd, data.data(), data.size()) && ::fdatasync(fd) == 0;
+	::close(fd);
+	if (!ok || std::rename(temporary.c_str(), path.c_str())) throw std::runtime_error("wal: cannot write " + path);
+	syncDirectory(dir);
+}
+
+/**
+ * @brief Read the targets of a base, from a section or a whole base of version 1 or 2.
+ *
+ * @return false if the data ends early or holds more than the targets.
+ */
+inline bool readTargets(Cursor& c, std::uint64_t count, bool keys, State& s) {
+	for (std::uint64_t i = 0; i < count; i++) {
+		std::string target;
+		std::uint32_t n;
+		if (!c.getString(target) || !c.get(n)) return false;
+		std::vector<Prefab::Slot>& inv = s[target];
+		for (std::uint32_t j = 0; j < n; j++) {
+			Prefab::Slot slot;
+			if (!c.getString(slot.name) || (keys && !c.getString(slot.keyID))) return false;
+			inv.push_back(std::move(slot));
+		}
+	}
+	return c.atEnd();
+}
+
+/**
+ * @brief Read a base snapshot, every read is bounds checked.
+ *
+ * @param path (const std::string&) The file.
+ * @param s (State&) Receives the state.
+ * @param sequence (std::uint64_t&) Receives the sequence of the base.
+ * @param pool (jobs::Pool*) Pool, that verifies the sections in parallel, may be null.
+ * @return false if the file is missing or corrupt.
+ */
+inline bool readBase(const std::string& path, State& s, std::uint64_t& sequence, jobs::Pool* pool = nullptr) {
+	std::string data = readFile(path);
+	s.clear();
+	if (data.size() < 8) return false;
+	if (!data.compare(0, 8, "SWBASE03")) {
+		Cursor header(data, 8, data.size());
+		std::uint32_t count, sum;
+		if (!header.get(sequence) || !header.get(count)) return false;
+		std::uint32_t expected = crc32c::compute(data.data(), header.position());
+		if (!header.get(sum) || sum != expected) return false;
+		std::vector<std::pair<std::size_t, std::size_t>> sections;
+		if (!readSections(data, header.position(), count, sections, pool)) return false;
+		for (auto const& section : sections) {
+			Cursor c(data, section.first, section.first + section.second);
+			std::uint32_t targets;
+			if (!c.get(targets) || !readTargets(c, targets, true, s)) return false;
+		}
+		return true;
+	}
+	/* Versions 1 and 2 have one FNV-1a checksum over the whole file, version 1 no keyIDs. */
+	if (data.size() < 28 || (data.compare(0, 8, "SWBASE01") && data.compare(0, 8, "SWBASE02"))) return false;
+	std::uint32_t sum;
+	std::memcpy(&sum, &data[data.size() - 4], 4);
+	if (checksum(data.data(), data.size() - 4) != sum) return false;
+	Cursor c(data, 8, data.size() - 4);
+	std::uint64_t count;
+	return c.get(sequence) && c.get(count) && readTargets(c, count, data[7] == '2', s);
+}
+
+/**
+ * @brief Result of a recovery.
+ *
+ */
+struct Recovery {
+	State state;
+	std::uint64_t base; // Sequence of the loaded base, 0 without one.
+	std::uint64_t last; // Sequence of the last recovered mutation.
+	std::size_t replayed; // Mutations replayed on top of the base.
+};
+
+/**
+ * @brief Rebuild the state from the newest readable base and the segments after it.
+ *
+ * @param dir (const std::string&) The log directory.
+ * @param pool (jobs::Pool*) Pool, that verifies the sections of the base in parallel, may be null.
+ * @return Recovery
+ */
+inline Recovery recover(const std::string& dir, jobs::Pool* pool = nullptr) {
+	Recovery r = {State(), 0, 0, 0};
+	auto bases = list(dir, "base-", ".snap");
+	for (auto it = bases.rbegin(); it != bases.rend(); it++) {
+		if (readBase(it->second, r.state, r.base, pool)) break;
+		r.state.clear();
+		r.base = 0;
+	}
+	r.last = r.base;
+	for (auto const& seg : list(dir, "wal-", ".log")) {
+		std::string data = readFile(seg.second);
+		Decoder d(data);
+		std::uint64_t sequence;
+		Mutation m;
+		while (d.next(sequence, m)) {
+			if (sequence <= r.last) continue;
+			applyMutation(r.state, m);
+			r.last = sequence;
+			r.replayed++;
+		}
+	}
+	return r;
+}
+
+/**
+ * @brief Apply a recovered state to the rooms and entities of a World, replacing their
+ * inventories with Objects of the logged names, or Keys if a keyID was logged. Targets, that are
+ * no room or entity of the World, are ignored.
+ *
+ * @param w (World&) The World.
+ * @param s (const State&) The state.
+ */
+inline void restore(World& w, const State& s) {
+	auto build = [](const Prefab::Slot& i) {return item(i.keyID.empty() ? new Object(i.name) : new Key(i.name, i.keyID));};
+	for (node const& r : w.getRooms()) {
+		r->takeItems();
+		auto it = s.find(roomKey(r->getName()));
+		if (it == s.end()) continue;
+		items restored;
+		for (Prefab::Slot const& i : it->second) restored.push_back(build(i));
+		r->addItems(restored);
+	}
+	for (std::shared_ptr<Entity> const& e : w.getEntities()) {
+		e->takeItems();
+		auto it = s.find(entityKey(e->getName()));
+		if (it == s.end()) continue;
+		for (Prefab::Slot const& i : it->second) {
+			item restored = build(i);
+			e->addItem(restored);
+		}
+	}
+}
+
+/**
+ * @brief The appending side of the log.
+ *
+ */
+class Log {
+	std::string dir;
+	std::uint64_t window; // Nanoseconds a group waits for more records.
+	std::size_t segmentBytes; // A segment is closed once it is larger.
+	jobs::Mailbox* acks; // Receives the acknowledgements, null runs them on the writer thread.
+	int fd;
+	std::size_t segmentSize;
+	std::mutex logMutex;
+	std::condition_variable appended;
+	std::condition_variable committed;
+	std::string pending; // Encoded records of the next group.
+	std::vector<std::function<void()>> pendingAcks;
+	std::uint64_t pendingSince; // Time of the first record of the next group.
+	std::uint64_t next; // Sequence of the next record.
+	std::uint64_t durableSequence; // Last sequence on disk.
+	std::uint64_t groups;
+	bool syncRequested;
+	bool stopping;
+	bool failed;
+	std::thread writer;
+	bool openSegment(std::uint64_t first) {
+		fd = ::open((dir + "/" + fileName("wal-", first, ".log")).c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+		if (fd < 0) return false;
+		off_t size = ::lseek(fd, 0, SEEK_END);
+		segmentSize = size > 0 ? size : 0;
+		syncDirectory(dir);
+		return true;
+	}
+	void write() {
+		std::unique_lock<std::mutex> lock(logMutex);
+		while (true) {
+			appended.wait(lock, [this] {return stopping || !pending.empty();});
+			if (pending.empty()) return;
+			std::uint64_t now = profiler::now();
+			std::uint64_t wait = pendingSince + window > now ? pendingSince + window - now : 0;
+			appended.wait_for(lock, std::chrono::nanoseconds(wait), [this] {return syncRequested || stopping;});
+			std::string group;
+			std::vector<std::function<void()>> groupAcks;
+			group.swap(pending);
+			groupAcks.swap(pendingAcks);
+			std::uint64_t last = next - 1;
+			syncRequested = false;
+			lock.unlock();
+			bool ok = writeAll(fd, group.data(), group.size()) && ::fdatasync(fd) == 0;
+			segmentSize += group.size();
+			if (ok && segmentSize >= segmentBytes) {
+				::close(fd);
+				ok = openSegment(last + 1);
+			}
+			if (ok) {
+				for (auto& a : groupAcks) {
+					if (!a) continue;
+					if (acks) {
+						acks->post(std::move(a));
+					} else {
+						a();
+					}
+				}
+			}
+			lock.lock();
+			if (!ok) {
+				failed = true;
+				committed.notify_all();
+				return;
+			}
+			/* Published after the acknowledgements, so they are out once sync() returns. */
+			durableSequence = last;
+			groups++;
+			committed.notify_all();
+		}
+	}
+public:
+	/**
+	 * @brief Open a log directory for appending, after the records already in it. A torn record
+	 * at the end of the newest segment, left by a crash during a write, is cut off first, records
+	 * appended behind it would never be replayed.
+	 *
+	 * @param d (const std::string&) The directory, it has to exist.
+	 * @param w (std::uint64_t) Nanoseconds a group waits for more records.
+	 * @param a (jobs::Mailbox*) Mailbox, that receives the acknowledgements, the World's one for example.
+	 * @param segment (std::size_t) Bytes, after which a new segment is started.
+	 * @throws std::runtime_error if a segment cannot be opened or truncated.
+	 */
+	Log(const std::string& d, std::uint64_t w = 2000000, jobs::Mailbox* a = nullptr, std::size_t segment = 64 << 20)
+		: dir(d), window(w), segmentBytes(segment), acks(a), fd(-1), segmentSize(0), pendingSince(0), groups(0),
+		syncRequested(false), stopping(false), failed(false) {
+		auto segments = list(dir, "wal-", ".log");
+		if (!segments.empty()) {
+			std::string const& path = segments.back().second;
+			std::string data = readFile(path);
+			std::size_t valid = validLength(data);
+			if (valid < data.size()) {
+				int f = ::open(path.c_str(), O_WRONLY);
+				bool ok = f >= 0 && ::ftruncate(f, valid) == 0 && ::fdatasync(f) == 0;
+				if (f >= 0) ::close(f);
+				if (!ok) throw std::runtime_error("wal: cannot truncate " + path);
+			}
+		}
+		next = recover(dir).last + 1;
+		durableSequence = next - 1;
+		if (!openSegment(next)) throw std::runtime_error("wal: cannot open a segment in " + dir);
+		writer = std::thread([this] {write();});
+	}
+	Log(const Log&) = delete;
+	Log& operator=(const Log&) = delete;
+	/**
+	 * @brief Destroy the Log object, pending records are made durable first.
+	 *
+	 */
+	~Log() {
+		{
+			std::lock_guard<std::mutex> lock(logMutex);
+			stopping = true;
+		}
+		appended.notify_one();
+		writer.join();
+		if (fd >= 0) ::close(fd);
+	}
+	/**
+	 * @brief Append a mutation to the next group.
+	 *
+	 * @param m (const Mutation&) The mutation.
+	 * @param ack (std::function<void()>) Called once the mutation is durable.
+	 * @return std::uint64_t Sequence of the mutation.
+	 * @throws std::runtime_error if an earlier group could not be written, the mutation would
+	 * never become durable.
+	 */
+	std::uint64_t append(const Mutation& m, std::function<void()> ack = nullptr) {
+		std::lock_guard<std::mutex> lock(logMutex);
+		if (failed) throw std::runtime_error("wal: cannot write to " + dir);
+		if (pending.empty()) pendingSince = profiler::now();
+		std::uint64_t sequence = next++;
+		encode(pending, sequence, m);
+		pendingAcks.push_back(std::move(ack));
+		appended.notify_one();
+		return sequence;
+	}
+	/**
+	 * @brief Commit the current group without waiting for the window, at the end of a tick.
+	 *
+	 */
+	void commit() {
+		std::lock_guard<std::mutex> lock(logMutex);
+		syncRequested = true;
+		appended.notify_one();
+	}
+	/**
+	 * @brief Commit the current group and wait until it is durable.
+	 *
+	 * @throws std::runtime_error if the log could not be written.
+	 */
+	void sync() {
+		std::unique_lock<std::mutex> lock(logMutex);
+		std::uint64_t last = next - 1;
+		syncRequested = true;
+		appended.notify_one();
+		committed.wait(lock, [&] {return failed || durableSequence >= last;});
+		if (failed) throw std::runtime_error("wal: cannot write to " + dir);
+	}
+	std::uint64_t getDurable() {
+		std::lock_guard<std::mutex> lock(logMutex);
+		return durableSequence;
+	}
+	/**
+	 * @brief Number of groups written, each with one fdatasync.
+	 *
+	 * @return std::uint64_t
+	 */
+	std::uint64_t getGroups() {
+		std::lock_guard<std::mutex> lock(logMutex);
+		return groups;
+	}
+};
+
+}
+#endif
@@ -0,0 +1,61 @@
+#include <gtest/gtest.h>
+#include "area.hpp"
+
+static nodes makeVault() {
+    node hall(new Room("Hall"));
+    node vault(new Room("Vault"));
+    hall->setDescription("A dusty hall.");
+    hall->addNeighbour(vault);
+    vault->addNeighbour(hall);
+    item key(new Key("Vault key", "Vault"));
+    item gold(new Object("Gold"));
+    hall->addItem(key);
+    vault->addItem(gold);
+    return nodes({hall, vault});
+}
+
+TEST(areatest, testlayout) {
+    area::layout l = area::build(makeVault());
+    ASSERT_EQ(l->size(), 2);
+    EXPECT_EQ(l->names[1], "Vault");
+    EXPECT_EQ(l->descriptions[0], "A dusty hall.");
+    EXPECT_EQ(l->door(0, 1), 0);
+    EXPECT_EQ(l->door(1, 0), 1);
+    EXPECT_EQ(l->items[0][0].keyID, "Vault");
+}
+
+TEST(areatest, testprivatestate) {
+    area::InstancePool pool(area::build(makeVault()));
+    area::Instance* a = pool.acquire();
+    area::Instance* b = pool.acquire();
+    EXPECT_EQ(&a->getName(0), &b->getName(0)) << "Instances should share the names.";
+    a->getItems(1).clear();
+    EXPECT_EQ(b->getItems(1).size(), 1) << "Looting one instance should not touch another.";
+    EXPECT_NE(dynamic_cast<const Key*>(b->getItems(0)[0].get()), nullptr);
+    a->enter(0);
+    EXPECT_TRUE(a->setLocked(0, 1, true));
+    EXPECT_FALSE(a->move(0, 1)) << "A locked door should stop the party.";
+    EXPECT_FALSE(b->move(0, 1)) << "Nobody should leave an empty room.";
+    EXPECT_EQ(b->getOccupants(0), 0);
+    EXPECT_FALSE(b->leave(0));
+    b->enter(0);
+    EXPECT_TRUE(b->move(0, 1));
+    EXPECT_EQ(b->getOccupants(1), 1);
+    EXPECT_EQ(a->getOccupants(0), 1);
+    EXPECT_FALSE(a->setLocked(0, 0, true));
+}
+
+TEST(areatest, testrecycle) {
+    area::InstancePool pool(area::build(makeVault()), 1);
+    area::Instance* a = pool.acquire();
+    a->getItems(1).clear();
+    a->setLocked(0, 1, true);
+    a->enter(0);
+    pool.release(a);
+    area::Instance* b = pool.acquire();
+    EXPECT_EQ(b, a) << "Released instances should be reused.";
+    EXPECT_EQ(pool.size(), 1);
+    EXPECT_EQ(b->getItems(1).size(), 1) << "A reused instance should start fresh.";
+    EXPECT_FALSE(b->isLocked(0, 1));
+    EXPECT_EQ(b->getOccupants(0), 0);
+}
@@ -0,0 +1,66 @@
+#include <gtest/gtest.h>
+#include <unistd.h>
+#include "chat.hpp"
+
+static std::string join(const session::Text* t) {
+    std::string s;
+    for (; t; t = t->next) s.append(t->data, t->length);
+    return s;
+}
+
+TEST(chattest, testsayandshout) {
+    node bridge(new Room("Bridge"));
+    node galley(new Room("Galley"));
+    node hold(new Room("Hold"));
+    bridge->addNeighbour(galley);
+    Entity ripley("Ripley");
+    session::Manager sessions;
+    session::Session& a = *sessions.get(sessions.open(&ripley, bridge));
+    session::Session& b = *sessions.get(sessions.open(&ripley, bridge));
+    session::Session& c = *sessions.get(sessions.open(&ripley, galley));
+    session::Session& d = *sessions.get(sessions.open(&ripley, hold));
+    chat::Broadcaster chat;
+    chat.say(*bridge, "Ripley", "hello");
+    chat.say(*bridge, "Dallas", "hi");
+    chat.shout(*bridge, "Ripley", "run");
+    EXPECT_EQ(chat.pending(), 1) << "Messages of one room should share a batch.";
+    EXPECT_EQ(chat.flush(sessions), 5);
+    EXPECT_EQ(join(a.getOutbound()), "Ripley says: hello\nDallas says: hi\nRipley shouts from Bridge: run\n");
+    EXPECT_EQ(join(c.getOutbound()), "Ripley shouts from Bridge: run\n") << "Shouts should be heard next door.";
+    EXPECT_EQ(d.getOutbound(), nullptr);
+    EXPECT_EQ(a.getOutbound()->data, b.getOutbound()->data) << "Listeners should share the buffer.";
+    EXPECT_EQ(a.getOutbound()->next->data, c.getOutbound()->data);
+    EXPECT_THROW(chat.say(*bridge, "Ash", "late"), std::runtime_error) << "Handed out buffers should not grow.";
+    chat.endTick();
+    sessions.endTick();
+    EXPECT_EQ(chat.pending(), 0);
+    EXPECT_EQ(chat.flush(sessions), 0);
+    chat.endTick();
+    chat.say(*bridge, "Ripley", "again");
+    EXPECT_EQ(chat.pending(), 1);
+    EXPECT_EQ(chat.flush(sessions), 2);
+    EXPECT_EQ(join(a.getOutbound()), "Ripley says: again\n") << "A kept batch should start empty.";
+    EXPECT_EQ(c.getOutbound(), nullptr);
+}
+
+TEST(chattest, testgather) {
+    node bridge(new Room("Bridge"));
+    Entity ripley("Ripley");
+    session::Manager sessions;
+    session::Session& s = *sessions.get(sessions.open(&ripley, bridge));
+    chat::Broadcaster chat;
+    s.send("Welcome\n", 8);
+    chat.say(*bridge, "Ash", "hello");
+    chat.flush(sessions);
+    std::vector<iovec> pieces;
+    std::size_t bytes = s.gather(pieces);
+    ASSERT_EQ(pieces.size(), 2);
+    int fds[2];
+    ASSERT_EQ(pipe(fds), 0);
+    EXPECT_EQ(writev(fds[1], pieces.data(), pieces.size()), static_cast<ssize_t>(bytes));
+    char received[64] = {0};
+    EXPECT_EQ(read(fds[0], received, sizeof(received)), static_cast<ssize_t>(bytes));
+    EXPECT_STREQ(received, "Welcome\nAsh says: hello\n");
+    close(fds[0]);
+    close(fds[1]);
+}
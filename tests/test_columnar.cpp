@@ -0,0 +1,91 @@
+#include <gtest/gtest.h>
+#include <cstdio>
+#include "columnar.hpp"
+
+static snapshot makeWorld(std::size_t n) {
+    World world;
+    nodes rooms;
+    for (std::size_t i = 0; i < n; i++) {
+        rooms.push_back(node(new Room("Room" + std::to_string(i))));
+        if (i) {
+            rooms[i]->addNeighbour(rooms[i - 1]);
+            rooms[i - 1]->addNeighbour(rooms[i]);
+        }
+        if (i % 3 == 0) {
+            item key(new Key("Key" + std::to_string(i), "Vault"));
+            rooms[i]->addItem(key);
+        }
+        world.addRoom(rooms[i]);
+    }
+    return world.makeSnapshot();
+}
+
+TEST(columnartest, testroundtrip) {
+    const std::string path = "test_columnar.swc";
+    snapshot s = makeWorld(10);
+    jobs::Pool pool(2);
+    {
+        columnar::Writer writer(path, &pool, 4, 2);
+        writer.write(s);
+    }
+    columnar::Reader reader(path);
+    EXPECT_EQ(reader.rows("rooms"), 10);
+    EXPECT_EQ(reader.rows("edges"), 18);
+    EXPECT_EQ(reader.rows("items"), 4);
+    std::vector<std::string> names = reader.readStrings("rooms", "name");
+    ASSERT_EQ(names.size(), 10);
+    EXPECT_EQ(names[0], "Room0");
+    EXPECT_EQ(names[9], "Room9") << "Row groups should be written in order.";
+    EXPECT_EQ(reader.readUInt32("rooms", "keys"), std::vector<std::uint32_t>({1, 0, 0, 1, 0, 0, 1, 0, 0, 1}));
+    std::vector<std::uint32_t> from = reader.readUInt32("edges", "from");
+    std::vector<std::uint32_t> to = reader.readUInt32("edges", "to");
+    ASSERT_EQ(from.size(), 18);
+    EXPECT_EQ(from[0], 0);
+    EXPECT_EQ(to[0], 1);
+    EXPECT_EQ(reader.readStrings("items", "name"), std::vector<std::string>({"Key0", "Key3", "Key6", "Key9"}));
+    EXPECT_EQ(reader.readUInt32("items", "room"), std::vector<std::uint32_t>({0, 3, 6, 9}));
+    EXPECT_EQ(reader.readStrings("items", "key"), std::vector<std::string>(4, "Vault"));
+    std::remove(path.c_str());
+}
+
+TEST(columnartest, testerrors) {
+    const std::string path = "test_columnar_bad.swc";
+    {
+        std::ofstream out(path);
+        out << "not a columnar file, but long enough";
+    }
+    EXPECT_THROW(columnar::Reader reader(path), std::runtime_error);
+    std::remove(path.c_str());
+    {
+        columnar::Writer writer(path);
+        writer.write(makeWorld(2));
+    }
+    columnar::Reader reader(path);
+    EXPECT_THROW(reader.readStrings("rooms", "keys"), std::runtime_error) << "keys is not a String column.";
+    std::remove(path.c_str());
+    columnar::Writer full("/dev/full");
+    full.write(makeWorld(2));
+    EXPECT_THROW(full.close(), std::runtime_error) << "A failed write should not go unnoticed.";
+}
+
+TEST(columnartest, testchecksums) {
+    const std::string path = "test_columnar_corrupt.swc";
+    {
+        columnar::Writer writer(path, nullptr, 4);
+        writer.write(makeWorld(10));
+    }
+    jobs::Pool pool(2);
+    EXPECT_NO_THROW(columnar::Reader reader(path, &pool));
+    {
+        std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+        file.seekp(40);
+        file.put('#');
+    }
+    try {
+        columnar::Reader reader(path, &pool);
+        ADD_FAILURE() << "A flipped byte should be detected.";
+    } catch (const std::runtime_error& e) {
+        EXPECT_NE(std::string(e.what()).find("row group 0"), std::string::npos) << e.what();
+    }
+    std::remove(path.c_str());
+}
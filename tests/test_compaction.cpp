@@ -0,0 +1,86 @@
+#include <gtest/gtest.h>
+#include <cstdlib>
+#include "compaction.hpp"
+
+static std::string makeDir() {
+    char name[] = "test_compaction_XXXXXX";
+    return mkdtemp(name);
+}
+
+static void removeDir(const std::string& dir) {
+    for (auto const& f : wal::list(dir, "wal-", ".log")) unlink(f.second.c_str());
+    for (auto const& f : wal::list(dir, "base-", ".snap")) unlink(f.second.c_str());
+    rmdir(dir.c_str());
+}
+
+TEST(compactiontest, testfold) {
+    std::string dir = makeDir();
+    {
+        wal::Log log(dir, 1000000, nullptr, 256);
+        for (int i = 0; i < 200; i++) {
+            log.append({wal::Op::Add, wal::roomKey("Hold"), "Crate"});
+            log.append({wal::Op::Remove, wal::roomKey("Hold"), "Crate"});
+            if (i % 10 == 0) log.sync();
+        }
+        log.append({wal::Op::Add, wal::entityKey("Ripley"), "Flare"});
+        log.append({wal::Op::Add, wal::roomKey("Bridge"), "Key"});
+        log.sync();
+    }
+    wal::Recovery before = wal::recover(dir);
+    std::size_t segments = wal::list(dir, "wal-", ".log").size();
+    ASSERT_GT(segments, 2);
+    compaction::Result r = compaction::compact(dir);
+    EXPECT_EQ(r.segments, segments - 1) << "Every segment but the newest should be folded.";
+    EXPECT_EQ(wal::list(dir, "wal-", ".log").size(), 1);
+    EXPECT_EQ(wal::list(dir, "base-", ".snap").size(), 1);
+    wal::Recovery after = wal::recover(dir);
+    EXPECT_EQ(after.state, before.state) << "Compaction should not change the recovered state.";
+    EXPECT_EQ(after.last, before.last);
+    EXPECT_EQ(after.base, r.base);
+    EXPECT_EQ(after.state.count(wal::roomKey("Hold")), 0) << "Undone mutations should be dropped.";
+    EXPECT_EQ(compaction::compact(dir).segments, 0);
+    removeDir(dir);
+}
+
+TEST(compactiontest, testbackground) {
+    std::string dir = makeDir();
+    {
+        wal::Log log(dir, 100000, nullptr, 512);
+        compaction::Compactor compactor(dir, 2, std::chrono::milliseconds(1));
+        for (int i = 0; i < 2000; i++) {
+            log.append({wal::Op::Add, wal::roomKey("Room" + std::to_string(i % 50)), "Coin"});
+            if (i % 20 == 0) log.sync();
+        }
+        log.sync();
+        for (int i = 0; i < 1000 && compactor.getFolded() == 0; i++) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        EXPECT_GT(compactor.getFolded(), 0) << "Appends should not stop the compactor.";
+    }
+    wal::Recovery r = wal::recover(dir);
+    EXPECT_EQ(r.last, 2000);
+    EXPECT_EQ(r.state.size(), 50);
+    EXPECT_EQ(r.state[wal::roomKey("Room7")].size(), 40);
+    removeDir(dir);
+}
+
+TEST(compactiontest, testdamagedsegment) {
+    std::string dir = makeDir();
+    {
+        wal::Log log(dir, 1000000, nullptr, 256);
+        for (int i = 0; i < 100; i++) {
+            log.append({wal::Op::Add, wal::roomKey("Hold"), "Crate"});
+            log.sync();
+        }
+    }
+    auto segments = wal::list(dir, "wal-", ".log");
+    ASSERT_GT(segments.size(), 3);
+    std::string damaged = segments[1].second;
+    int fd = open(damaged.c_str(), O_WRONLY);
+    ASSERT_EQ(pwrite(fd, "\xff", 1, 20), 1);
+    close(fd);
+    compaction::Result r = compaction::compact(dir);
+    EXPECT_TRUE(r.corrupt);
+    EXPECT_EQ(r.segments, 1) << "Only the segments before the damaged one should be folded.";
+    EXPECT_EQ(access(damaged.c_str(), F_OK), 0) << "A damaged segment should never be deleted.";
+    EXPECT_EQ(wal::list(dir, "wal-", ".log").size(), segments.size() - 1);
+    removeDir(dir);
+}
@@ -0,0 +1,73 @@
+#include <gtest/gtest.h>
+#include <chrono>
+#include <thread>
+#include "engine.hpp"
+
+TEST(controllertest, testdisabled) {
+    load::Controller c;
+    std::size_t low = c.add("decoding", load::Priority::Low);
+    for (int i = 0; i < 10; i++) {
+        c.beginTick();
+        EXPECT_TRUE(c.shouldRun(low)) << "Without a tick budget nothing should be shed.";
+        c.endTick(1000000);
+    }
+    EXPECT_EQ(c.getLevel(), 0);
+}
+
+TEST(controllertest, testshedbypriority) {
+    load::Controller c(1000, 2, 100);
+    std::size_t critical = c.add("movement", load::Priority::Critical);
+    std::size_t normal = c.add("planning", load::Priority::Normal);
+    std::size_t low = c.add("decoding", load::Priority::Low);
+    c.endTick(5000);
+    c.endTick(5000);
+    EXPECT_EQ(c.getLevel(), 1) << "Two ticks over budget should shed Low subsystems.";
+    c.beginTick();
+    EXPECT_TRUE(c.shouldRun(critical));
+    EXPECT_TRUE(c.shouldRun(normal));
+    EXPECT_FALSE(c.shouldRun(low));
+    c.endTick(5000);
+    c.endTick(5000);
+    EXPECT_EQ(c.getLevel(), 2);
+    c.beginTick();
+    EXPECT_TRUE(c.shouldRun(critical)) << "Critical subsystems are never shed.";
+    EXPECT_FALSE(c.shouldRun(normal));
+    EXPECT_FALSE(c.shouldRun(low));
+    EXPECT_EQ(c.getShed(), std::vector<std::string>({"planning", "decoding"}));
+    for (int i = 0; i < 4; i++) c.endTick(100);
+    EXPECT_EQ(c.getLevel(), 0) << "Ticks well under budget should lower the level again.";
+}
+
+TEST(controllertest, testbudgetandstarvation) {
+    load::Controller c(1000, 100, 3);
+    std::size_t greedy = c.add("replication", load::Priority::Normal, 100);
+    c.beginTick();
+    EXPECT_TRUE(c.shouldRun(greedy));
+    c.record(greedy, 900);
+    c.endTick(2000);
+    int shed = 0;
+    for (int i = 0; i < 4; i++) {
+        c.beginTick();
+        if (!c.shouldRun(greedy)) shed++;
+        c.endTick(2000);
+    }
+    EXPECT_EQ(shed, 3) << "A subsystem over its budget is deferred, but runs after 3 deferred ticks.";
+}
+
+TEST(controllertest, testworld) {
+    metrics::Registry registry;
+    World world;
+    int movement = 0;
+    int decoding = 0;
+    world.getController().setTickBudget(100000);
+    world.getController().attachMetrics(registry);
+    world.addSystem(Phase::Movement, [&](World&) {
+        movement++;
+        std::this_thread::sleep_for(std::chrono::microseconds(300));
+    });
+    world.addSystem(Phase::Replication, "decoding", load::Priority::Low, 0, [&](World&) {decoding++;});
+    for (int i = 0; i < 6; i++) world.tick();
+    EXPECT_EQ(movement, 6) << "Movement is critical and should run every tick.";
+    EXPECT_LT(decoding, 6) << "Decoding should be shed once the ticks are over budget.";
+    EXPECT_EQ(registry.counter("spacewalk_shed_total{subsystem=\"decoding\"}").get(), 6 - decoding);
+}
@@ -0,0 +1,26 @@
+#include <gtest/gtest.h>
+#include <string>
+#include "crc32c.hpp"
+
+TEST(crc32ctest, testknownvalues) {
+    EXPECT_EQ(crc32c::compute("", 0), 0);
+    EXPECT_EQ(crc32c::compute("123456789", 9), 0xE3069283) << "The CRC32C check value.";
+    std::string zeros(32, '\0');
+    EXPECT_EQ(crc32c::compute(zeros.data(), zeros.size()), 0x8A9136AA);
+}
+
+TEST(crc32ctest, testimplementationsagree) {
+    std::string data;
+    for (int i = 0; i < 1000; i++) data += static_cast<char>(i * 31 + 7);
+    for (std::size_t n : {0, 1, 7, 8, 9, 63, 64, 1000}) {
+        std::uint32_t expected = crc32c::software(0, data.data(), n);
+#ifdef CRC32C_HARDWARE
+        if (crc32c::available()) {
+            EXPECT_EQ(crc32c::hardware(0, data.data(), n), expected) << "Length " << n;
+        }
+#endif
+        EXPECT_EQ(crc32c::compute(data.data(), n), expected);
+    }
+    std::uint32_t split = crc32c::extend(crc32c::compute(data.data(), 333), data.data() + 333, 667);
+    EXPECT_EQ(split, crc32c::compute(data.data(), 1000)) << "Extending should equal one pass.";
+}
@@ -0,0 +1,68 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <thread>
+#include "engine.hpp"
+
+TEST(crowdtest, testunlimited) {
+    node room(new Room("Corridor"));
+    EXPECT_EQ(room->getOccupancy(), nullptr);
+    for (int i = 0; i < 100; i++) {
+        EXPECT_TRUE(room->tryEnter()) << "A room without capacity should never be full.";
+    }
+}
+
+TEST(crowdtest, testcapacity) {
+    node airlock(new Room("Airlock"));
+    airlock->setCapacity(2);
+    EXPECT_TRUE(airlock->tryEnter());
+    EXPECT_TRUE(airlock->tryEnter());
+    EXPECT_FALSE(airlock->tryEnter()) << "The third entrant should be turned away.";
+    EXPECT_TRUE(airlock->leave());
+    EXPECT_TRUE(airlock->tryEnter());
+    EXPECT_EQ(airlock->getOccupancy()->getOccupants(), 2);
+    EXPECT_TRUE(airlock->leave());
+    EXPECT_TRUE(airlock->leave());
+    EXPECT_FALSE(airlock->leave()) << "Leaving an empty room should be refused.";
+    EXPECT_EQ(airlock->getOccupancy()->getOccupants(), 0);
+    EXPECT_TRUE(airlock->tryEnter());
+    EXPECT_TRUE(airlock->tryEnter());
+    EXPECT_FALSE(airlock->tryEnter()) << "A refused leave should not raise the capacity.";
+}
+
+TEST(crowdtest, testfairqueue) {
+    crowd::Occupancy pod(1);
+    std::vector<int> admitted;
+    EXPECT_TRUE(pod.enterOrQueue([] {return true;}));
+    EXPECT_FALSE(pod.enterOrQueue([&] {admitted.push_back(1); return true;}));
+    EXPECT_FALSE(pod.enterOrQueue([&] {admitted.push_back(2); return false;}));
+    EXPECT_FALSE(pod.enterOrQueue([&] {admitted.push_back(3); return true;}));
+    EXPECT_FALSE(pod.tryEnter()) << "New entrants should not overtake the queue.";
+    pod.leave();
+    EXPECT_EQ(admitted, std::vector<int>({1}));
+    pod.leave();
+    EXPECT_EQ(admitted, std::vector<int>({1, 2, 3})) << "A declined slot should go to the next entrant.";
+    EXPECT_EQ(pod.getOccupants(), 1);
+    EXPECT_EQ(pod.getWaiting(), 0);
+}
+
+TEST(crowdtest, testcontention) {
+    crowd::Occupancy hot(4);
+    std::atomic<int> inside(0);
+    std::atomic<int> maxInside(0);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 8; t++) {
+        threads.push_back(std::thread([&] {
+            for (int i = 0; i < 10000; i++) {
+                if (!hot.tryEnter()) continue;
+                int n = ++inside;
+                int m = maxInside.load();
+                while (n > m && !maxInside.compare_exchange_weak(m, n)) {}
+                --inside;
+                hot.leave();
+            }
+        }));
+    }
+    for (auto& t : threads) t.join();
+    EXPECT_LE(maxInside.load(), 4) << "The capacity should never be exceeded.";
+    EXPECT_EQ(hot.getOccupants(), 0);
+}
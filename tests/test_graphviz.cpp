@@ -0,0 +1,94 @@
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include "graphviz.hpp"
+
+static query::Store makeLine(std::uint32_t n) {
+    query::Store s;
+    for (std::uint32_t i = 0; i < n; i++) {
+        std::vector<std::uint32_t> neighbours;
+        if (i) neighbours.push_back(i - 1);
+        if (i + 1 < n) neighbours.push_back(i + 1);
+        s.addRoom("Room" + std::to_string(i), 0, 0, neighbours);
+    }
+    return s;
+}
+
+static std::string readFile(const std::string& path) {
+    std::ifstream in(path);
+    std::stringstream ss;
+    ss << in.rdbuf();
+    return ss.str();
+}
+
+TEST(graphviztest, testdot) {
+    const std::string path = "test_graphviz.dot";
+    query::Store s = makeLine(3);
+    graphviz::Summary sum = graphviz::write(s, path, graphviz::Format::Dot);
+    EXPECT_EQ(sum.rooms, 3);
+    EXPECT_EQ(sum.edges, 4);
+    std::string dot = readFile(path);
+    EXPECT_EQ(dot.find("digraph world {\n"), 0);
+    EXPECT_NE(dot.find("  r1 [label=\"Room1\"];\n"), std::string::npos);
+    EXPECT_NE(dot.find("  r1 -> r2;\n"), std::string::npos);
+    EXPECT_EQ(dot.substr(dot.size() - 2), "}\n");
+    std::remove(path.c_str());
+}
+
+TEST(graphviztest, testgraphml) {
+    const std::string path = "test_graphviz.graphml";
+    query::Store s;
+    s.addRoom("Hall <\"A&B\">", 0, 0, {});
+    graphviz::write(s, path, graphviz::Format::GraphML);
+    std::string xml = readFile(path);
+    EXPECT_NE(xml.find("<data key=\"name\">Hall &lt;&quot;A&amp;B&quot;&gt;</data>"), std::string::npos) << "Names should be escaped.";
+    EXPECT_NE(xml.find("</graphml>\n"), std::string::npos);
+    std::remove(path.c_str());
+}
+
+TEST(graphviztest, testselection) {
+    const std::string path = "test_graphviz_sel.dot";
+    query::Store s = makeLine(100);
+    graphviz::Selection sel;
+    sel.center = "Room50";
+    sel.hops = 2;
+    graphviz::Summary sum = graphviz::write(s, path, graphviz::Format::Dot, sel);
+    EXPECT_EQ(sum.rooms, 5) << "Only rooms within two hops should be dumped.";
+    EXPECT_EQ(sum.edges, 8) << "Edges leaving the subgraph should be dropped.";
+
+    graphviz::Selection part;
+    part.begin = 10;
+    part.end = 20;
+    sum = graphviz::write(s, path, graphviz::Format::Dot, part);
+    EXPECT_EQ(sum.rooms, 10);
+    EXPECT_EQ(sum.edges, 18);
+
+    graphviz::Selection sample;
+    sample.sample = 0.25;
+    sample.seed = 7;
+    sum = graphviz::write(s, path, graphviz::Format::Dot, sample);
+    EXPECT_GT(sum.rooms, 5);
+    EXPECT_LT(sum.rooms, 50);
+    EXPECT_EQ(graphviz::write(s, path, graphviz::Format::Dot, sample).rooms, sum.rooms) << "The same seed should keep the same rooms.";
+
+    sel.center = "Nowhere";
+    EXPECT_THROW(graphviz::write(s, path, graphviz::Format::Dot, sel), std::runtime_error);
+    std::remove(path.c_str());
+}
+
+TEST(graphviztest, testdump) {
+    const std::string path = "test_graphviz_job.dot";
+    World world;
+    node a(new Room("A"));
+    node b(new Room("B"));
+    a->addNeighbour(b);
+    world.addRoom(a);
+    world.addRoom(b);
+    jobs::Pool pool(1);
+    graphviz::dump(pool, world.makeSnapshot(), path, graphviz::Format::Dot)->wait();
+    EXPECT_NE(readFile(path).find("  r0 -> r1;\n"), std::string::npos);
+    std::remove(path.c_str());
+    jobs::handle full = graphviz::dump(pool, world.makeSnapshot(), "/dev/full", graphviz::Format::Dot);
+    EXPECT_THROW(full->wait(), std::runtime_error) << "A failed write should reach the waiter.";
+}
@@ -0,0 +1,127 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <thread>
+#include "host.hpp"
+
+static void waitForTicks(host::Host& h, std::size_t id, std::uint64_t n) {
+    for (int i = 0; i < 2000 && h.getTicks(id) < n; i++) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+}
+
+TEST(hosttest, testschedule) {
+    jobs::Pool pool(2);
+    World fast, slow;
+    host::Host h(pool);
+    std::size_t f = h.add(fast, "fast", 1000000);
+    std::size_t s = h.add(slow, "slow", 1000000000, nullptr, true);
+    EXPECT_FALSE(fast.getProfiler().isEnabled()) << "Hosted Worlds should not be profiled by default.";
+    EXPECT_TRUE(slow.getProfiler().isEnabled());
+    std::uint64_t now = profiler::now();
+    h.step(now);
+    waitForTicks(h, f, 1);
+    waitForTicks(h, s, 1);
+    EXPECT_EQ(fast.getTickCount(), 1);
+    EXPECT_EQ(slow.getTickCount(), 1);
+    h.step(now + 10000000);
+    waitForTicks(h, f, 2);
+    EXPECT_EQ(fast.getTickCount(), 2);
+    EXPECT_EQ(slow.getTickCount(), 1) << "A World should not tick before its period passed.";
+}
+
+TEST(hosttest, testhibernation) {
+    jobs::Pool pool(1);
+    World world;
+    std::atomic<int> players(0);
+    host::Host h(pool);
+    std::size_t id = h.add(world, "vault", 1, [&](World&) {return players == 0;});
+    h.step();
+    waitForTicks(h, id, 1);
+    EXPECT_TRUE(h.isHibernating(id));
+    EXPECT_EQ(h.getHibernating(), 1);
+    EXPECT_EQ(h.step(profiler::now() + 1000000000), UINT64_MAX) << "A hibernating World should not be queued.";
+    EXPECT_EQ(world.getTickCount(), 1);
+    players = 1;
+    EXPECT_TRUE(h.wake(id));
+    EXPECT_FALSE(h.wake(id));
+    h.step(profiler::now() + 1000);
+    waitForTicks(h, id, 2);
+    EXPECT_EQ(world.getTickCount(), 2);
+    EXPECT_FALSE(h.isHibernating(id));
+}
+
+TEST(hosttest, testwakeduringtick) {
+    jobs::Pool pool(1);
+    World world;
+    std::atomic<bool> asked(false);
+    std::atomic<bool> answer(false);
+    host::Host h(pool);
+    std::size_t id = h.add(world, "airlock", 1, [&](World&) {
+        asked = true;
+        while (!answer) std::this_thread::yield();
+        return true;
+    });
+    h.step();
+    while (!asked) std::this_thread::yield();
+    EXPECT_FALSE(h.wake(id)) << "The World is still ticking.";
+    answer = true;
+    waitForTicks(h, id, 1);
+    EXPECT_FALSE(h.isHibernating(id)) << "A wake during the tick should not be lost.";
+    asked = false;
+    h.step(profiler::now() + 1000);
+    waitForTicks(h, id, 2);
+    EXPECT_TRUE(h.isHibernating(id)) << "Only one idle answer should be ignored.";
+}
+
+TEST(hosttest, testdeadlinesandmetrics) {
+    jobs::Pool pool(1);
+    metrics::Registry registry;
+    World world;
+    host::Host h(pool);
+    world.addSystem(Phase::Movement, [](World&) {std::this_thread::sleep_for(std::chrono::milliseconds(5));});
+    std::size_t id = h.add(world, "laggy", 1000);
+    h.attachMetrics(registry);
+    h.step();
+    waitForTicks(h, id, 1);
+    EXPECT_EQ(h.getMisses(id), 1) << "A tick longer than the period should miss its deadline.";
+    std::string text = registry.render();
+    EXPECT_NE(text.find("spacewalk_world_ticks_total{world=\"laggy\"} 1"), std::string::npos);
+    EXPECT_NE(text.find("spacewalk_world_deadline_misses_total{world=\"laggy\"} 1"), std::string::npos);
+    EXPECT_NE(text.find("spacewalk_worlds_hibernating 0"), std::string::npos);
+}
+
+TEST(hosttest, testrun) {
+    jobs::Pool pool(2);
+    std::vector<std::unique_ptr<World>> worlds;
+    host::Host h(pool);
+    for (int i = 0; i < 50; i++) {
+        worlds.push_back(std::unique_ptr<World>(new World()));
+        h.add(*worlds.back(), "w" + std::to_string(i), 1000000);
+    }
+    std::atomic<bool> stop(false);
+    std::thread scheduler([&] {h.run(stop);});
+    std::this_thread::sleep_for(std::chrono::milliseconds(30));
+    stop = true;
+    scheduler.join();
+    for (int i = 0; i < 50; i++) {
+        EXPECT_GT(h.getTicks(i), 0) << "Every World should get ticks.";
+    }
+}
+
+TEST(hosttest, testfailingtick) {
+    jobs::Pool pool(1);
+    World world;
+    metrics::Registry registry;
+    host::Host h(pool);
+    h.attachMetrics(registry);
+    int checks = 0;
+    std::size_t id = h.add(world, "broken", 1, [&](World&) -> bool {
+        if (checks++ == 0) throw std::runtime_error("idle check failed");
+        return false;
+    });
+    h.step();
+    waitForTicks(h, id, 1);
+    EXPECT_EQ(h.getFailures(id), 1);
+    EXPECT_EQ(registry.counter("spacewalk_world_tick_failures_total{world=\"broken\"}").get(), 1);
+    h.step(profiler::now() + 1000000);
+    waitForTicks(h, id, 2);
+    EXPECT_EQ(world.getTickCount(), 2) << "A World, whose tick threw, should stay scheduled.";
+}
@@ -0,0 +1,91 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include "engine.hpp"
+
+TEST(jobstest, testrun) {
+    jobs::Pool pool(4);
+    std::atomic<int> done(0);
+    std::vector<jobs::handle> handles;
+    for (int i = 0; i < 100; i++) {
+        handles.push_back(pool.submit("count", jobs::Priority::Normal, [&] {done++;}));
+    }
+    for (auto& h : handles) h->wait();
+    EXPECT_EQ(done.load(), 100);
+}
+
+TEST(jobstest, testdependencies) {
+    jobs::Pool pool(4);
+    std::vector<int> order;
+    std::mutex orderMutex;
+    auto step = [&](int n) {
+        return [&, n] {
+            std::lock_guard<std::mutex> lock(orderMutex);
+            order.push_back(n);
+        };
+    };
+    jobs::handle first = pool.submit("step", jobs::Priority::Low, [&, f = step(1)] {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        f();
+    });
+    jobs::handle second = pool.submit("step", jobs::Priority::High, step(2), {first});
+    jobs::handle third = pool.submit("step", jobs::Priority::High, step(3), {first, second});
+    third->wait();
+    EXPECT_EQ(order, std::vector<int>({1, 2, 3})) << "Jobs should run after their dependencies.";
+}
+
+TEST(jobstest, testcancel) {
+    jobs::Pool pool(1);
+    std::atomic<bool> release(false);
+    std::atomic<int> ran(0);
+    jobs::handle blocker = pool.submit("block", jobs::Priority::Normal, [&] {
+        while (!release.load()) std::this_thread::yield();
+    });
+    jobs::handle cancelled = pool.submit("cancelled", jobs::Priority::Normal, [&] {ran++;}, {blocker});
+    jobs::handle dependent = pool.submit("dependent", jobs::Priority::Normal, [&] {ran++;}, {cancelled});
+    cancelled->cancel();
+    release.store(true);
+    dependent->wait();
+    EXPECT_EQ(ran.load(), 0) << "A cancelled job and its dependents should not run.";
+    EXPECT_TRUE(dependent->isCancelled());
+}
+
+TEST(jobstest, testerror) {
+    jobs::Pool pool(1);
+    std::atomic<int> ran(0);
+    jobs::handle failing = pool.submit("failing", jobs::Priority::Normal, [] {
+        throw std::runtime_error("broken");
+    });
+    jobs::handle dependent = pool.submit("dependent", jobs::Priority::Normal, [&] {ran++;}, {failing});
+    EXPECT_THROW(failing->wait(), std::runtime_error) << "The error should reach the waiter.";
+    dependent->wait();
+    EXPECT_EQ(ran.load(), 0) << "Dependents of a failed job should not run.";
+    pool.submit("next", jobs::Priority::Normal, [&] {ran++;})->wait();
+    EXPECT_EQ(ran.load(), 1) << "The worker should survive the error.";
+}
+
+TEST(jobstest, testsnapshothandoff) {
+    metrics::Registry registry;
+    jobs::Pool pool(2);
+    pool.attachMetrics(registry);
+    World world;
+    node bridge(new Room("Bridge"));
+    node hangar(new Room("Hangar", bridge));
+    item key(new Object("Key"));
+    hangar->addItem(key);
+    world.addRoom(bridge).addRoom(hangar);
+    snapshot view = world.makeSnapshot();
+    std::size_t counted = 0;
+    jobs::handle h = pool.submit<std::size_t>("count_items", jobs::Priority::Normal, [view] {
+        std::size_t n = 0;
+        for (RoomView const& r : *view) n += r.items.size();
+        return n;
+    }, world.getMailbox(), [&](std::size_t& n) {counted = n;});
+    h->wait();
+    EXPECT_EQ(counted, 0) << "Results are handed over only at the safe point of the tick.";
+    world.tick();
+    EXPECT_EQ(counted, 1);
+    EXPECT_EQ((*view)[1].neighbours, std::vector<std::size_t>({0}));
+    EXPECT_EQ(registry.histogram("spacewalk_job_seconds{type=\"count_items\"}", {}).getCount(), 1);
+}
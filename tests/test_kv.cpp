@@ -0,0 +1,146 @@
+#include <gtest/gtest.h>
+#include <cstdlib>
+#include "kv.hpp"
+
+static std::string makeDir() {
+    char name[] = "test_kv_XXXXXX";
+    return mkdtemp(name);
+}
+
+static void removeDir(const std::string& dir) {
+    for (auto const& f : wal::list(dir, "sst-", ".sst")) unlink(f.second.c_str());
+    unlink((dir + "/kv.log").c_str());
+    rmdir(dir.c_str());
+}
+
+TEST(kvtest, testbatches) {
+    std::string dir = makeDir();
+    {
+        kv::Store store(dir);
+        kv::Batch b;
+        b.put("profile/Ripley", "hp=100").put("profile/Dallas", "hp=80");
+        store.write(b);
+        std::string value;
+        ASSERT_TRUE(store.get("profile/Ripley", value));
+        EXPECT_EQ(value, "hp=100");
+        kv::Batch e;
+        e.erase("profile/Dallas");
+        store.write(e);
+        EXPECT_FALSE(store.get("profile/Dallas", value)) << "An erased key should be gone.";
+        EXPECT_EQ(store.tableCount(), 0);
+    }
+    kv::Store reopened(dir);
+    std::string value;
+    ASSERT_TRUE(reopened.get("profile/Ripley", value)) << "The log should be replayed on open.";
+    EXPECT_EQ(value, "hp=100");
+    EXPECT_FALSE(reopened.get("profile/Dallas", value));
+    removeDir(dir);
+}
+
+TEST(kvtest, testtornrecord) {
+    std::string dir = makeDir();
+    {
+        kv::Store store(dir);
+        kv::Batch b;
+        b.put("profile/Ripley", "hp=100");
+        store.write(b);
+    }
+    int fd = open((dir + "/kv.log").c_str(), O_WRONLY | O_APPEND);
+    ASSERT_EQ(write(fd, "\x40\0\0\0torn", 8), 8);
+    close(fd);
+    {
+        kv::Store store(dir);
+        kv::Batch b;
+        b.put("profile/Dallas", "hp=80");
+        store.write(b);
+    }
+    kv::Store reopened(dir);
+    std::string value;
+    EXPECT_TRUE(reopened.get("profile/Ripley", value));
+    EXPECT_TRUE(reopened.get("profile/Dallas", value)) << "A torn record should not hide the batches after it.";
+    removeDir(dir);
+}
+
+TEST(kvtest, testtables) {
+    std::string dir = makeDir();
+    {
+        kv::Store store(dir, 1, 3);
+        for (int i = 0; i < 6; i++) {
+            kv::Batch b;
+            b.put("key" + std::to_string(i), "value" + std::to_string(i));
+            if (i == 4) b.erase("key1");
+            store.write(b);
+        }
+        EXPECT_LE(store.tableCount(), 3) << "Too many tables should be merged.";
+        std::string value;
+        ASSERT_TRUE(store.get("key0", value));
+        EXPECT_EQ(value, "value0");
+        EXPECT_FALSE(store.get("key1", value));
+        ASSERT_TRUE(store.get("key5", value));
+        EXPECT_EQ(value, "value5");
+    }
+    kv::Store reopened(dir, 1, 3);
+    std::string value;
+    ASSERT_TRUE(reopened.get("key3", value)) << "Tables should be read on open.";
+    EXPECT_EQ(value, "value3");
+    EXPECT_FALSE(reopened.get("key1", value));
+    removeDir(dir);
+}
+
+TEST(kvtest, testprofiles) {
+    std::string dir = makeDir();
+    {
+        kv::Store store(dir);
+        kv::Profiles profiles(store);
+        Entity ripley("Ripley", 90, 40);
+        item flare(new Object("Flare"));
+        item card(new Key("Keycard", "A7"));
+        ripley.addItem(flare).addItem(card);
+        profiles.save(ripley);
+        std::string value;
+        EXPECT_FALSE(store.get("profile/Ripley", value)) << "Saves should wait for the end of the tick.";
+        EXPECT_EQ(profiles.load("Ripley")->hp, 90) << "A pending save should be visible through the cache.";
+        EXPECT_EQ(profiles.endTick(), 1);
+        EXPECT_TRUE(store.get("profile/Ripley", value));
+    }
+    kv::Store store(dir);
+    kv::Profiles profiles(store);
+    EXPECT_EQ(profiles.load("Dallas"), nullptr);
+    const kv::Profile* p = profiles.load("Ripley");
+    ASSERT_NE(p, nullptr);
+    EXPECT_EQ(profiles.cached(), 1);
+    std::unique_ptr<Entity> e = p->toEntity();
+    EXPECT_EQ(e->getStamina(), 40);
+    ASSERT_EQ(e->getItems().size(), 2);
+    const Key* k = dynamic_cast<const Key*>(e->getItems()[1].get());
+    ASSERT_NE(k, nullptr) << "Keys should keep their id.";
+    EXPECT_EQ(k->getKeyID(), "A7");
+    profiles.offline("Ripley");
+    EXPECT_EQ(profiles.cached(), 0);
+    removeDir(dir);
+}
+
+TEST(kvtest, testdamagedtable) {
+    std::string dir = makeDir();
+    jobs::Pool pool(2);
+    {
+        kv::Store store(dir, 1 << 20, 4, &pool);
+        kv::Batch b;
+        for (int i = 0; i < 20000; i++) b.put("key" + std::to_string(i), "value" + std::to_string(i));
+        store.write(b);
+        store.flush();
+    }
+    {
+        kv::Store store(dir, 1 << 20, 4, &pool);
+        std::string value;
+        ASSERT_TRUE(store.get("key12345", value));
+        EXPECT_EQ(value, "value12345");
+    }
+    std::string path = wal::list(dir, "sst-", ".sst").back().second;
+    std::string data = wal::readFile(path);
+    int fd = open(path.c_str(), O_WRONLY);
+    ASSERT_EQ(pwrite(fd, "\xff", 1, data.size() / 2), 1);
+    close(fd);
+    EXPECT_THROW(kv::Store store(dir, 1 << 20, 4, &pool), std::runtime_error) << "A damaged section should be found.";
+    removeDir(dir);
+}
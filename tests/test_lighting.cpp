@@ -0,0 +1,72 @@
+#include <gtest/gtest.h>
+#include "lighting.hpp"
+
+static void makeCorridor(World& world, std::size_t n) {
+    nodes rooms;
+    for (std::size_t i = 0; i < n; i++) {
+        rooms.push_back(node(new Room("Deck" + std::to_string(i))));
+        if (i) rooms[i]->addNeighbour(rooms[i - 1]);
+        world.addRoom(rooms[i]);
+    }
+}
+
+TEST(lightingtest, testpropagation) {
+    World world;
+    makeCorridor(world, 5);
+    lighting::Lighting light(world, 64);
+    EXPECT_TRUE(light.setSource(*world.getRooms()[0], 255));
+    light.update();
+    EXPECT_EQ(light.getLevel(*world.getRooms()[0]), 255);
+    EXPECT_EQ(light.getLevel(1), 191) << "Light should reach rooms, that only link back.";
+    EXPECT_EQ(light.getLevel(2), 127);
+    EXPECT_EQ(light.getLevel(3), 63);
+    EXPECT_EQ(light.getLevel(4), 0);
+}
+
+TEST(lightingtest, testoutage) {
+    World world;
+    makeCorridor(world, 5);
+    lighting::Lighting light(world, 64);
+    light.setSource(0, 255);
+    light.setSource(4, 100);
+    light.update();
+    EXPECT_EQ(light.getLevel(3), 63);
+    light.setSource(0, 0);
+    light.update();
+    EXPECT_EQ(light.getLevel(0), 0) << "Rooms should not keep each other lit after an outage.";
+    EXPECT_EQ(light.getLevel(2), 0);
+    EXPECT_EQ(light.getLevel(3), 36);
+    EXPECT_EQ(light.getLevel(4), 100);
+}
+
+TEST(lightingtest, testincremental) {
+    World world;
+    makeCorridor(world, 1000);
+    lighting::Lighting light(world, 100);
+    EXPECT_EQ(light.update(), 0) << "Nothing should be recomputed without a change.";
+    light.setSource(500, 200);
+    std::size_t recomputed = light.update();
+    EXPECT_LT(recomputed, 20) << "Only rooms around the changed source should be recomputed.";
+    EXPECT_EQ(light.getLevel(501), 100);
+    EXPECT_EQ(light.pending(), 0);
+}
+
+TEST(lightingtest, testparallel) {
+    World world;
+    makeCorridor(world, 3000);
+    lighting::Lighting serial(world, 1, 16);
+    lighting::Lighting parallel(world, 1, 16);
+    jobs::Pool pool(2);
+    for (std::uint32_t r = 0; r < 3000; r += 700) {
+        serial.setSource(r, 255);
+        parallel.setSource(r, 255);
+    }
+    serial.update();
+    parallel.update(&pool);
+    for (std::uint32_t r = 0; r < 3000; r++) {
+        ASSERT_EQ(serial.getLevel(r), parallel.getLevel(r)) << "Room " << r;
+    }
+    parallel.setSource(700, 0);
+    parallel.update(&pool);
+    EXPECT_EQ(parallel.getLevel(700), 0) << "Room 700 is 700 steps from room 0 and 700 from room 1400.";
+}
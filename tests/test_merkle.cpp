@@ -0,0 +1,136 @@
+#include <gtest/gtest.h>
+#include "merkle.hpp"
+
+static void build(World& world, std::size_t n) {
+    for (std::size_t i = 0; i < n; i++) {
+        node r(new Room("Room" + std::to_string(i)));
+        item crate(new Object("Crate"));
+        r->addItem(crate);
+        world.addRoom(r);
+    }
+}
+
+TEST(merkletest, testdiff) {
+    World primary, replica;
+    build(primary, 100);
+    build(replica, 100);
+    merkle::Tree a(primary), b(replica);
+    EXPECT_EQ(a.update(), 100);
+    b.update();
+    EXPECT_EQ(a.root(), b.root()) << "Equal worlds should have equal roots.";
+    EXPECT_TRUE(a.diff(b).empty());
+    item key(new Key("Key", "Vault"));
+    primary.getRooms()[42]->addItem(key);
+    replica.getRooms()[7]->takeItems();
+    a.touch(*primary.getRooms()[42]);
+    EXPECT_EQ(a.update(), 1) << "Only the touched room should be hashed again.";
+    EXPECT_EQ(b.scan(), 1) << "A scan should find the changed room by its version.";
+    EXPECT_NE(a.root(), b.root());
+    merkle::Diff d = a.diff(b);
+    EXPECT_EQ(d.rooms, std::vector<std::size_t>({7, 42}));
+    EXPECT_TRUE(d.entities.empty());
+    EXPECT_EQ(a.scan(), 0) << "Nothing changed since the last update.";
+    node added(new Room("Annex"));
+    primary.addRoom(added);
+    EXPECT_EQ(a.update(), 1) << "Rooms added to the World should be hashed.";
+}
+
+TEST(merkletest, testentities) {
+    World primary, replica, hurt;
+    build(primary, 3);
+    build(replica, 3);
+    build(hurt, 3);
+    std::shared_ptr<Entity> ripley(new Entity("Ripley")), copy(new Entity("Ripley"));
+    primary.addEntity(ripley);
+    replica.addEntity(copy);
+    hurt.addEntity(std::make_shared<Entity>("Ripley", 60));
+    merkle::Tree a(primary), b(replica);
+    EXPECT_EQ(a.update(), 4) << "Entities of the World should be hashed.";
+    b.update();
+    EXPECT_EQ(a.root(), b.root());
+    item flare(new Object("Flare"));
+    copy->addItem(flare);
+    EXPECT_TRUE(b.touch(*copy));
+    EXPECT_FALSE(b.touch(*ripley));
+    b.update();
+    EXPECT_EQ(a.diff(b).entities, std::vector<std::size_t>({0}));
+    merkle::Tree c(hurt);
+    c.update();
+    EXPECT_NE(c.entityHash(0), a.entityHash(0)) << "Hit points should be part of the hash.";
+    World empty;
+    build(empty, 3);
+    merkle::Tree d(empty);
+    EXPECT_THROW(a.diff(d), std::invalid_argument);
+    primary.addEntity(std::make_shared<Entity>("Hicks"));
+    EXPECT_EQ(a.update(), 1) << "Entities added to the World should be hashed.";
+}
+
+TEST(merkletest, testfork) {
+    World primary;
+    build(primary, 3);
+    primary.addEntity(std::make_shared<Entity>("Ripley"));
+    std::unique_ptr<World> f = primary.fork();
+    merkle::Tree t(*f);
+    t.update();
+    item flare(new Object("Flare"));
+    Room& r = f->mutateRoom(1);
+    r.addItem(flare);
+    EXPECT_TRUE(t.touch(r)) << "The copy a fork made of a room should be found.";
+    item torch(new Object("Torch"));
+    Entity& e = f->mutateEntity(0);
+    e.addItem(torch);
+    EXPECT_TRUE(t.touch(e)) << "The copy a fork made of an entity should be found.";
+    EXPECT_EQ(t.update(), 2);
+    merkle::Tree u(*f);
+    u.update();
+    EXPECT_EQ(t.root(), u.root());
+}
+
+TEST(merkletest, testprefabs) {
+    std::shared_ptr<Prefab> cabin(new Prefab());
+    cabin->name = "Cabin";
+    cabin->layout.push_back({"Blanket", ""});
+    World lazy, stocked;
+    node l(new Room(cabin, 1));
+    node s(new Room(cabin, 1));
+    s->getItems();
+    lazy.addRoom(l);
+    stocked.addRoom(s);
+    merkle::Tree a(lazy), b(stocked);
+    a.update();
+    b.update();
+    EXPECT_EQ(a.root(), b.root()) << "Uncreated prefab items should hash like created ones.";
+    EXPECT_FALSE(l->isStocked()) << "Hashing should not create the items.";
+}
+
+TEST(merkletest, testgrowth) {
+    merkle::Hashes grown, built;
+    built.resize(1025);
+    for (std::size_t i = 0; i < 1025; i++) {
+        grown.resize(i + 1);
+        grown.set(i, i * 31 + 7);
+        built.set(i, i * 31 + 7);
+        std::size_t recomputed = grown.propagate();
+        if (i == 999) {
+            EXPECT_EQ(recomputed, 10) << "Appending a leaf should only hash its path.";
+        }
+    }
+    built.propagate();
+    EXPECT_EQ(grown.getCapacity(), 2048);
+    EXPECT_EQ(grown.root(), built.root()) << "Growing should hash like building at the final size.";
+    World primary, replica;
+    build(primary, 5);
+    build(replica, 40);
+    merkle::Tree a(primary), b(replica);
+    a.update();
+    for (std::size_t i = 5; i < 40; i++) {
+        node r(new Room("Room" + std::to_string(i)));
+        item crate(new Object("Crate"));
+        r->addItem(crate);
+        primary.addRoom(r);
+        EXPECT_EQ(a.update(), 1);
+    }
+    b.update();
+    EXPECT_EQ(a.root(), b.root());
+    EXPECT_TRUE(a.diff(b).empty());
+}
@@ -0,0 +1,101 @@
+#include <gtest/gtest.h>
+#include <chrono>
+#include <thread>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "engine.hpp"
+
+TEST(metricstest, testcounterandgauge) {
+    metrics::Registry registry;
+    registry.counter("spacewalk_test_total", "A test counter.").inc(3);
+    registry.gauge("spacewalk_test_memory{subsystem=\"a\"}", "A test gauge.").set(5);
+    registry.gauge("spacewalk_test_memory{subsystem=\"b\"}", "A test gauge.").set(7);
+    EXPECT_EQ(&registry.counter("spacewalk_test_total"), &registry.counter("spacewalk_test_total")) << "The same name should return the same counter.";
+    std::string text = registry.render();
+    EXPECT_NE(text.find("# TYPE spacewalk_test_total counter\nspacewalk_test_total 3\n"), std::string::npos) << text;
+    EXPECT_EQ(text.find("# TYPE spacewalk_test_memory gauge"), text.rfind("# TYPE spacewalk_test_memory gauge")) << "Labelled gauges should share one TYPE line.";
+    EXPECT_NE(text.find("spacewalk_test_memory{subsystem=\"b\"} 7\n"), std::string::npos) << text;
+}
+
+TEST(metricstest, testfamilygrouping) {
+    metrics::Registry registry;
+    registry.gauge("spacewalk_x", "Plain.").set(1);
+    registry.counter("spacewalk_x_total", "Sorts in between.").inc();
+    registry.gauge("spacewalk_x{shard=\"1\"}", "Plain.").set(2);
+    std::string text = registry.render();
+    EXPECT_EQ(text.find("# TYPE spacewalk_x gauge"), text.rfind("# TYPE spacewalk_x gauge")) << text;
+    EXPECT_NE(text.find("# TYPE spacewalk_x gauge\nspacewalk_x 1\nspacewalk_x{shard=\"1\"} 2\n"), std::string::npos) << text;
+}
+
+TEST(metricstest, testhistogram) {
+    metrics::Histogram h({1, 2, 4});
+    for (int i = 0; i < 50; i++) h.observe(0.5);
+    for (int i = 0; i < 49; i++) h.observe(3);
+    h.observe(10);
+    EXPECT_EQ(h.getCount(), 100);
+    EXPECT_LE(h.quantile(0.5), 1.0) << "Half of the observations are in the first bucket.";
+    EXPECT_GT(h.quantile(0.99), 2.0);
+    metrics::Registry registry;
+    registry.histogram("spacewalk_test_seconds", {1, 2}).observe(1.5);
+    std::string text = registry.render();
+    EXPECT_NE(text.find("spacewalk_test_seconds_bucket{le=\"1\"} 0\n"), std::string::npos) << text;
+    EXPECT_NE(text.find("spacewalk_test_seconds_bucket{le=\"2\"} 1\n"), std::string::npos) << text;
+    EXPECT_NE(text.find("spacewalk_test_seconds_count 1\n"), std::string::npos) << text;
+}
+
+TEST(metricstest, testworldmetrics) {
+    metrics::Registry registry;
+    World world;
+    node room(new Room("Bridge"));
+    item key(new Object("Key"));
+    room->addItem(key);
+    world.addRoom(room).attachMetrics(registry, 1);
+    world.addEntity(std::make_shared<Entity>("Ripley"));
+    world.tick();
+    EXPECT_EQ(registry.gauge("spacewalk_rooms").get(), 1);
+    EXPECT_EQ(registry.gauge("spacewalk_entities").get(), 1);
+    EXPECT_EQ(registry.gauge("spacewalk_items").get(), 1);
+    EXPECT_EQ(registry.counter("spacewalk_ticks_total").get(), 1);
+}
+
+TEST(metricstest, testserver) {
+    metrics::Registry registry;
+    registry.counter("spacewalk_test_total").inc();
+    metrics::Server server(registry);
+    ASSERT_TRUE(server.start());
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(server.getPort());
+    ASSERT_EQ(connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)), 0);
+    const std::string request = "GET /metrics HTTP/1.0\r\n\r\n";
+    send(fd, request.data(), request.size(), 0);
+    std::string response;
+    char buffer[512];
+    for (ssize_t n; (n = recv(fd, buffer, sizeof(buffer), 0)) > 0;) response.append(buffer, n);
+    close(fd);
+    server.stop();
+    EXPECT_EQ(response.find("HTTP/1.0 200 OK"), 0) << response;
+    EXPECT_NE(response.find("spacewalk_test_total 1"), std::string::npos) << response;
+}
+
+TEST(metricstest, testsilentclient) {
+    metrics::Registry registry;
+    metrics::Server server(registry, std::chrono::milliseconds(50));
+    ASSERT_TRUE(server.start());
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(server.getPort());
+    ASSERT_EQ(connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)), 0);
+    std::this_thread::sleep_for(std::chrono::milliseconds(20)); // Let the server accept it.
+    auto start = std::chrono::steady_clock::now();
+    server.stop();
+    EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds(5))
+        << "A client, that sends nothing, should not hang stop().";
+    close(fd);
+}
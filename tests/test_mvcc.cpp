@@ -0,0 +1,87 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <thread>
+#include "mvcc.hpp"
+
+TEST(mvcctest, teststablereader) {
+    mvcc::Epochs epochs;
+    node room(new Room("Armory"));
+    item rifle(new Object("Rifle"));
+    item pistol(new Object("Pistol"));
+    room->addItem(rifle).addItem(pistol);
+    mvcc::Inventory loot(room->takeItems(), epochs);
+    EXPECT_TRUE(room->getItems().empty()) << "The items should move into the versioned inventory.";
+    {
+        mvcc::Inventory::Reader before(loot);
+        item taken = loot.take("Rifle");
+        ASSERT_NE(taken, nullptr);
+        EXPECT_EQ(taken->getName(), "Rifle");
+        EXPECT_EQ(before.getItems().size(), 2) << "A reader should keep seeing its version.";
+        mvcc::Inventory::Reader after(loot);
+        EXPECT_EQ(after.getItems().size(), 1);
+        EXPECT_EQ(after.getVersion(), before.getVersion() + 1);
+        EXPECT_EQ(loot.take("Rifle"), nullptr) << "An item can only be taken once.";
+    }
+    items back;
+    loot.drainInto(back);
+    room->addItems(back);
+    EXPECT_EQ(room->getItems().size(), 1);
+}
+
+TEST(mvcctest, testcollect) {
+    mvcc::Epochs epochs;
+    mvcc::Inventory loot(epochs);
+    item crate(new Object("Crate"));
+    loot.add(crate);
+    {
+        mvcc::Inventory::Reader reader(loot);
+        item taken = loot.take("Crate");
+        EXPECT_EQ(loot.collect(), 2) << "Versions should not be freed while a reader may see them.";
+    }
+    for (int i = 0; i < 3; i++) loot.collect();
+    EXPECT_EQ(loot.collect(), 0) << "Without readers the old versions should be freed.";
+}
+
+TEST(mvcctest, testtakeanddrop) {
+    mvcc::Epochs epochs;
+    mvcc::Inventory loot(epochs);
+    item key(new Key("Keycard", "Vault"));
+    loot.add(key);
+    mvcc::Inventory::Reader reader(loot);
+    {
+        item taken = loot.take("Keycard");
+        const Key* k = dynamic_cast<const Key*>(taken.get());
+        ASSERT_NE(k, nullptr) << "A taken Key should stay a Key.";
+        EXPECT_EQ(k->getKeyID(), "Vault");
+    }
+    ASSERT_EQ(reader.getItems().size(), 1);
+    EXPECT_EQ(reader.getItems()[0]->getName(), "Keycard") << "Dropping the taken item should not free the old version's.";
+}
+
+TEST(mvcctest, testlootingcontest) {
+    mvcc::Epochs epochs;
+    mvcc::Inventory loot(epochs);
+    for (int i = 0; i < 1000; i++) {
+        item coin(new Object("Coin"));
+        loot.add(coin);
+    }
+    std::atomic<int> taken(0);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; t++) {
+        threads.push_back(std::thread([&] {
+            items mine;
+            while (true) {
+                {
+                    mvcc::Inventory::Reader r(loot);
+                    if (r.getItems().empty()) break;
+                }
+                item coin = loot.take("Coin");
+                if (coin) mine.push_back(std::move(coin));
+            }
+            taken += mine.size();
+        }));
+    }
+    for (auto& t : threads) t.join();
+    EXPECT_EQ(taken.load(), 1000) << "Every coin should be taken exactly once.";
+    while (loot.collect()) {}
+}
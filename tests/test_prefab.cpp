@@ -0,0 +1,56 @@
+#include <gtest/gtest.h>
+#include "txn.hpp"
+
+static prefab makeCabin() {
+    std::shared_ptr<Prefab> p(new Prefab());
+    p->name = "Cabin";
+    p->description = "A narrow bunk and a locker.";
+    p->layout.push_back({"Blanket", ""});
+    p->layout.push_back({"Locker key", "Locker"});
+    return p;
+}
+
+TEST(prefabtest, testshareddata) {
+    prefab cabin = makeCabin();
+    node a(new Room(cabin, 1));
+    node b(new Room(cabin, 2));
+    EXPECT_EQ(a->getName(), "Cabin 1");
+    EXPECT_EQ(b->getName(), "Cabin 2");
+    EXPECT_EQ(&a->getDescription(), &b->getDescription()) << "Instances should share the description.";
+    EXPECT_EQ(cabin.use_count(), 3);
+    b->setName("Captain's cabin").setDescription("A wide bunk.");
+    EXPECT_EQ(b->getName(), "Captain's cabin");
+    EXPECT_EQ(b->getDescription(), "A wide bunk.");
+    EXPECT_EQ(a->getDescription(), "A narrow bunk and a locker.") << "Overrides should only change their instance.";
+}
+
+TEST(prefabtest, testlazyitems) {
+    prefab cabin = makeCabin();
+    node a(new Room(cabin, 1));
+    EXPECT_FALSE(a->isStocked());
+    EXPECT_EQ(a->countItems(), 2);
+    World world;
+    world.addRoom(a);
+    snapshot s = world.makeSnapshot();
+    EXPECT_EQ((*s)[0].items, std::vector<std::string>({"Blanket", "Locker key"}));
+    EXPECT_EQ((*s)[0].keys, 1);
+    EXPECT_FALSE(a->isStocked()) << "A snapshot should not create the items.";
+    item flare(new Object("Flare"));
+    a->addItem(flare);
+    EXPECT_TRUE(a->isStocked());
+    ASSERT_EQ(a->getItems().size(), 3);
+    EXPECT_EQ(a->getItems()[0]->getName(), "Blanket");
+    EXPECT_NE(dynamic_cast<const Key*>(a->getItems()[1].get()), nullptr);
+    EXPECT_EQ(a->getItems()[2]->getName(), "Flare");
+}
+
+TEST(prefabtest, testtransaction) {
+    prefab cabin = makeCabin();
+    node a(new Room(cabin, 1));
+    Entity ripley("Ripley");
+    txn::Transaction t;
+    t.move(*a, "Blanket", ripley);
+    EXPECT_EQ(t.commit(), txn::Result::Committed) << "Transactions should see the layout items.";
+    EXPECT_EQ(ripley.getItems().size(), 1);
+    EXPECT_EQ(a->countItems(), 1);
+}
@@ -0,0 +1,95 @@
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include "engine.hpp"
+
+TEST(profilertest, testnestedzones) {
+    profiler::FrameProfiler p;
+    p.beginTick(7);
+    {
+        PROFILE_ZONE(p, "outer");
+        PROFILE_ZONE(p, "inner");
+    }
+    p.endTick();
+    std::vector<profiler::Zone> zones = p.collect(p.slowestTick());
+    ASSERT_EQ(zones.size(), 2) << "Both zones should be collected for the tick.";
+    EXPECT_STREQ(zones[0].name, "outer");
+    EXPECT_EQ(zones[0].depth, 0);
+    EXPECT_STREQ(zones[1].name, "inner");
+    EXPECT_EQ(zones[1].depth, 1);
+    std::ostringstream folded;
+    p.dump(folded, p.slowestTick(), profiler::DumpFormat::Folded);
+    EXPECT_NE(folded.str().find("tick_7;thread_0;outer;inner "), std::string::npos) << folded.str();
+}
+
+TEST(profilertest, testworldphases) {
+    World world;
+    world.addSystem(Phase::Combat, [](World&) {}).addSystem(Phase::Movement, [](World&) {});
+    world.tick();
+    world.tick();
+    EXPECT_EQ(world.getTickCount(), 2);
+    std::vector<profiler::TickRecord> history = world.getProfiler().getHistory();
+    ASSERT_EQ(history.size(), 2) << "The last two ticks should be kept.";
+    std::vector<profiler::Zone> zones = world.getProfiler().collect(history[1]);
+    ASSERT_EQ(zones.size(), 4) << "tick, movement, combat and completions zones are expected.";
+    EXPECT_STREQ(zones[0].name, "tick");
+    EXPECT_STREQ(zones[1].name, "movement");
+    EXPECT_STREQ(zones[2].name, "combat");
+    EXPECT_STREQ(zones[3].name, "completions");
+}
+
+TEST(profilertest, testhistorylimit) {
+    profiler::FrameProfiler p(4);
+    for (unsigned long t = 0; t < 10; t++) {
+        p.beginTick(t);
+        p.endTick();
+    }
+    std::vector<profiler::TickRecord> history = p.getHistory();
+    ASSERT_EQ(history.size(), 4);
+    EXPECT_EQ(history.front().tick, 6);
+    EXPECT_EQ(history.back().tick, 9);
+}
+
+TEST(profilertest, testthresholddump) {
+    const std::string path = "test_profiler_dump.json";
+    std::remove(path.c_str());
+    World world;
+    world.getProfiler().setDump(1000000, path, profiler::DumpFormat::ChromeTrace);
+    world.addSystem(Phase::Diffusion, [](World&) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    });
+    world.tick();
+    std::ifstream in(path);
+    ASSERT_TRUE(in.good()) << "A tick over the threshold should be dumped.";
+    std::stringstream content;
+    content << in.rdbuf();
+    EXPECT_NE(content.str().find("\"name\":\"diffusion\""), std::string::npos) << content.str();
+}
+
+TEST(profilertest, testdisabled) {
+    profiler::FrameProfiler p;
+    p.setEnabled(false);
+    p.beginTick(0);
+    {
+        PROFILE_ZONE(p, "zone");
+    }
+    p.endTick();
+    EXPECT_TRUE(p.getHistory().empty()) << "A disabled profiler should not record ticks.";
+}
+
+TEST(profilertest, testringcapacity) {
+    profiler::FrameProfiler p(4, 16);
+    p.beginTick(0);
+    for (int i = 0; i < 40; i++) {
+        PROFILE_ZONE(p, "zone");
+    }
+    p.endTick();
+    EXPECT_EQ(p.collect(p.slowestTick()).size(), 16) << "A small ring should keep only its newest zones.";
+    for (int i = 0; i < 100; i++) {
+        profiler::FrameProfiler shortLived(1, 1);
+        PROFILE_ZONE(shortLived, "zone");
+    }
+    EXPECT_FALSE(profiler::FrameProfiler(1, 1, false).isEnabled());
+}
@@ -0,0 +1,51 @@
+#include <gtest/gtest.h>
+#include "query.hpp"
+
+class QueryTest : public ::testing::Test {
+protected:
+    query::Store store;
+    /* Bridge - Corridor - Armory - Hangar in a line, Armory holds 4 keys, Hangar 5 keys. */
+    void SetUp() override {
+        World world;
+        nodes line({node(new Room("Bridge")), node(new Room("Corridor")), node(new Room("Armory")), node(new Room("Hangar"))});
+        for (std::size_t i = 0; i < line.size(); i++) {
+            if (i) line[i]->addNeighbour(line[i - 1]);
+            if (i + 1 < line.size()) line[i]->addNeighbour(line[i + 1]);
+            world.addRoom(line[i]);
+        }
+        for (int k = 0; k < 9; k++) {
+            item key(new Key("Key", "Vault"));
+            line[k < 4 ? 2 : 3]->addItem(key);
+        }
+        item crate(new Object("Crate"));
+        line[0]->addItem(crate);
+        store = query::Store(world.makeSnapshot());
+    }
+};
+
+TEST_F(QueryTest, testcompare) {
+    query::Result r = query::run("rooms where keys > 3", store);
+    EXPECT_EQ(r.rooms, std::vector<std::uint32_t>({2, 3}));
+    EXPECT_EQ(query::run("count rooms where items = 1", store).count, 1);
+    EXPECT_EQ(query::run("count rooms where neighbours >= 2", store).count, 2);
+    EXPECT_EQ(query::run("count rooms", store).count, 4);
+}
+
+TEST_F(QueryTest, testhops) {
+    query::Result r = query::run("rooms where keys > 3 and within 2 of \"Bridge\"", store);
+    EXPECT_EQ(r.rooms, std::vector<std::uint32_t>({2})) << "Hangar is 3 hops from the Bridge.";
+    EXPECT_EQ(query::run("count rooms where within 5 of \"Bridge\" and keys > 3", store).count, 2);
+    EXPECT_EQ(query::run("count rooms where within 1 of \"Nowhere\"", store).count, 0);
+    EXPECT_EQ(query::run("rooms where name = \"Hangar\"", store).rooms, std::vector<std::uint32_t>({3}));
+}
+
+TEST_F(QueryTest, testerrors) {
+    EXPECT_THROW(query::run("rooms where", store), std::invalid_argument);
+    EXPECT_THROW(query::run("rooms where colour > 3", store), std::invalid_argument);
+    EXPECT_THROW(query::run("rooms where keys ~ 3", store), std::invalid_argument);
+    EXPECT_THROW(query::run("rooms where keys > 3 or items > 1", store), std::invalid_argument);
+    EXPECT_THROW(query::run("entities", store), std::invalid_argument);
+    EXPECT_THROW(query::run("rooms where items > 99999999999999999999", store), std::invalid_argument) << "Too large for the parser.";
+    EXPECT_THROW(query::run("rooms where within 4294967296 of \"Hall\"", store), std::invalid_argument);
+    EXPECT_THROW(query::run("rooms where within -1 of \"Hall\"", store), std::invalid_argument);
+}
@@ -0,0 +1,133 @@
+#include <gtest/gtest.h>
+#include <chrono>
+#include <thread>
+#include "replica.hpp"
+
+static void build(World& world) {
+    for (const char* name : {"Bridge", "Galley", "Hold"}) {
+        node r(new Room(name));
+        world.addRoom(r);
+    }
+}
+
+static std::vector<std::string> names(const node& r) {
+    std::vector<std::string> n;
+    for (item const& i : r->getItems()) n.push_back(i->getName());
+    return n;
+}
+
+TEST(replicatest, teststream) {
+    const std::string path = "test_replica.sock";
+    World primaryWorld, standbyWorld;
+    build(primaryWorld);
+    build(standbyWorld);
+    item crate(new Object("Crate"));
+    primaryWorld.getRooms()[2]->addItem(crate);
+    metrics::Registry registry;
+    replica::Primary primary(primaryWorld, path);
+    primary.attachMetrics(registry);
+    replica::Standby standby(standbyWorld, path);
+    EXPECT_EQ(primary.flush(), 1);
+    EXPECT_EQ(standby.poll(), 4) << "A new standby should get a Clear per room and the items.";
+    EXPECT_EQ(names(standbyWorld.getRooms()[2]), std::vector<std::string>({"Crate"}));
+    primary.publish({wal::Op::Add, wal::roomKey("Bridge"), "Key"});
+    primary.publish({wal::Op::Add, wal::roomKey("Bridge"), "Map"});
+    primary.publish({wal::Op::Remove, wal::roomKey("Bridge"), "Key"});
+    primary.publish({wal::Op::Add, wal::entityKey("Ripley"), "Flare"});
+    EXPECT_EQ(standby.poll(), 0) << "Nothing should be sent before the end of the tick.";
+    primary.flush();
+    EXPECT_EQ(standby.poll(), 4);
+    EXPECT_EQ(standby.getApplied(), 4);
+    EXPECT_EQ(names(standbyWorld.getRooms()[0]), std::vector<std::string>({"Map"}));
+    ASSERT_EQ(standby.getEntities().at(wal::entityKey("Ripley")).size(), 1);
+    EXPECT_EQ(standby.getEntities().at(wal::entityKey("Ripley"))[0].name, "Flare");
+    EXPECT_EQ(primary.getAcked(), 0);
+    primary.flush();
+    EXPECT_EQ(primary.getAcked(), 4) << "The acknowledgement should arrive with the next flush.";
+    EXPECT_NE(registry.render().find("spacewalk_replication_mutations_total 4"), std::string::npos);
+}
+
+TEST(replicatest, testtakeover) {
+    const std::string path = "test_replica_takeover.sock";
+    World primaryWorld, standbyWorld;
+    build(primaryWorld);
+    build(standbyWorld);
+    std::unique_ptr<replica::Primary> primary(new replica::Primary(primaryWorld, path));
+    replica::Standby standby(standbyWorld, path);
+    primary->flush();
+    primary->publish({wal::Op::Add, wal::roomKey("Galley"), "Knife"});
+    primary->flush();
+    primary.reset();
+    standby.poll();
+    EXPECT_FALSE(standby.isConnected()) << "A closed primary should be noticed at the next poll.";
+    EXPECT_EQ(names(standbyWorld.getRooms()[1]), std::vector<std::string>({"Knife"})) << "The last tick should survive.";
+    EXPECT_THROW(replica::Standby late(standbyWorld, path), std::runtime_error);
+}
+
+TEST(replicatest, testconnectaftertherecords) {
+    const std::string path = "test_replica_late.sock";
+    World primaryWorld, standbyWorld;
+    build(primaryWorld);
+    build(standbyWorld);
+    replica::Primary primary(primaryWorld, path);
+    item map(new Object("Map"));
+    primaryWorld.getRooms()[0]->addItem(map);
+    primary.publish({wal::Op::Add, wal::roomKey("Bridge"), "Map"});
+    replica::Standby standby(standbyWorld, path);
+    primary.flush();
+    standby.poll();
+    EXPECT_EQ(names(standbyWorld.getRooms()[0]), std::vector<std::string>({"Map"}))
+        << "The catch-up already holds the records of the tick, they should not be applied twice.";
+    EXPECT_EQ(standby.getApplied(), 1);
+    primary.flush();
+    EXPECT_EQ(primary.getAcked(), 1);
+}
+
+TEST(replicatest, testcatchupkeysandentities) {
+    const std::string path = "test_replica_entities.sock";
+    World primaryWorld, standbyWorld;
+    build(primaryWorld);
+    build(standbyWorld);
+    std::shared_ptr<Entity> ripley = std::make_shared<Entity>("Ripley", 60, 30);
+    item card(new Key("Keycard", "A7"));
+    ripley->addItem(card);
+    primaryWorld.addEntity(ripley);
+    std::shared_ptr<Entity> copy = std::make_shared<Entity>("Ripley");
+    standbyWorld.addEntity(copy);
+    item key(new Key("Key", "Vault"));
+    primaryWorld.getRooms()[1]->addItem(key);
+    replica::Primary primary(primaryWorld, path);
+    replica::Standby standby(standbyWorld, path);
+    primary.flush();
+    standby.poll();
+    const Key* k = dynamic_cast<const Key*>(standbyWorld.getRooms()[1]->getItems().at(0).get());
+    ASSERT_NE(k, nullptr) << "Keys should keep their id in the catch-up.";
+    EXPECT_EQ(k->getKeyID(), "Vault");
+    EXPECT_EQ(copy->getHp(), 60);
+    EXPECT_EQ(copy->getStamina(), 30);
+    ASSERT_EQ(copy->getItems().size(), 1) << "The inventories of entities should be caught up.";
+    EXPECT_EQ(dynamic_cast<const Key*>(copy->getItems()[0].get())->getKeyID(), "A7");
+    primary.publish({wal::Op::Remove, wal::entityKey("Ripley"), "Keycard"});
+    primary.flush();
+    EXPECT_EQ(standby.poll(), 1);
+    EXPECT_TRUE(copy->getItems().empty());
+}
+
+TEST(replicatest, testhungprimary) {
+    const std::string path = "test_replica_hung.sock";
+    World primaryWorld, standbyWorld;
+    build(primaryWorld);
+    build(standbyWorld);
+    replica::Primary primary(primaryWorld, path);
+    replica::Standby standby(standbyWorld, path, 50000000);
+    for (int i = 0; i < 3; i++) {
+        primary.flush();
+        standby.poll();
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    }
+    standby.poll();
+    EXPECT_TRUE(standby.isConnected()) << "Heartbeats should keep an idle primary alive.";
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    standby.poll();
+    EXPECT_FALSE(standby.isConnected()) << "A primary, that stopped flushing, should be noticed.";
+}
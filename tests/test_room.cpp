@@ -1,13 +1,13 @@
 #include <gtest/gtest.h>
 #include "engine.hpp"
 
-class RoomTest : public ::testing:Test {
+class RoomTest : public ::testing::Test {
+protected:
     items shared_testItems_;
     nodes shared_testRooms_;
-protected:
-    void setUp() override {
+    void SetUp() override {
         for (int i = 0; i < 10; i++) {
-            shared_testItem_.push_back()
+            shared_testItems_.push_back(item(new Object("TestItem" + std::to_string(i))));
         }
     }
 };
@@ -72,7 +72,7 @@ TEST(roomtest, testconstructor5) {
     for (nodes::const_iterator cit = rooms.cbegin(); cit != rooms.cend(); cit++) {
         EXPECT_EQ(cit->use_count(), 2);
     }
-    for (int i = 0; i < rooms.size(); i++) {
+    for (std::size_t i = 0; i < rooms.size(); i++) {
         rooms[0].reset();
     }
 }
@@ -0,0 +1,70 @@
+#include <gtest/gtest.h>
+#include <string>
+#include "session.hpp"
+
+static std::string join(const session::Text* t) {
+    std::string s;
+    for (; t; t = t->next) s.append(t->data, t->length);
+    return s;
+}
+
+TEST(sessiontest, testopenclose) {
+    session::Manager sessions;
+    Entity player("Ripley");
+    node bridge(new Room("Bridge"));
+    session::id a = sessions.open(&player, bridge);
+    session::id b = sessions.open(&player, bridge);
+    EXPECT_NE(a, b);
+    EXPECT_EQ(sessions.size(), 2);
+    ASSERT_NE(sessions.get(a), nullptr);
+    EXPECT_EQ(sessions.get(a)->getEntity(), &player);
+    EXPECT_EQ(sessions.get(a)->getRoom(), bridge);
+    EXPECT_TRUE(sessions.close(a));
+    EXPECT_FALSE(sessions.close(a));
+    EXPECT_EQ(sessions.get(a), nullptr);
+    session::id c = sessions.open(&player, bridge);
+    EXPECT_EQ(c & 0xFFFFFFFF, a & 0xFFFFFFFF) << "The freed slot should be reused.";
+    EXPECT_EQ(sessions.get(a), nullptr) << "An old id should not find the new session.";
+    EXPECT_NE(sessions.get(c), nullptr);
+    EXPECT_EQ(sessions.size(), 2);
+}
+
+TEST(sessiontest, testtransientstate) {
+    session::Manager sessions(256);
+    Entity player("Ripley");
+    node bridge(new Room("Bridge"));
+    session::Session& s = *sessions.get(sessions.open(&player, bridge));
+    s.pushCommand("look", 4);
+    s.pushCommand("go north", 8);
+    s.send("You see ", 8);
+    s.send("a hatch.", 8);
+    EXPECT_EQ(s.getCommandCount(), 2);
+    EXPECT_EQ(join(s.getCommands()), "lookgo north");
+    EXPECT_EQ(join(s.getOutbound()), "You see a hatch.");
+    EXPECT_EQ(s.getOutboundBytes(), 16);
+    sessions.endTick();
+    EXPECT_EQ(s.getCommands(), nullptr);
+    EXPECT_EQ(s.getOutboundBytes(), 0);
+    std::size_t capacity = s.capacity();
+    for (int tick = 0; tick < 100; tick++) {
+        s.pushCommand("look", 4);
+        s.send("You see a hatch.", 16);
+        sessions.endTick();
+    }
+    EXPECT_EQ(s.capacity(), capacity) << "Reset arenas should not grow.";
+}
+
+TEST(sessiontest, testforeach) {
+    session::Manager sessions;
+    Entity player("Ripley");
+    node bridge(new Room("Bridge"));
+    std::vector<session::id> ids;
+    for (int i = 0; i < 10; i++) ids.push_back(sessions.open(&player, bridge));
+    for (int i = 0; i < 10; i += 3) sessions.close(ids[i]);
+    std::size_t seen = 0;
+    sessions.forEach([&](session::Session& s) {
+        EXPECT_NE(sessions.get(s.getID()), nullptr);
+        seen++;
+    });
+    EXPECT_EQ(seen, 6);
+}
@@ -0,0 +1,102 @@
+#include <gtest/gtest.h>
+#include "sim.hpp"
+
+static void makeStation(World& world, std::size_t n) {
+    nodes rooms;
+    for (std::size_t i = 0; i < n; i++) {
+        rooms.push_back(node(new Room("Deck" + std::to_string(i))));
+        if (i) {
+            rooms[i]->addNeighbour(rooms[i - 1]);
+            rooms[i - 1]->addNeighbour(rooms[i]);
+        }
+        world.addRoom(rooms[i]);
+    }
+    item suit(new Object("Spacesuit"));
+    rooms[0]->addItem(suit);
+}
+
+/* Entities in a room with a Breach lose 40 hit points per tick. */
+static void addBreaches(World& world, std::vector<std::size_t> location) {
+    world.addSystem(Phase::Combat, [location](World& w) {
+        for (std::size_t e = 0; e < w.getEntities().size(); e++) {
+            int hp = w.getEntities()[e]->getHp();
+            if (hp <= 0) continue;
+            for (item const& i : w.getRooms()[location[e]]->getItems()) {
+                if (i->getName() != "Breach") continue;
+                w.mutateEntity(e).setHp(hp - 40);
+                break;
+            }
+        }
+    });
+}
+
+static void breach(World& w, std::size_t room) {
+    item hole(new Object("Breach"));
+    w.mutateRoom(room).addItem(hole);
+}
+
+TEST(simtest, testcopyonwrite) {
+    cow::Chunked<int, 4> a;
+    for (int i = 0; i < 10; i++) a.push_back(i);
+    cow::Chunked<int, 4> b = a;
+    EXPECT_EQ(b.owned(), 0) << "A copy should share every chunk.";
+    b.mutate(5) = 50;
+    EXPECT_EQ(b[5], 50);
+    EXPECT_EQ(a[5], 5) << "Writing to a copy should not change the original.";
+    EXPECT_EQ(b.owned(), 1) << "Only the written chunk should be copied.";
+    EXPECT_EQ(b[6], 6);
+    int sum = 0;
+    for (int v : b) sum += v;
+    EXPECT_EQ(sum, 90);
+}
+
+TEST(simtest, testfork) {
+    World world;
+    makeStation(world, 1000);
+    world.addEntity(std::make_shared<Entity>("Ripley"));
+    world.addEntity(std::make_shared<Entity>("Dallas", 30));
+    addBreaches(world, {490, 501});
+
+    std::unique_ptr<World> f = sim::simulate(world, 10, [](World& w) {breach(w, 501);});
+    EXPECT_LE(f->getEntities()[1]->getHp(), 0) << "Dallas should not survive the breach.";
+    EXPECT_EQ(f->getEntities()[0]->getHp(), 100);
+    EXPECT_EQ(f->getTickCount(), 10);
+    EXPECT_TRUE(f->isFork());
+    EXPECT_EQ(world.getTickCount(), 0);
+    EXPECT_EQ(world.getEntities()[1]->getHp(), 30) << "The live World should not see the simulation.";
+    EXPECT_TRUE(world.getRooms()[501]->getItems().empty());
+    EXPECT_EQ(f->getRooms()[500].get(), world.getRooms()[500].get()) << "Untouched rooms should be shared.";
+    EXPECT_NE(f->getRooms()[501].get(), world.getRooms()[501].get());
+    EXPECT_EQ(f->getRooms().owned(), 1) << "Only the chunk of the breach should be copied.";
+    EXPECT_EQ(f->getEntities()[0].get(), world.getEntities()[0].get());
+    EXPECT_EQ(f->resolve(world.getRooms()[500]->getNeighbours()[1]).get(), f->getRooms()[501].get())
+        << "Neighbours should lead to the copy of the fork.";
+    EXPECT_EQ(world.resolve(world.getRooms()[501]).get(), world.getRooms()[501].get());
+}
+
+TEST(simtest, testforkofafork) {
+    World world;
+    makeStation(world, 3);
+    std::unique_ptr<World> first = world.fork();
+    breach(*first, 1);
+    std::unique_ptr<World> second = first->fork();
+    breach(*first, 1);
+    EXPECT_EQ(first->getRooms()[1]->getItems().size(), 2);
+    EXPECT_EQ(second->getRooms()[1]->getItems().size(), 1) << "A fork should not see later writes of its origin.";
+    breach(*second, 2);
+    EXPECT_TRUE(first->getRooms()[2]->getItems().empty());
+    EXPECT_EQ(second->resolve(world.getRooms()[0]->getNeighbours()[0]).get(), second->getRooms()[1].get());
+    EXPECT_TRUE(world.getRooms()[1]->getItems().empty());
+}
+
+TEST(simtest, testsystems) {
+    World world;
+    makeStation(world, 3);
+    world.addSystem(Phase::Diffusion, "flares", load::Priority::Low, 1, [](World& w) {
+        item flare(new Object("Flare"));
+        w.mutateRoom(1).addItem(flare);
+    });
+    std::unique_ptr<World> f = sim::simulate(world, 2);
+    EXPECT_EQ(f->getRooms()[1]->getItems().size(), 2) << "The registered systems should run on the fork.";
+    EXPECT_EQ(world.getRooms()[1]->getItems().size(), 0) << "The live World should never change.";
+}
@@ -0,0 +1,49 @@
+#include <gtest/gtest.h>
+#include <thread>
+#include "engine.hpp"
+
+TEST(statstest, testmerge) {
+    stats::Accumulator a;
+    a.add(2);
+    a.add(3);
+    EXPECT_EQ(a.get(), 0) << "Adds are only visible after a merge.";
+    EXPECT_EQ(a.merge(), 5);
+    EXPECT_EQ(a.merge(), 0) << "A merge should empty the slots.";
+    EXPECT_EQ(a.get(), 5);
+}
+
+TEST(statstest, testthreads) {
+    stats::Accumulator a(4);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 8; t++) {
+        threads.push_back(std::thread([&] {
+            for (int i = 0; i < 10000; i++) a.add();
+        }));
+    }
+    for (auto& t : threads) t.join();
+    a.merge();
+    EXPECT_EQ(a.get(), 80000) << "Threads sharing a slot should not lose adds.";
+}
+
+TEST(statstest, testreuse) {
+    stats::Accumulator a(4);
+    a.add();
+    std::size_t count = stats::threadCount().load();
+    for (int t = 0; t < 100; t++) {
+        std::thread([&] {a.add();}).join();
+    }
+    EXPECT_LE(stats::threadCount().load(), count + 1) << "Indices of exited threads should be reused.";
+    a.merge();
+    EXPECT_EQ(a.get(), 101) << "Reusing a slot should keep the adds of its former owner.";
+}
+
+TEST(statstest, testworld) {
+    metrics::Registry registry;
+    World world;
+    world.attachMetrics(registry);
+    world.addSystem(Phase::Combat, [](World& w) {w.getStats().damageDealt.add(7);});
+    world.tick();
+    world.tick();
+    EXPECT_EQ(world.getStats().damageDealt.get(), 14);
+    EXPECT_EQ(registry.counter("spacewalk_damage_dealt_total").get(), 14);
+}
@@ -0,0 +1,113 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <thread>
+#include "txn.hpp"
+
+TEST(txntest, testcommit) {
+    node vault(new Room("Vault"));
+    item key(new Object("Key"));
+    vault->addItem(key);
+    Entity trader("Trader");
+    Entity buyer("Buyer");
+    item credits(new Object("Credits"));
+    trader.addItem(credits);
+    txn::Transaction t;
+    t.move(*vault, "Key", buyer).move(trader, "Credits", buyer);
+    EXPECT_EQ(t.commit(), txn::Result::Committed);
+    EXPECT_TRUE(vault->getItems().empty());
+    EXPECT_TRUE(trader.getItems().empty());
+    ASSERT_EQ(buyer.getItems().size(), 2);
+    EXPECT_EQ(buyer.getItems()[0]->getName(), "Key");
+    EXPECT_EQ(buyer.getItems()[1]->getName(), "Credits");
+}
+
+TEST(txntest, testfailurerollsback) {
+    node workshop(new Room("Workshop"));
+    item a(new Object("Wire"));
+    item b(new Object("Battery"));
+    workshop->addItem(a).addItem(b);
+    Entity crafter("Crafter");
+    std::uint64_t version = workshop->getVersion().get();
+    txn::Transaction t;
+    t.move(*workshop, "Battery", crafter).move(*workshop, "Wire", crafter).move(*workshop, "Lens", crafter);
+    EXPECT_EQ(t.commit(), txn::Result::Failed) << "The missing Lens should fail the transaction.";
+    ASSERT_EQ(workshop->getItems().size(), 2) << "The applied moves should be undone.";
+    EXPECT_EQ(workshop->getItems()[0]->getName(), "Wire");
+    EXPECT_EQ(workshop->getItems()[1]->getName(), "Battery");
+    EXPECT_TRUE(crafter.getItems().empty());
+    EXPECT_EQ(workshop->getVersion().get(), version) << "A failed transaction should not change the version.";
+}
+
+TEST(txntest, testconflict) {
+    node room(new Room("Cargo"));
+    item crate(new Object("Crate"));
+    room->addItem(crate);
+    Entity first("First");
+    Entity second("Second");
+    txn::Transaction t;
+    t.move(*room, "Crate", first);
+    item extra(new Object("Extra"));
+    room->addItem(extra);
+    EXPECT_EQ(t.commit(), txn::Result::Conflict) << "A change since the first touch should be detected.";
+    EXPECT_EQ(room->getItems().size(), 2);
+    t.move(*room, "Crate", second);
+    EXPECT_EQ(t.commit(), txn::Result::Committed) << "A retry should succeed.";
+}
+
+TEST(txntest, testparallelgrab) {
+    node room(new Room("Loot"));
+    for (int i = 0; i < 100; i++) {
+        item loot(new Object("Loot"));
+        room->addItem(loot);
+    }
+    std::vector<std::unique_ptr<Entity>> players;
+    for (int i = 0; i < 4; i++) players.push_back(std::unique_ptr<Entity>(new Entity("Player")));
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 4; i++) {
+        threads.push_back(std::thread([&, i] {
+            Arena arena;
+            txn::Transaction t(arena);
+            while (true) {
+                t.move(*room, "Loot", *players[i]);
+                txn::Result r = t.commit();
+                if (r == txn::Result::Failed) break;
+            }
+        }));
+    }
+    for (auto& t : threads) t.join();
+    std::size_t total = 0;
+    for (auto& p : players) total += p->getItems().size();
+    EXPECT_EQ(total, 100) << "Every item should be taken exactly once.";
+    EXPECT_TRUE(room->getItems().empty());
+}
+
+TEST(txntest, testaddduringcommit) {
+    node room(new Room("Spawn"));
+    Entity player("Player");
+    std::atomic<bool> done(false);
+    std::thread spawner([&] {
+        for (int i = 0; i < 1000; i++) {
+            item loot(new Object("Loot"));
+            room->addItem(loot);
+        }
+        done = true;
+    });
+    Arena arena;
+    txn::Transaction t(arena);
+    std::size_t grabbed = 0;
+    while (grabbed < 1000) {
+        bool finished = done; // Read before the commit, a failure after the last add means an empty room.
+        t.move(*room, "Loot", player);
+        txn::Result r = t.commit();
+        if (r == txn::Result::Committed) {
+            grabbed++;
+        } else if (r == txn::Result::Failed && finished) {
+            break;
+        }
+    }
+    spawner.join();
+    EXPECT_EQ(grabbed, 1000) << "Every added item should be grabbed exactly once.";
+    EXPECT_EQ(player.getItems().size(), 1000);
+    EXPECT_TRUE(room->getItems().empty());
+    EXPECT_EQ(room->getVersion().get() % 2, 0) << "No lock should be left behind.";
+}
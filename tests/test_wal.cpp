@@ -0,0 +1,180 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <cstdlib>
+#include "wal.hpp"
+
+static std::string makeDir() {
+    char name[] = "test_wal_XXXXXX";
+    return mkdtemp(name);
+}
+
+static void removeDir(const std::string& dir) {
+    for (auto const& f : wal::list(dir, "wal-", ".log")) unlink(f.second.c_str());
+    for (auto const& f : wal::list(dir, "base-", ".snap")) unlink(f.second.c_str());
+    rmdir(dir.c_str());
+}
+
+TEST(waltest, testencoding) {
+    std::string buffer;
+    wal::encode(buffer, 7, {wal::Op::Add, wal::roomKey("Bridge"), "Key", "airlock"});
+    wal::encode(buffer, 8, {wal::Op::Remove, wal::entityKey("Ripley"), "Flare"});
+    wal::Decoder d(buffer);
+    std::uint64_t sequence;
+    wal::Mutation m;
+    ASSERT_TRUE(d.next(sequence, m));
+    EXPECT_EQ(sequence, 7);
+    EXPECT_EQ(m.target, "room/Bridge");
+    EXPECT_EQ(m.keyID, "airlock");
+    ASSERT_TRUE(d.next(sequence, m));
+    EXPECT_EQ(m.op, wal::Op::Remove);
+    EXPECT_EQ(m.item, "Flare");
+    EXPECT_TRUE(m.keyID.empty());
+    EXPECT_FALSE(d.next(sequence, m));
+    buffer[buffer.size() - 1] ^= 1;
+    wal::Decoder corrupt(buffer);
+    EXPECT_TRUE(corrupt.next(sequence, m));
+    EXPECT_FALSE(corrupt.next(sequence, m)) << "A corrupt record should end the replay.";
+}
+
+TEST(waltest, testgroupcommit) {
+    std::string dir = makeDir();
+    std::atomic<int> acked(0);
+    {
+        wal::Log log(dir, 1000000000);
+        for (int i = 0; i < 100; i++) log.append({wal::Op::Add, wal::roomKey("Hold"), "Crate"}, [&] {acked++;});
+        EXPECT_EQ(acked.load(), 0) << "Nothing should be acknowledged before it is durable.";
+        log.sync();
+        EXPECT_EQ(acked.load(), 100);
+        EXPECT_EQ(log.getGroups(), 1) << "The appends should share one fdatasync.";
+        EXPECT_EQ(log.getDurable(), 100);
+        log.append({wal::Op::Remove, wal::roomKey("Hold"), "Crate"});
+    }
+    wal::Recovery r = wal::recover(dir);
+    EXPECT_EQ(r.last, 101) << "Closing the log should make the last group durable.";
+    EXPECT_EQ(r.state[wal::roomKey("Hold")].size(), 99);
+    removeDir(dir);
+}
+
+TEST(waltest, testacksinmailbox) {
+    std::string dir = makeDir();
+    jobs::Mailbox mailbox;
+    int acked = 0;
+    wal::Log log(dir, 1000000, &mailbox);
+    log.append({wal::Op::Add, wal::roomKey("Hold"), "Crate"}, [&] {acked++;});
+    log.sync();
+    EXPECT_EQ(acked, 0);
+    EXPECT_EQ(mailbox.drain(), 1) << "Acknowledgements should be handed to the tick.";
+    EXPECT_EQ(acked, 1);
+    removeDir(dir);
+}
+
+TEST(waltest, testrecovery) {
+    std::string dir = makeDir();
+    {
+        wal::Log log(dir);
+        log.append({wal::Op::Add, wal::roomKey("Bridge"), "Key"});
+        log.append({wal::Op::Add, wal::roomKey("Bridge"), "Map"});
+        log.sync();
+    }
+    wal::State base;
+    base[wal::roomKey("Bridge")] = {{"Key", "airlock"}, {"Map", ""}};
+    wal::writeBase(dir, base, 2);
+    {
+        wal::Log log(dir);
+        EXPECT_EQ(log.append({wal::Op::Remove, wal::roomKey("Bridge"), "Key"}), 3) << "Sequences should continue after a restart.";
+        log.append({wal::Op::Add, wal::roomKey("Galley"), "Knife"});
+    }
+    std::string segment = wal::list(dir, "wal-", ".log").back().second;
+    int fd = open(segment.c_str(), O_WRONLY | O_APPEND);
+    ASSERT_EQ(write(fd, "\x20\0\0\0torn", 8), 8);
+    close(fd);
+    wal::Recovery r = wal::recover(dir);
+    EXPECT_EQ(r.base, 2);
+    EXPECT_EQ(r.replayed, 2);
+    EXPECT_EQ(r.last, 4);
+    World world;
+    node bridge(new Room("Bridge"));
+    node galley(new Room("Galley"));
+    world.addRoom(bridge).addRoom(galley);
+    wal::restore(world, r.state);
+    ASSERT_EQ(bridge->getItems().size(), 1);
+    EXPECT_EQ(bridge->getItems()[0]->getName(), "Map");
+    EXPECT_EQ(galley->getItems()[0]->getName(), "Knife");
+    removeDir(dir);
+}
+
+TEST(waltest, testrestorekeysandentities) {
+    std::string dir = makeDir();
+    {
+        wal::Log log(dir);
+        log.append({wal::Op::Add, wal::roomKey("Bridge"), "Key", "airlock"});
+        log.append({wal::Op::Add, wal::entityKey("Ripley"), "Flare"});
+        log.append({wal::Op::Add, wal::entityKey("Ripley"), "Keycard", "armory"});
+    }
+    World world;
+    node bridge(new Room("Bridge"));
+    world.addRoom(bridge);
+    std::shared_ptr<Entity> ripley = std::make_shared<Entity>("Ripley");
+    item old(new Object("Old"));
+    ripley->addItem(old);
+    world.addEntity(ripley);
+    wal::restore(world, wal::recover(dir).state);
+    ASSERT_EQ(bridge->getItems().size(), 1);
+    Key* key = dynamic_cast<Key*>(bridge->getItems()[0].get());
+    ASSERT_NE(key, nullptr) << "A logged Key should be restored as a Key.";
+    EXPECT_EQ(key->getKeyID(), "airlock");
+    ASSERT_EQ(ripley->getItems().size(), 2) << "The inventories of entities should be restored.";
+    EXPECT_EQ(ripley->getItems()[0]->getName(), "Flare");
+    EXPECT_EQ(dynamic_cast<Key*>(ripley->getItems()[1].get())->getKeyID(), "armory");
+    removeDir(dir);
+}
+
+TEST(waltest, testappendafterfailure) {
+    std::string dir = makeDir();
+    wal::Log log(dir, 1000000, nullptr, 1);
+    removeDir(dir);
+    log.append({wal::Op::Add, wal::roomKey("Hold"), "Crate"});
+    EXPECT_THROW(log.sync(), std::runtime_error) << "The next segment cannot be opened without the directory.";
+    EXPECT_THROW(log.append({wal::Op::Add, wal::roomKey("Hold"), "Crate"}), std::runtime_error)
+        << "A failed log should not hand out sequences, that never become durable.";
+}
+
+TEST(waltest, testtornfirstrecord) {
+    std::string dir = makeDir();
+    int fd = open((dir + "/" + wal::fileName("wal-", 1, ".log")).c_str(), O_WRONLY | O_CREAT, 0644);
+    ASSERT_EQ(write(fd, "\x20\0\0\0torn", 8), 8);
+    close(fd);
+    {
+        wal::Log log(dir);
+        EXPECT_EQ(log.append({wal::Op::Add, wal::roomKey("Hold"), "Crate"}), 1);
+        log.append({wal::Op::Add, wal::roomKey("Hold"), "Crate"});
+        log.sync();
+    }
+    wal::Recovery r = wal::recover(dir);
+    EXPECT_EQ(r.last, 2) << "Records appended after a torn one should be recovered.";
+    EXPECT_EQ(r.state[wal::roomKey("Hold")].size(), 2);
+    removeDir(dir);
+}
+
+TEST(waltest, testbasesections) {
+    std::string dir = makeDir();
+    wal::State state;
+    for (int i = 0; i < 5000; i++) state[wal::roomKey("Room" + std::to_string(i))] = {{"Crate", ""}, {"Key", "Vault"}};
+    wal::writeBase(dir, state, 9);
+    std::string path = wal::list(dir, "base-", ".snap").back().second;
+    jobs::Pool pool(2);
+    wal::State read;
+    std::uint64_t sequence = 0;
+    ASSERT_TRUE(wal::readBase(path, read, sequence, &pool));
+    EXPECT_EQ(sequence, 9);
+    EXPECT_EQ(read, state);
+    std::string data = wal::readFile(path);
+    ASSERT_GT(data.size(), 2 * wal::sectionBytes) << "The base should span several sections.";
+    int fd = open(path.c_str(), O_WRONLY);
+    ASSERT_EQ(pwrite(fd, "\xff", 1, data.size() / 2), 1);
+    close(fd);
+    EXPECT_FALSE(wal::readBase(path, read, sequence, &pool)) << "A damaged section should be found.";
+    ASSERT_EQ(truncate(path.c_str(), 30), 0);
+    EXPECT_FALSE(wal::readBase(path, read, sequence)) << "A truncated base should not be read past its end.";
+    removeDir(dir);
+}